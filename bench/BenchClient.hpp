@@ -0,0 +1,171 @@
+#pragma once
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalSocket>
+#include <QTimer>
+#include <QUrl>
+#include <QWebSocket>
+#include <QtEndian>
+#include <functional>
+#include "Transport.hpp"
+
+// Synchronous loopback client used by qab-bench: every call() spins a local
+// event loop until the reply with the matching id arrives, so the in-process
+// InspectorServer gets to run in between. Speaks JSON over the WebSocket
+// port or, given a name, over the server's local socket.
+class BenchClient {
+public:
+    explicit BenchClient(quint16 port)
+    {
+        QObject::connect(&m_sock, &QWebSocket::textMessageReceived,
+                         [this](const QString& msg) { receive(msg.toUtf8()); });
+        QEventLoop loop;
+        QObject::connect(&m_sock, &QWebSocket::connected, &loop, &QEventLoop::quit);
+        QTimer::singleShot(5000, &loop, &QEventLoop::quit);
+        m_sock.open(QUrl(QStringLiteral("ws://127.0.0.1:%1").arg(port)));
+        loop.exec();
+    }
+
+    explicit BenchClient(const QString& localName)
+        : m_isLocal(true)
+    {
+        QObject::connect(&m_local, &QLocalSocket::readyRead, [this] {
+            m_localInput += m_local.readAll();
+            while (m_localInput.size() >= LocalFrame::kHeaderBytes) {
+                const quint32 size = qFromBigEndian<quint32>(m_localInput.constData());
+                if (m_localInput.size() - LocalFrame::kHeaderBytes < qsizetype(size)) break;
+                const QByteArray payload = m_localInput.mid(LocalFrame::kHeaderBytes, size);
+                m_localInput.remove(0, LocalFrame::kHeaderBytes + qsizetype(size));
+                receive(payload);
+            }
+        });
+        QEventLoop loop;
+        QObject::connect(&m_local, &QLocalSocket::connected, &loop, &QEventLoop::quit);
+        QTimer::singleShot(5000, &loop, &QEventLoop::quit);
+        m_local.connectToServer(localName);
+        if (m_local.state() != QLocalSocket::ConnectedState) loop.exec();
+    }
+
+    bool isConnected() const
+    {
+        return m_isLocal ? m_local.state() == QLocalSocket::ConnectedState
+                         : m_sock.state() == QAbstractSocket::ConnectedState;
+    }
+
+    QJsonObject call(const QString& method, const QJsonObject& params = {})
+    {
+        m_waitingId = QString::number(++m_nextId);
+        m_reply = {};
+        QJsonObject req{{"id", m_waitingId}, {"method", method}, {"params", params}};
+        send(QJsonDocument(req).toJson(QJsonDocument::Compact));
+        QEventLoop loop;
+        m_loop = &loop;
+        QTimer::singleShot(10000, &loop, &QEventLoop::quit);
+        if (!m_waitingId.isEmpty()) loop.exec();
+        m_loop = nullptr;
+        return m_reply;
+    }
+
+    // Sends `count` identical requests back to back and waits for every reply;
+    // returns false on timeout.
+    bool pipeline(const QString& method, const QJsonObject& params, int count)
+    {
+        m_outstanding = count;
+        for (int i = 0; i < count; ++i) {
+            const QJsonObject req{{"id", QStringLiteral("p%1").arg(i)}, {"method", method}, {"params", params}};
+            send(QJsonDocument(req).toJson(QJsonDocument::Compact));
+        }
+        QEventLoop loop;
+        m_loop = &loop;
+        QTimer::singleShot(60000, &loop, &QEventLoop::quit);
+        if (m_outstanding > 0) loop.exec();
+        m_loop = nullptr;
+        const bool done = m_outstanding == 0;
+        m_outstanding = 0;
+        return done;
+    }
+
+    QJsonObject result(const QString& method, const QJsonObject& params = {})
+    {
+        return call(method, params).value("result").toObject();
+    }
+
+    // Let queued frames (events, pending writes) flow without timing them.
+    void drain(int ms = 0)
+    {
+        QElapsedTimer t;
+        t.start();
+        do {
+            QCoreApplication::processEvents(QEventLoop::AllEvents, 5);
+        } while (t.elapsed() < ms);
+    }
+
+    // Spin the event loop until done() holds or timeoutMs passes.
+    bool waitFor(const std::function<bool()>& done, int timeoutMs = 30000)
+    {
+        QElapsedTimer t;
+        t.start();
+        while (!done()) {
+            if (t.elapsed() > timeoutMs) return false;
+            QCoreApplication::processEvents(QEventLoop::AllEvents, 5);
+        }
+        return true;
+    }
+
+    quint64 events() const { return m_events; }
+
+    // Receives id-less frames other than subscription events (e.g. model_chunk).
+    void onNotification(std::function<void(const QJsonObject&)> handler) { m_notify = std::move(handler); }
+
+private:
+    void send(const QByteArray& json)
+    {
+        if (!m_isLocal) {
+            m_sock.sendTextMessage(QString::fromUtf8(json));
+            return;
+        }
+        char header[LocalFrame::kHeaderBytes];
+        qToBigEndian<quint32>(quint32(json.size()), header);
+        header[4] = LocalFrame::kJson;
+        m_local.write(header, sizeof header);
+        m_local.write(json);
+    }
+
+    void receive(const QByteArray& json)
+    {
+        const QJsonObject o = QJsonDocument::fromJson(json).object();
+        if (o.value("method").toString() == QLatin1String("event")) {
+            ++m_events;
+            return;
+        }
+        if (!o.contains("id")) {
+            if (m_notify) m_notify(o);
+            return;
+        }
+        if (m_outstanding > 0 && o.value("id").toString().startsWith(QLatin1Char('p'))) {
+            if (--m_outstanding == 0 && m_loop) m_loop->quit();
+            return;
+        }
+        if (o.value("id").toString() == m_waitingId) {
+            m_reply = o;
+            m_waitingId.clear();
+            if (m_loop) m_loop->quit();
+        }
+    }
+
+    QWebSocket m_sock;
+    QLocalSocket m_local;
+    QByteArray m_localInput;
+    bool m_isLocal { false };
+    QEventLoop* m_loop { nullptr };
+    QString m_waitingId;
+    QJsonObject m_reply;
+    quint64 m_nextId { 0 };
+    int m_outstanding { 0 }; // pipeline() replies still due
+    quint64 m_events { 0 };
+    std::function<void(const QJsonObject&)> m_notify;
+};
@@ -0,0 +1,689 @@
+#include <QGuiApplication>
+#include <QAbstractListModel>
+#include <QColor>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QFile>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QQmlApplicationEngine>
+#include <QThread>
+#include <QPointF>
+#include <QRectF>
+#include <QSizeF>
+#include <QTimer>
+#include <QUrl>
+#include <QWebSocket>
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include "BenchClient.hpp"
+#include "InspectorServer.hpp"
+#include "ObjectRegistry.hpp"
+#include "VariantConverter.hpp"
+#include "WireCodec.hpp"
+
+// Results are printed as one JSON object per line so runs can be diffed
+// between commits; --output appends the same lines to a file and --label
+// tags every line (e.g. with the commit being measured).
+static QString g_label;
+static QFile* g_output = nullptr;
+
+static void report(const QString& scenario, const QJsonObject& fields)
+{
+    QJsonObject o(fields);
+    o.insert("scenario", scenario);
+    if (!g_label.isEmpty()) o.insert("label", g_label);
+    const QByteArray line = QJsonDocument(o).toJson(QJsonDocument::Compact);
+    printf("%s\n", line.constData());
+    fflush(stdout);
+    if (g_output) {
+        g_output->write(line + '\n');
+        g_output->flush();
+    }
+}
+
+static double median(std::vector<double> v)
+{
+    if (v.empty()) return 0;
+    std::sort(v.begin(), v.end());
+    return v[v.size() / 2];
+}
+
+static double percentile(std::vector<double> v, double p)
+{
+    if (v.empty()) return 0;
+    std::sort(v.begin(), v.end());
+    return v[std::min(v.size() - 1, size_t(p * v.size()))];
+}
+
+// Flat scene of `count` Items named n0..n{count-1} plus one "probe" Item.
+static QByteArray flatScene(int count)
+{
+    QByteArray qml = "import QtQuick\nItem {\n objectName: \"root\"\n"
+                     " Item { objectName: \"probe\"; property int v: 0 }\n";
+    for (int i = 0; i < count; ++i)
+        qml += " Item { objectName: \"n" + QByteArray::number(i) + "\"; property int v: 0 }\n";
+    qml += "}\n";
+    return qml;
+}
+
+// `count` Items named n0..n{count-1} under the root. Wide scenes put them all
+// directly under the root; deep scenes nest them in chains of kChainDepth, so
+// walks have to descend instead of scanning one child list.
+static constexpr int kChainDepth = 100;
+
+static QByteArray shapedScene(int count, bool deep)
+{
+    QByteArray qml = "import QtQuick\nItem {\n objectName: \"root\"\n";
+    if (!deep) {
+        for (int i = 0; i < count; ++i)
+            qml += " Item { objectName: \"n" + QByteArray::number(i) + "\"; property int v: 0 }\n";
+    } else {
+        for (int start = 0; start < count; start += kChainDepth) {
+            const int end = std::min(count, start + kChainDepth);
+            for (int i = start; i < end; ++i)
+                qml += "Item { objectName: \"n" + QByteArray::number(i) + "\"; property int v: 0\n";
+            qml += QByteArray(end - start, '}') + '\n';
+        }
+    }
+    qml += "}\n";
+    return qml;
+}
+
+// Linux only: resets the peak RSS watermark, then reads it back in KiB.
+static void resetPeakRss()
+{
+    QFile f(QStringLiteral("/proc/self/clear_refs"));
+    if (f.open(QIODevice::WriteOnly)) f.write("5");
+}
+
+static qint64 peakRssKb()
+{
+    QFile f(QStringLiteral("/proc/self/status"));
+    if (!f.open(QIODevice::ReadOnly)) return -1;
+    for (const QByteArray& line : f.readAll().split('\n')) {
+        if (line.startsWith("VmHWM:")) return line.mid(6).trimmed().split(' ').value(0).toLongLong();
+    }
+    return -1;
+}
+
+// Rows are computed on demand so the model itself costs no memory.
+class SyntheticModel : public QAbstractListModel {
+public:
+    explicit SyntheticModel(int rows, QObject* parent) : QAbstractListModel(parent), m_rows(rows) {}
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override { return parent.isValid() ? 0 : m_rows; }
+    QVariant data(const QModelIndex& index, int role) const override
+    {
+        switch (role) {
+        case Qt::UserRole + 1: return index.row();
+        case Qt::UserRole + 2: return QStringLiteral("item %1").arg(index.row());
+        case Qt::UserRole + 3: return index.row() % 2 == 0;
+        default: return {};
+        }
+    }
+    QHash<int, QByteArray> roleNames() const override
+    {
+        return {{Qt::UserRole + 1, "id"}, {Qt::UserRole + 2, "label"}, {Qt::UserRole + 3, "even"}};
+    }
+
+private:
+    int m_rows;
+};
+
+// Per-emit cost of the probe's notify signal while the number of unrelated
+// subscriptions grows. With indexed dispatch this should stay flat.
+static int benchFanout(quint16 port, QQmlApplicationEngine& engine, int emits)
+{
+    const int objects = 1000;
+    engine.loadData(flatScene(objects));
+    QObject* root = engine.rootObjects().value(0);
+    QObject* probe = root ? root->findChild<QObject*>(QStringLiteral("probe")) : nullptr;
+    if (!probe) return 1;
+
+    BenchClient client(port);
+    if (!client.isConnected()) return 2;
+    const QString rootId = client.result("list_roots").value("roots").toArray().at(0).toObject().value("objectId").toString();
+    const QJsonArray children = client.result("list_children", {{"objectId", rootId}}).value("children").toArray();
+    QString probeId;
+    QStringList others;
+    for (const auto& c : children) {
+        const QJsonObject o = c.toObject();
+        if (o.value("objectName").toString() == QLatin1String("probe")) probeId = o.value("objectId").toString();
+        else others << o.value("objectId").toString();
+    }
+    client.call("subscribe_property", {{"objectId", probeId}, {"name", "v"}});
+
+    int subscribed = 1;
+    int value = 0;
+    for (int target : {1, 10, 100, 1000, 10000}) {
+        for (; subscribed < target; ++subscribed)
+            client.call("subscribe_property", {{"objectId", others.at(subscribed % others.size())}, {"name", "v"}});
+
+        std::vector<double> samples;
+        const int chunk = 500;
+        for (int done = 0; done < emits; done += chunk) {
+            QElapsedTimer t;
+            t.start();
+            for (int i = 0; i < chunk; ++i) probe->setProperty("v", ++value);
+            samples.push_back(double(t.nsecsElapsed()) / chunk);
+            client.drain();
+        }
+        report(QStringLiteral("fanout"), {{"mode", "dispatch"},
+                                          {"subscriptions", subscribed},
+                                          {"emits", emits},
+                                          {"nsPerEmitMedian", median(samples)}});
+    }
+
+    // Delivered fan-out: N subscriptions all watch the probe, so every emit
+    // sends N events; timed until the client has received all of them.
+    int onProbe = 1;
+    for (int target : {10, 100, 1000}) {
+        for (; onProbe < target; ++onProbe) client.call("subscribe_property", {{"objectId", probeId}, {"name", "v"}});
+        const int rounds = std::max(10, 20000 / target); // keeps each pass at ~20k events
+        client.drain(50);
+        const quint64 expected = client.events() + quint64(rounds) * quint64(onProbe);
+        QElapsedTimer t;
+        t.start();
+        for (int i = 0; i < rounds; ++i) probe->setProperty("v", ++value);
+        if (!client.waitFor([&] { return client.events() >= expected; })) return 3;
+        const double seconds = t.nsecsElapsed() / 1e9;
+        report(QStringLiteral("fanout"), {{"mode", "delivered"},
+                                          {"subscriptions", onProbe},
+                                          {"emits", rounds},
+                                          {"usPerEmit", seconds * 1e6 / rounds},
+                                          {"eventsPerSec", rounds * double(onProbe) / seconds}});
+    }
+    return 0;
+}
+
+// Encode time and payload size of real inspect/model replies per wire codec.
+static int benchCodec(quint16 port, QQmlApplicationEngine& engine, int iterations)
+{
+    engine.loadData(flatScene(200));
+    BenchClient client(port);
+    if (!client.isConnected()) return 2;
+    const QString rootId = client.result("list_roots").value("roots").toArray().at(0).toObject().value("objectId").toString();
+    const QJsonArray children = client.result("list_children", {{"objectId", rootId}}).value("children").toArray();
+    QJsonArray inspected;
+    for (const auto& c : children)
+        inspected.push_back(client.result("inspect", {{"objectId", c.toObject().value("objectId")}}));
+    const QJsonObject reply{{"id", "1"}, {"result", QJsonObject{{"objects", inspected}}}};
+
+    for (const WireCodec* codec : {WireCodec::json(), WireCodec::cbor()}) {
+        QByteArray encoded;
+        std::vector<double> encodeUs;
+        std::vector<double> decodeUs;
+        for (int i = 0; i < iterations; ++i) {
+            QElapsedTimer t;
+            t.start();
+            encoded = codec->encode(reply);
+            encodeUs.push_back(t.nsecsElapsed() / 1000.0);
+            t.restart();
+            const QJsonValue back = codec->decode(encoded);
+            decodeUs.push_back(t.nsecsElapsed() / 1000.0);
+            if (!back.isObject()) return 3;
+        }
+        report(QStringLiteral("codec"), {{"codec", codec->name()},
+                                         {"objects", inspected.size()},
+                                         {"bytes", encoded.size()},
+                                         {"encodeUsMedian", median(encodeUs)},
+                                         {"decodeUsMedian", median(decodeUs)}});
+    }
+    return 0;
+}
+
+// Full inspect vs value-only inspect over many instances of one class.
+static int benchInspect(quint16 port, QQmlApplicationEngine& engine, int iterations)
+{
+    engine.loadData(flatScene(2000));
+    BenchClient client(port);
+    if (!client.isConnected()) return 2;
+    const QString rootId = client.result("list_roots").value("roots").toArray().at(0).toObject().value("objectId").toString();
+    const QJsonArray children = client.result("list_children", {{"objectId", rootId}}).value("children").toArray();
+
+    for (const QString mode : {QStringLiteral("full"), QStringLiteral("values")}) {
+        QJsonArray requests;
+        for (const auto& c : children)
+            requests.push_back(QJsonObject{{"id", "i"}, {"method", "inspect"},
+                                           {"params", QJsonObject{{"objectId", c.toObject().value("objectId")}, {"mode", mode}}}});
+        std::vector<double> ms;
+        qint64 bytes = 0;
+        for (int i = 0; i < iterations; ++i) {
+            QElapsedTimer t;
+            t.start();
+            const QJsonObject r = client.result("batch", {{"requests", requests}});
+            ms.push_back(t.nsecsElapsed() / 1e6);
+            bytes = QJsonDocument(r).toJson(QJsonDocument::Compact).size();
+        }
+        report(QStringLiteral("inspect"), {{"mode", mode},
+                                           {"objects", children.size()},
+                                           {"bytes", bytes},
+                                           {"msMedian", median(ms)}});
+    }
+    return 0;
+}
+
+// One-shot model_fetch vs streaming model_export of a large model: time to
+// first data, total time and peak RSS (client and server share the process).
+static int benchModel(quint16 port, QQmlApplicationEngine& engine, int rows)
+{
+    engine.loadData(flatScene(0));
+    QObject* root = engine.rootObjects().value(0);
+    if (!root) return 1;
+    auto* model = new SyntheticModel(rows, root);
+    model->setObjectName(QStringLiteral("bigModel"));
+    BenchClient client(port);
+    if (!client.isConnected()) return 2;
+    const QString modelId = client.result("find_by_name", {{"name", "bigModel"}}).value("matches").toArray().at(0).toObject().value("objectId").toString();
+
+    client.drain(50);
+    resetPeakRss();
+    QElapsedTimer t;
+    t.start();
+    const QJsonObject fetched = client.result("model_fetch", {{"objectId", modelId}, {"count", rows}});
+    const double fetchMs = t.nsecsElapsed() / 1e6;
+    report(QStringLiteral("model"), {{"mode", "fetch"},
+                                     {"rows", fetched.value("items").toArray().size()},
+                                     {"firstDataMs", fetchMs},
+                                     {"totalMs", fetchMs},
+                                     {"peakRssKb", double(peakRssKb())}});
+
+    for (int chunkSize : {1000, 10000}) {
+        client.drain(50);
+        resetPeakRss();
+        qint64 received = 0;
+        double firstMs = -1;
+        bool done = false;
+        client.onNotification([&](const QJsonObject& msg) {
+            if (msg.value("method").toString() != QLatin1String("model_chunk")) return;
+            const QJsonObject chunk = msg.value("params").toObject();
+            if (firstMs < 0) firstMs = t.nsecsElapsed() / 1e6;
+            received += chunk.value("count").toInt();
+            done = chunk.value("done").toBool();
+        });
+        t.restart();
+        client.call("model_export", {{"objectId", modelId}, {"chunkSize", chunkSize}});
+        if (!client.waitFor([&] { return done; })) return 3;
+        report(QStringLiteral("model"), {{"mode", "export"},
+                                         {"chunkSize", chunkSize},
+                                         {"rows", double(received)},
+                                         {"firstDataMs", firstMs},
+                                         {"totalMs", t.nsecsElapsed() / 1e6},
+                                         {"peakRssKb", double(peakRssKb())}});
+    }
+    client.onNotification({});
+    return 0;
+}
+
+// GUI-thread frame lateness and request latency under closed-loop load from a
+// second thread, with networking/encoding on the GUI thread vs the I/O thread.
+static int benchIo(InspectorServer& server, QQmlApplicationEngine& engine, int durationMs)
+{
+    engine.loadData(flatScene(0));
+    QObject* root = engine.rootObjects().value(0);
+    if (!root) return 1;
+    auto* model = new SyntheticModel(100000, root);
+    model->setObjectName(QStringLiteral("bigModel"));
+
+    for (bool ioThread : {false, true}) {
+        server.setIoThreadEnabled(ioThread);
+        const quint16 port = server.serverPort();
+        QString modelId;
+        {
+            BenchClient probe(port);
+            if (!probe.isConnected()) return 2;
+            modelId = probe.result("find_by_name", {{"name", "bigModel"}}).value("matches").toArray().at(0).toObject().value("objectId").toString();
+        }
+        const QString request = QString::fromUtf8(QJsonDocument(QJsonObject{
+            {"id", "load"}, {"method", "model_fetch"},
+            {"params", QJsonObject{{"objectId", modelId}, {"count", 2000}}}}).toJson(QJsonDocument::Compact));
+
+        std::vector<double> latencies;
+        QThread* load = QThread::create([&] {
+            QWebSocket sock;
+            QEventLoop loop;
+            QElapsedTimer total;
+            QElapsedTimer sent;
+            QObject::connect(&sock, &QWebSocket::connected, [&] {
+                total.start();
+                sent.start();
+                sock.sendTextMessage(request);
+            });
+            QObject::connect(&sock, &QWebSocket::textMessageReceived, [&](const QString&) {
+                latencies.push_back(sent.nsecsElapsed() / 1e6);
+                if (total.elapsed() >= durationMs) {
+                    loop.quit();
+                    return;
+                }
+                sent.restart();
+                sock.sendTextMessage(request);
+            });
+            QTimer::singleShot(durationMs + 10000, &loop, &QEventLoop::quit);
+            sock.open(QUrl(QStringLiteral("ws://127.0.0.1:%1").arg(port)));
+            loop.exec();
+        });
+
+        // Stand-in for the render loop: a 16 ms tick whose lateness is a dropped frame.
+        std::vector<double> lateMs;
+        QElapsedTimer clock;
+        qint64 last = 0;
+        QTimer frame;
+        frame.setTimerType(Qt::PreciseTimer);
+        frame.setInterval(16);
+        QObject::connect(&frame, &QTimer::timeout, [&] {
+            const qint64 now = clock.nsecsElapsed();
+            lateMs.push_back(std::max(0.0, (now - last) / 1e6 - 16));
+            last = now;
+        });
+        QEventLoop wait;
+        QObject::connect(load, &QThread::finished, &wait, &QEventLoop::quit);
+        clock.start();
+        frame.start();
+        load->start();
+        wait.exec();
+        frame.stop();
+        load->wait();
+        delete load;
+
+        const auto missed = std::count_if(lateMs.begin(), lateMs.end(), [](double ms) { return ms >= 16; });
+        report(QStringLiteral("io"), {{"ioThread", ioThread},
+                                      {"requests", double(latencies.size())},
+                                      {"latencyMsP50", percentile(latencies, 0.5)},
+                                      {"latencyMsP99", percentile(latencies, 0.99)},
+                                      {"frameLateMsP50", percentile(lateMs, 0.5)},
+                                      {"frameLateMsP99", percentile(lateMs, 0.99)},
+                                      {"frameLateMsMax", percentile(lateMs, 1.0)},
+                                      {"framesMissed", double(missed)}});
+    }
+    return 0;
+}
+
+// find_by_name through the recursive walk vs the object index as the scene grows.
+static int benchIndex(InspectorServer& server, QQmlApplicationEngine& engine, int iterations)
+{
+    engine.loadData(flatScene(0));
+    QObject* root = engine.rootObjects().value(0);
+    if (!root) return 1;
+    BenchClient client(server.serverPort());
+    if (!client.isConnected()) return 2;
+
+    QVector<QObject*> objects{root};
+    for (int size : {1000, 10000, 100000}) {
+        // 8-ary tree of plain QObjects below the QML root.
+        while (objects.size() < size) {
+            auto* o = new QObject(objects.at((objects.size() - 1) / 8));
+            o->setObjectName(QStringLiteral("o%1").arg(objects.size()));
+            objects.push_back(o);
+        }
+        const QJsonObject query{{"name", objects.constLast()->objectName()}};
+        for (bool indexed : {false, true}) {
+            server.setObjectIndexEnabled(indexed);
+            QElapsedTimer t;
+            t.start();
+            client.call("find_by_name", query); // builds the index when enabled
+            const double firstMs = t.nsecsElapsed() / 1e6;
+            std::vector<double> ms;
+            for (int i = 0; i < iterations; ++i) {
+                t.restart();
+                client.call("find_by_name", query);
+                ms.push_back(t.nsecsElapsed() / 1e6);
+            }
+            report(QStringLiteral("index"), {{"objects", size},
+                                             {"indexed", indexed},
+                                             {"firstMs", firstMs},
+                                             {"msMedian", median(ms)}});
+        }
+        server.setObjectIndexEnabled(false);
+    }
+    return 0;
+}
+
+// Round-trip latency and pipelined throughput over the WebSocket port vs the
+// local socket, for a small reply and a larger one, with networking on the
+// GUI thread and on the I/O thread.
+static int benchTransport(InspectorServer& server, QQmlApplicationEngine& engine, int iterations)
+{
+    engine.loadData(flatScene(100));
+    if (engine.rootObjects().isEmpty()) return 2;
+    const QString localName = QStringLiteral("qab-bench-%1").arg(QCoreApplication::applicationPid());
+    for (bool ioThread : {false, true}) {
+        server.setIoThreadEnabled(ioThread);
+        if (!server.listenLocal(localName)) return 2;
+        for (bool local : {false, true}) {
+            const std::unique_ptr<BenchClient> owner(local ? new BenchClient(server.localServerName())
+                                                          : new BenchClient(server.serverPort()));
+            BenchClient& client = *owner;
+            if (!client.isConnected()) return 2;
+            const QString probeId = client.result("find_by_name", {{"name", "probe"}}).value("matches").toArray().at(0).toObject().value("objectId").toString();
+            const QVector<QPair<QString, QPair<QString, QJsonObject>>> calls = {
+                {"list_roots", {"list_roots", {}}},
+                {"inspect", {"inspect", {{"objectId", probeId}}}},
+            };
+            for (const auto& call : calls) {
+                const QString& method = call.second.first;
+                const QJsonObject& params = call.second.second;
+                if (client.call(method, params).contains("error")) return 3;
+                std::vector<double> ms;
+                for (int i = 0; i < iterations; ++i) {
+                    QElapsedTimer t;
+                    t.start();
+                    client.call(method, params);
+                    ms.push_back(t.nsecsElapsed() / 1e6);
+                }
+                QElapsedTimer t;
+                t.start();
+                if (!client.pipeline(method, params, iterations)) return 4;
+                const double seconds = t.nsecsElapsed() / 1e9;
+                report(QStringLiteral("transport"), {{"transport", local ? "local" : "websocket"},
+                                                     {"ioThread", ioThread},
+                                                     {"rpc", call.first},
+                                                     {"msP50", percentile(ms, 0.5)},
+                                                     {"msP99", percentile(ms, 0.99)},
+                                                     {"callsPerSec", iterations / seconds}});
+            }
+        }
+    }
+    return 0;
+}
+
+static constexpr int kRpcModelRows = 100; // rows of the model added to every rpc scene
+
+// Latency percentiles (sequential calls) and throughput (pipelined calls) of
+// each RPC on wide and deep QML scenes of growing size. Every scene gets a
+// fresh engine and server so handles and caches start cold. cancel,
+// unsubscribe and model_export_cancel need ids of earlier requests, and
+// capture and subscribe_frames need a window, so they are left out.
+static int benchRpc(int iterations)
+{
+    for (int size : {1000, 10000, 100000}) {
+        for (bool deep : {false, true}) {
+            QQmlApplicationEngine engine;
+            engine.loadData(shapedScene(size, deep));
+            InspectorServer server(&engine, QHostAddress::LocalHost, 0);
+            BenchClient client(server.serverPort());
+            if (engine.rootObjects().isEmpty() || !client.isConnected()) return 2;
+            auto* model = new SyntheticModel(kRpcModelRows, engine.rootObjects().at(0));
+            model->setObjectName(QStringLiteral("model"));
+
+            const QString target = QStringLiteral("n%1").arg(size - 1); // last in walk order
+            const QString rootId = client.result("list_roots").value("roots").toArray().at(0).toObject().value("objectId").toString();
+            const QString targetId = client.result("find_by_name", {{"name", target}}).value("matches").toArray().at(0).toObject().value("objectId").toString();
+            QJsonArray handles;
+            for (const auto& c : client.result("list_children", {{"objectId", rootId}}).value("children").toArray()) {
+                if (handles.size() == 100) break;
+                handles.push_back(c.toObject().value("objectId"));
+            }
+            const QString modelId = client.result("find_by_name", {{"name", "model"}}).value("matches").toArray().at(0).toObject().value("objectId").toString();
+            const QJsonArray batch = {
+                QJsonObject{{"id", "b0"}, {"method", "list_roots"}},
+                QJsonObject{{"id", "b1"}, {"method", "inspect"}, {"params", QJsonObject{{"objectId", targetId}}}},
+                QJsonObject{{"id", "b2"}, {"method", "model_fetch"}, {"params", QJsonObject{{"objectId", modelId}}}},
+            };
+
+            const QVector<QPair<QString, QPair<QString, QJsonObject>>> calls = {
+                {"hello", {"hello", {}}},
+                {"list_roots", {"list_roots", {}}},
+                {"list_children", {"list_children", {{"objectId", rootId}}}},
+                {"find_by_name", {"find_by_name", {{"name", target}}}},
+                {"find_by_type", {"find_by_type", {{"type", "QQuickItem"}}}},
+                {"query", {"query", {{"selector", "Item#" + target}, {"limit", 1}, {"budget", 2 * size + 2}}}},
+                {"inspect", {"inspect", {{"objectId", targetId}}}},
+                {"inspect_values", {"inspect", {{"objectId", targetId}, {"mode", "values"}}}},
+                {"get_schema", {"get_schema", {{"objectId", targetId}}}},
+                {"resolve", {"resolve", {{"objectIds", handles}}}},
+                {"snapshot_tree", {"snapshot_tree", {{"root", rootId}, {"maxNodes", 1000}}}},
+                {"set_property", {"set_property", {{"objectId", targetId}, {"name", "v"}, {"value", 1}}}},
+                {"set_properties", {"set_properties", {{"objectId", targetId}, {"values", QJsonObject{{"v", 2}}}}}},
+                {"evaluate", {"evaluate", {{"objectId", targetId}, {"expression", "v + 1"}}}},
+                {"wait_for", {"wait_for", {{"objectId", targetId}, {"expression", "v > 0"}}}},
+                {"call_method", {"call_method", {{"objectId", targetId}, {"name", "childAt"}, {"args", QJsonArray{0, 0}}}}},
+                {"model_info", {"model_info", {{"objectId", modelId}}}},
+                {"model_fetch", {"model_fetch", {{"objectId", modelId}, {"count", kRpcModelRows}}}},
+                // One chunk per export, so exports do not pile up behind the timed replies.
+                {"model_export", {"model_export", {{"objectId", modelId}, {"chunkSize", kRpcModelRows}}}},
+                {"batch", {"batch", {{"requests", batch}}}},
+                {"stats", {"stats", {}}},
+                // Last: subscriptions are only dropped with the client, so they must
+                // not add event traffic to the calls above.
+                {"subscribe_property", {"subscribe_property", {{"objectId", targetId}, {"name", "v"}}}},
+                {"subscribe_signal", {"subscribe_signal", {{"objectId", targetId}, {"signal", "vChanged"}}}},
+                {"subscribe_model", {"subscribe_model", {{"objectId", modelId}}}},
+                {"subscribe_tree", {"subscribe_tree", {{"root", targetId}}}},
+            };
+            for (const auto& call : calls) {
+                const QString& method = call.second.first;
+                const QJsonObject& params = call.second.second;
+                if (client.call(method, params).contains("error")) return 3; // also warms caches
+                std::vector<double> ms;
+                for (int i = 0; i < iterations; ++i) {
+                    QElapsedTimer t;
+                    t.start();
+                    client.call(method, params);
+                    ms.push_back(t.nsecsElapsed() / 1e6);
+                }
+                QElapsedTimer t;
+                t.start();
+                if (!client.pipeline(method, params, iterations)) return 4;
+                const double seconds = t.nsecsElapsed() / 1e9;
+                report(QStringLiteral("rpc"), {{"rpc", call.first},
+                                               {"shape", deep ? "deep" : "wide"},
+                                               {"objects", size},
+                                               {"msP50", percentile(ms, 0.5)},
+                                               {"msP90", percentile(ms, 0.9)},
+                                               {"msP99", percentile(ms, 0.99)},
+                                               {"msMax", percentile(ms, 1.0)},
+                                               {"callsPerSec", iterations / seconds}});
+            }
+        }
+    }
+    return 0;
+}
+
+// variantToJson per value type, over the kinds of values QML properties hold.
+static int benchVariant(int iterations)
+{
+    QObject holder;
+    QTimer timer;
+    ObjectRegistry registry;
+    const VariantConverter converter(&registry);
+    const QVector<QPair<QString, QVariant>> values = {
+        {"invalid", QVariant()},
+        {"bool", true},
+        {"int", 42},
+        {"double", 3.25},
+        {"string", QStringLiteral("The quick brown fox")},
+        {"url", QUrl(QStringLiteral("qrc:/main.qml"))},
+        {"color", QColor(Qt::red)},
+        {"point", QPointF(1.5, 2.5)},
+        {"rect", QRectF(0, 0, 640, 480)},
+        {"size", QSizeF(640, 480)},
+        {"dateTime", QDateTime::fromMSecsSinceEpoch(0, Qt::UTC)},
+        {"object", QVariant::fromValue<QObject*>(&holder)},
+        {"objectSubclass", QVariant::fromValue<QTimer*>(&timer)},
+        {"stringList", QStringList{QStringLiteral("a"), QStringLiteral("b"), QStringLiteral("c")}},
+        {"list", QVariantList{1, QStringLiteral("two"), 3.0, false}},
+        {"map", QVariantMap{{QStringLiteral("x"), 1}, {QStringLiteral("label"), QStringLiteral("ok")}, {QStringLiteral("on"), true}}},
+    };
+    QVariantList mixed;
+    for (const auto& v : values) mixed.push_back(v.second);
+    size_t sink = 0; // keeps the conversions observable
+    auto measure = [&](const QString& type, const QVariant& value) {
+        std::vector<double> ns;
+        for (int round = 0; round < 5; ++round) {
+            QElapsedTimer t;
+            t.start();
+            for (int i = 0; i < iterations; ++i) sink += size_t(converter.toJson(value).type());
+            ns.push_back(double(t.nsecsElapsed()) / iterations);
+        }
+        report(QStringLiteral("variant"), {{"type", type}, {"nsPerValueMedian", median(ns)}});
+    };
+    for (const auto& v : values) measure(v.first, v.second);
+    measure(QStringLiteral("mixedList"), mixed);
+    return sink == 0 ? 5 : 0;
+}
+
+static const QStringList kScenarios = {
+    QStringLiteral("rpc"), QStringLiteral("fanout"), QStringLiteral("variant"), QStringLiteral("codec"),
+    QStringLiteral("inspect"), QStringLiteral("index"), QStringLiteral("model"), QStringLiteral("io"),
+    QStringLiteral("transport"),
+};
+
+// `n` overrides the scenario's default iteration count (or size/duration) when positive.
+static int runScenario(const QString& scenario, int n)
+{
+    auto iterations = [n](int fallback) { return n > 0 ? n : fallback; };
+    if (scenario == QLatin1String("rpc")) return benchRpc(iterations(20));
+    if (scenario == QLatin1String("variant")) return benchVariant(iterations(100000));
+
+    QQmlApplicationEngine engine;
+    InspectorServer server(&engine, QHostAddress::LocalHost, 0);
+    if (!server.isListening()) {
+        fprintf(stderr, "qab-bench: server failed to listen\n");
+        return 2;
+    }
+    if (scenario == QLatin1String("fanout")) return benchFanout(server.serverPort(), engine, iterations(20000));
+    if (scenario == QLatin1String("io")) return benchIo(server, engine, iterations(3000));
+    if (scenario == QLatin1String("transport")) return benchTransport(server, engine, iterations(2000));
+    if (scenario == QLatin1String("model")) return benchModel(server.serverPort(), engine, iterations(500000));
+    if (scenario == QLatin1String("index")) return benchIndex(server, engine, iterations(50));
+    if (scenario == QLatin1String("inspect")) return benchInspect(server.serverPort(), engine, iterations(10));
+    if (scenario == QLatin1String("codec")) return benchCodec(server.serverPort(), engine, iterations(50));
+    fprintf(stderr, "qab-bench: unknown scenario %s\n", scenario.toUtf8().constData());
+    return 1;
+}
+
+int main(int argc, char** argv)
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app(argc, argv);
+    QCommandLineParser p;
+    p.addHelpOption();
+    QCommandLineOption scenarioOpt({"s", "scenario"}, "scenario to run, or \"all\" (" + kScenarios.join(", ") + ")", "name", "fanout");
+    QCommandLineOption iterOpt({"n", "iterations"}, "iterations per measurement (scenario default if unset)", "count");
+    QCommandLineOption outputOpt({"o", "output"}, "also append the JSON lines to this file", "path");
+    QCommandLineOption labelOpt({"l", "label"}, "tag added to every result line, e.g. a commit hash", "text");
+    p.addOption(scenarioOpt); p.addOption(iterOpt); p.addOption(outputOpt); p.addOption(labelOpt);
+    p.process(app);
+
+    g_label = p.value(labelOpt);
+    QFile output(p.value(outputOpt));
+    if (p.isSet(outputOpt)) {
+        if (!output.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+            fprintf(stderr, "qab-bench: cannot open %s\n", qPrintable(output.fileName()));
+            return 2;
+        }
+        g_output = &output;
+    }
+    report(QStringLiteral("meta"), {{"qt", QString::fromLatin1(qVersion())}, {"metrics", Metrics::kEnabled}});
+
+    const QString scenario = p.value(scenarioOpt);
+    const int n = p.value(iterOpt).toInt();
+    if (scenario != QLatin1String("all")) return runScenario(scenario, n);
+    // With "all", -n would mean different things per scenario, so defaults apply.
+    for (const QString& s : kScenarios) {
+        if (const int rc = runScenario(s, 0)) return rc;
+    }
+    return 0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <QCache>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QString>
+class QObject;
+class QQmlContext;
+class QQmlExpression;
+
+// Compiled QQmlExpressions keyed by (context, scope object, source), so an
+// expression that an agent evaluates repeatedly is parsed once and then only
+// re-evaluated. Entries hold guarded pointers: one whose context or scope
+// object is gone, or whose address was reused by a new object, is recompiled
+// rather than evaluated. Least recently used entries are dropped past the
+// capacity.
+class ExpressionCache {
+public:
+    struct Stats {
+        quint64 lookups { 0 };
+        quint64 compiles { 0 };
+    };
+
+    explicit ExpressionCache(int capacity);
+
+    // Shared so an eviction during evaluation cannot delete the expression.
+    QSharedPointer<QQmlExpression> get(QQmlContext* context, QObject* scope, const QString& source);
+
+    int size() const { return m_cache.size(); }
+    const Stats& stats() const { return m_stats; }
+
+private:
+    struct Key {
+        QQmlContext* context;
+        QObject* scope;
+        QString source;
+        bool operator==(const Key& o) const { return context == o.context && scope == o.scope && source == o.source; }
+    };
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    friend size_t qHash(const Key& key, size_t seed) { return qHashMulti(seed, key.context, key.scope, key.source); }
+#else
+    friend uint qHash(const Key& key, uint seed) { return qHash(key.source, qHash(key.scope, qHash(key.context, seed))); }
+#endif
+
+    struct Entry {
+        QPointer<QQmlContext> context;
+        QPointer<QObject> scope;
+        QSharedPointer<QQmlExpression> expression;
+    };
+
+    QCache<Key, Entry> m_cache;
+    Stats m_stats;
+};
@@ -0,0 +1,88 @@
+#pragma once
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QJsonObject>
+#include <QMetaObject>
+#include <QPointer>
+#include <QRect>
+#include <QString>
+#include <functional>
+class QObject;
+class QQuickItem;
+class QQuickWindow;
+class QTimer;
+
+// Pixels of a QQuickWindow for capture and subscribe_frames. Grabbing goes
+// through QQuickWindow::grabWindow(), which renders the scene into an image
+// with whatever backend the window uses, so it also works with the software
+// scene graph on the offscreen platform (QT_QPA_PLATFORM=offscreen,
+// QT_QUICK_BACKEND=software) where there is no screen to read back.
+struct FrameOptions {
+    enum Encoding { Png, Jpeg };
+    double scale { 1.0 };    // 0 < scale <= 1, applied to the window's device pixels
+    Encoding encoding { Png }; // Png is lossless, Jpeg lossy and smaller for photos and gradients
+    int quality { 80 };      // Jpeg only, 0..100
+    int tileSize { 64 };     // subscribe_frames diff grid, in scaled pixels
+
+    // From RPC params { scale?, encoding?: "png"|"jpeg", quality?, tileSize? };
+    // returns an error message or an empty string.
+    static QString fromParams(const QJsonObject& params, FrameOptions* out);
+    static const char* encodingName(Encoding encoding);
+};
+
+class FrameCapture {
+public:
+    // The window showing obj: obj itself, an item's window, or null.
+    static QQuickWindow* windowOf(QObject* obj);
+    // Current contents, scaled, as ARGB32 premultiplied; null image on failure.
+    static QImage grab(QQuickWindow* window, double scale);
+    // Part of a grab covered by item, in the grab's (scaled) pixels.
+    static QRect itemRect(QQuickItem* item, const QImage& grab, double scale);
+    // PNG or JPEG bytes; empty when the image format plugin is missing.
+    static QByteArray encode(const QImage& image, const FrameOptions& options);
+};
+
+// One subscribe_frames stream. The window's frameSwapped() marks it dirty;
+// at most maxFps times a second a dirty window is grabbed and compared with
+// the last delivered frame on a tileSize grid. Only changed tiles are
+// encoded, runs of adjacent changed tiles in a row as one rect, so a static
+// UI sends nothing and a blinking cursor sends one small tile. The first
+// frame, and any after a resize, is a single full-window keyframe.
+//
+// Delivered events: { kind:"frame", seq, width, height, encoding,
+// keyframe?, tiles:[{ x, y, width, height, data }] }, data being base64.
+class FrameStream {
+public:
+    using Deliver = std::function<void(const QJsonObject& event)>;
+
+    FrameStream(QQuickWindow* window, const FrameOptions& options, int maxFps, Deliver deliver);
+    ~FrameStream();
+    FrameStream(const FrameStream&) = delete;
+    FrameStream& operator=(const FrameStream&) = delete;
+
+    QSize frameSize() const;
+    quint64 framesSent() const { return m_seq; }
+    // The next frame is a keyframe, sent even if the window did not repaint;
+    // for a client that lost frames.
+    void requestKeyframe();
+
+private:
+    void onFrameSwapped();
+    void schedule();
+    void tick();
+    QJsonObject frameEvent(const QImage& image);
+
+    QPointer<QQuickWindow> m_window;
+    FrameOptions m_options;
+    int m_intervalMs { 100 };
+    Deliver m_deliver;
+    QTimer* m_timer { nullptr };     // paces grabs; also the context of the connection
+    QMetaObject::Connection m_swapped;
+    QImage m_last;                   // last delivered frame
+    QElapsedTimer m_clock;
+    qint64 m_lastGrabMs { -1 };
+    quint64 m_seq { 0 };
+    bool m_dirty { true };
+    bool m_grabbing { false };       // swaps caused by our own grab are ignored
+};
@@ -1,13 +1,40 @@
 #pragma once
 #include <QObject>
+#include <QCache>
+#include <QDeadlineTimer>
+#include <QElapsedTimer>
 #include <QHostAddress>
+#include <QJsonArray>
 #include <QJsonObject>
 #include <QHash>
+#include <QMap>
 #include <QPointer>
+#include <QQmlProperty>
+#include <QSharedPointer>
 #include <QStringList>
+#include <QVector>
+#include "ExpressionCache.hpp"
+#include "Metrics.hpp"
+#include "MethodInvoker.hpp"
+#include "SchemaCache.hpp"
+#include "Transport.hpp"
+#include "TreeWatcher.hpp"
+#include "VariantConverter.hpp"
+#include <functional>
+#include <utility>
 class QQmlApplicationEngine;
-class QWebSocketServer;
-class QWebSocket;
+class QTimer;
+class WireCodec;
+class ObjectRegistry;
+class ObjectIndex;
+class JobScheduler;
+class MetricsEndpoint;
+class Selector;
+class SelectorWalk;
+class ModelExport;
+class ModelWatcher;
+class SignalRelay;
+class FrameStream;
 
 class InspectorServer : public QObject {
     Q_OBJECT
@@ -18,9 +45,66 @@ public:
                     const QString& token = QString(),
                     QObject* parent = nullptr);
 
+    bool isListening() const;
+    quint16 serverPort() const;
+
+    // Also serves same-host clients on a local socket (Unix domain socket,
+    // named pipe on Windows) with length-prefixed frames instead of WebSocket
+    // framing; see LocalFrame. Same dispatcher and encodings as the
+    // WebSocket port. A relative name is placed in the temp directory; a
+    // stale socket file of that name is removed. Kept across setIoThreadEnabled().
+    bool listenLocal(const QString& name);
+    QString localServerName() const; // full path, empty when not listening locally
+
+    // Optional objectName/class-name index for find_by_name/find_by_type;
+    // off by default, built lazily on the first lookup once enabled.
+    void setObjectIndexEnabled(bool enabled);
+    bool isObjectIndexEnabled() const;
+
+    // Run networking, frame decoding and reply/event encoding on a dedicated
+    // I/O thread; handlers still run on this object's thread. Switching
+    // restarts the listener on the same address and port and drops
+    // connected clients, so set it right after construction.
+    void setIoThreadEnabled(bool enabled);
+    bool isIoThreadEnabled() const;
+
+    // Time spent per event-loop turn on heavy requests (recursive finds
+    // without the index, model_fetch); the rest of their work resumes on
+    // later turns. Default 2 ms.
+    void setJobBudgetMs(double ms);
+    double jobBudgetMs() const;
+
+    // Per-client bound on replies and events waiting for a slow reader; see
+    // OutboundLimits. Kept across setIoThreadEnabled().
+    void setOutboundLimits(const OutboundLimits& limits);
+    OutboundLimits outboundLimits() const { return m_outboundLimits; }
+
+    // Serves the stats RPC's metrics in Prometheus text format at
+    // http://<address>:<port>/metrics. Returns false when the port is taken
+    // or metrics were compiled out (QAB_ENABLE_METRICS=OFF).
+    bool startMetricsEndpoint(quint16 port, const QHostAddress& address = QHostAddress::LocalHost);
+    quint16 metricsPort() const;
+
+    // Property/return value conversion used by every reply and event. Register
+    // application value types and gadgets on variantConverter() before clients
+    // connect.
+    QJsonValue variantToJson(const QVariant& v) const { return m_converter.toJson(v); }
+    VariantConverter& variantConverter() { return m_converter; }
+
 private:
     QQmlApplicationEngine* m_engine { nullptr };
-    QWebSocketServer* m_server { nullptr };
+    Transport* m_transport { nullptr };
+    OutboundLimits m_outboundLimits;
+    QHostAddress m_address;
+    QString m_localName; // as passed to listenLocal()
+    ObjectRegistry* m_registry { nullptr };
+    ObjectIndex* m_index { nullptr };
+    TreeWatcher* m_tree { nullptr }; // started by the first snapshot_tree or subscribe_tree
+    JobScheduler* m_jobs { nullptr };
+    Metrics m_metrics;
+    MetricsEndpoint* m_metricsEndpoint { nullptr };
+    SchemaCache m_schemas;
+    VariantConverter m_converter;
     QString m_token;
 
     struct SubscriptionInfo {
@@ -29,26 +113,186 @@ private:
         QString name;            // signal signature or property name
         QString objectId;        // cached string id for sender
         int signalIndex { -1 };  // senderSignalIndex for matching
-        QPointer<QObject> target;
-        QMetaObject::Connection connection;
+        QPointer<QObject> target;    // the emitting object: for grouped properties the group, not the item
+        QQmlProperty property;       // property kind: read for each event
+        quint64 client { 0 };
         QStringList snapshotProperties; // for signal kind, include these props in event
+        bool captureArgs { false };      // signal kind: include the emission's arguments
+        QJsonArray lastArgs;             // arguments of the latest emission, for deferred deliveries
+        QString payloadKey;      // subscriptions with equal keys share one serialized event body
+        QObject* sender { nullptr }; // dispatch key, captured at subscribe time
+        // Rate limiting: emissions inside the window are folded into one
+        // delivery carrying the latest state and a "dropped" count.
+        bool coalesce { false };     // defer delivery to the end of the event-loop turn
+        int minIntervalMs { 0 };
+        qint64 lastDeliveredMs { -1 };
+        quint32 dropped { 0 };
+        quint64 delivered { 0 };     // events sent, reported by stats
+        bool scheduled { false };    // queued in m_throttled
+        bool isThrottled() const { return coalesce || minIntervalMs > 0; }
+    };
+    using SubscriptionPtr = QSharedPointer<SubscriptionInfo>;
+
+    // Dispatch index: one connection per (sender, signal index), holding every
+    // subscription that has to be notified when that signal fires. Buckets of a
+    // sender are dropped together when the registry reports it destroyed.
+    struct DispatchBucket {
+        QVector<SubscriptionPtr> subscriptions;
+        QMetaObject::Connection connection;
+        QVector<int> argTypes; // signal parameter metatype ids, resolved once at connect
+    };
+
+    // A query that stopped at its limit or visit budget, resumed by cursor.
+    struct QueryCursor {
+        QSharedPointer<SelectorWalk> walk;
+        QStringList fields;
     };
 
-    // Per-client subscriptions keyed by subscriptionId
-    QHash<QWebSocket*, QHash<QString, SubscriptionInfo>> m_subscriptions;
+    struct ModelSubscription {
+        QString objectId;
+        QSharedPointer<ModelWatcher> watcher;
+    };
+
+    struct TreeSubscription {
+        QObject* root { nullptr }; // only compared against the mirror, may dangle
+        bool scoped { false };     // false: every tree
+    };
+
+    struct Waiter; // a parked wait_for, defined in the .cpp
+    struct ClientState {
+        const WireCodec* codec { nullptr };        // negotiated encoding, null = JSON
+        const WireCodec* pendingCodec { nullptr }; // switched to after the hello reply
+        QHash<QString, SubscriptionPtr> subscriptions; // keyed by subscriptionId
+        QMap<quint64, QueryCursor> cursors;            // oldest first, bounded per client
+        QMap<QString, QSharedPointer<ModelExport>> exports; // streaming model_export, by exportId
+        QHash<QString, ModelSubscription> modelSubscriptions; // subscribe_model, by subscriptionId
+        QHash<QString, QSharedPointer<Waiter>> waiters; // wait_for, by request id
+        QHash<QString, TreeSubscription> treeSubscriptions; // subscribe_tree, by subscriptionId
+        QHash<QString, QSharedPointer<FrameStream>> frameSubscriptions; // subscribe_frames, by subscriptionId
+    };
+
+    QHash<quint64, ClientState> m_clients; // by transport client id
+    QHash<QObject*, QHash<int, DispatchBucket>> m_dispatch;
     quint64 m_nextSubId { 1 };
+    SignalRelay* m_signalRelay { nullptr };
+
+    // Compiled selectors by text, shared with the cursors still using them.
+    QCache<QString, QSharedPointer<const Selector>> m_selectors;
+    quint64 m_selectorCompiles { 0 };
+    // evaluate and call_method
+    ExpressionCache m_expressions;
+    MethodInvoker m_invoker;
+    quint64 m_nextCursorId { 1 };
 
-    void handleTextMessage(QWebSocket* client, const QString& text);
+    // Subscriptions with a delivery deferred by coalescing or rate limits.
+    QVector<SubscriptionPtr> m_throttled;
+    QTimer* m_throttleTimer { nullptr };
+    QElapsedTimer m_clock;
+
+    // Streaming model exports advance one chunk each per event-loop turn.
+    QTimer* m_exportTimer { nullptr };
+    quint64 m_nextExportId { 1 };
+
+    // subscribe_model changes are coalesced until the next event-loop turn.
+    QTimer* m_modelFlushTimer { nullptr };
+
+    // RPC dispatch: every method is a handler in m_handlers, looked up by name.
+    struct RpcContext {
+        quint64 client { 0 };
+        QString id;
+        int metricsSlot { Metrics::kUnknownSlot };
+    };
+    struct RpcResult;
+    // Resumes a deferred handler: works until the deadline and returns true
+    // once *out holds the final result.
+    using RpcContinuation = std::function<bool(const QDeadlineTimer& deadline, RpcResult* out)>;
+    struct RpcResult {
+        QJsonObject result;
+        QString errorCode;
+        QString errorMessage;
+        RpcContinuation continuation; // set when the handler finishes on m_jobs
+        bool isParked { false };      // the handler sends the reply itself, later
+        bool isError() const { return !errorCode.isEmpty(); }
+        bool isDeferred() const { return bool(continuation); }
+        static RpcResult ok(const QJsonObject& result = {}) { return RpcResult{result, {}, {}, {}}; }
+        static RpcResult error(const QString& code, const QString& message) { return RpcResult{{}, code, message, {}}; }
+        static RpcResult deferred(RpcContinuation c) { return RpcResult{{}, {}, {}, std::move(c)}; }
+        static RpcResult parked() { return RpcResult{{}, {}, {}, {}, true}; }
+    };
+    using RpcHandler = RpcResult (InspectorServer::*)(const RpcContext&, const QJsonObject& params);
+    QHash<QString, RpcHandler> m_handlers;
+    QStringList m_methodNames; // registration order, reported by hello
+
+    void registerMethod(const QString& name, RpcHandler handler);
+    void registerBuiltinMethods();
+    void attachTransport(Transport* transport, quint16 port);
+    void onClientDisconnected(quint64 client);
+    void onEventsLost(quint64 client, const QStringList& subscriptionIds);
+    void handleMessage(quint64 client, const QJsonValue& msg);
+    RpcResult dispatch(const RpcContext& ctx, const QString& method, const QJsonObject& params);
+    void sendReply(const RpcContext& ctx, const RpcResult& r);
+    void scheduleReply(const RpcContext& ctx, const RpcContinuation& continuation);
+    void recordExecution(int metricsSlot, const RpcResult& r, qint64 ns);
+    qint64 guiThreadNs() const;
+    QByteArray renderPrometheus() const;
+    const WireCodec* codecFor(quint64 client) const;
+    void sendMessage(quint64 client, const QJsonValue& message, int metricsSlot = Metrics::kUnknownSlot);
+    RpcContinuation batchContinuation(quint64 client, const QJsonArray& requests, bool stopOnError);
     QJsonObject replyOk(const QString& id, const QJsonObject& result = {});
     QJsonObject replyErr(const QString& id, const QString& code, const QString& message);
 
+    RpcResult rpcHello(const RpcContext& ctx, const QJsonObject& params);
+    RpcResult rpcListRoots(const RpcContext& ctx, const QJsonObject& params);
+    RpcResult rpcFindByName(const RpcContext& ctx, const QJsonObject& params);
+    RpcResult rpcFindByType(const RpcContext& ctx, const QJsonObject& params);
+    RpcResult rpcListChildren(const RpcContext& ctx, const QJsonObject& params);
+    RpcResult rpcInspect(const RpcContext& ctx, const QJsonObject& params);
+    RpcResult rpcGetSchema(const RpcContext& ctx, const QJsonObject& params);
+    RpcResult rpcModelInfo(const RpcContext& ctx, const QJsonObject& params);
+    RpcResult rpcModelFetch(const RpcContext& ctx, const QJsonObject& params);
+    RpcResult rpcModelExport(const RpcContext& ctx, const QJsonObject& params);
+    RpcResult rpcModelExportCancel(const RpcContext& ctx, const QJsonObject& params);
+    RpcResult rpcSetProperty(const RpcContext& ctx, const QJsonObject& params);
+    RpcResult rpcSetProperties(const RpcContext& ctx, const QJsonObject& params);
+    RpcResult rpcCallMethod(const RpcContext& ctx, const QJsonObject& params);
+    RpcResult rpcEvaluate(const RpcContext& ctx, const QJsonObject& params);
+    RpcResult rpcSubscribeSignal(const RpcContext& ctx, const QJsonObject& params);
+    RpcResult rpcSubscribeProperty(const RpcContext& ctx, const QJsonObject& params);
+    RpcResult rpcSubscribeModel(const RpcContext& ctx, const QJsonObject& params);
+    RpcResult rpcUnsubscribe(const RpcContext& ctx, const QJsonObject& params);
+    RpcResult rpcBatch(const RpcContext& ctx, const QJsonObject& params);
+    RpcResult rpcResolve(const RpcContext& ctx, const QJsonObject& params);
+    RpcResult rpcStats(const RpcContext& ctx, const QJsonObject& params);
+    RpcResult rpcQuery(const RpcContext& ctx, const QJsonObject& params);
+    RpcResult rpcCancel(const RpcContext& ctx, const QJsonObject& params);
+    RpcResult rpcWaitFor(const RpcContext& ctx, const QJsonObject& params);
+    RpcResult rpcSnapshotTree(const RpcContext& ctx, const QJsonObject& params);
+    RpcResult rpcSubscribeTree(const RpcContext& ctx, const QJsonObject& params);
+    RpcResult rpcCapture(const RpcContext& ctx, const QJsonObject& params);
+    RpcResult rpcSubscribeFrames(const RpcContext& ctx, const QJsonObject& params);
+
     // helpers
-    static QString idForObject(QObject* obj);
-    static QObject* objectFromId(const QString& id);
-    static QJsonValue variantToJson(const QVariant& v);
-    QJsonObject inspectObject(QObject* obj);
+    QString idForObject(QObject* obj);
+    QObject* objectFromId(const QString& id) const;
+    QJsonObject describeObject(QObject* obj); // {objectId, type, objectName}
+    QJsonObject projectObject(QObject* obj, const QStringList& fields);
+    QJsonObject inspectObject(QObject* obj, bool valuesOnly = false);
     QJsonObject evaluateOnObject(QObject* obj, const QString& expression);
+    bool addSubscription(const SubscriptionPtr& info);
+    QString applyRateOptions(SubscriptionInfo& info, const QJsonObject& params); // error message or empty
+    QJsonObject subscriptionReply(const SubscriptionInfo& info) const;
+    QJsonObject eventBody(const SubscriptionInfo& info, QObject* sender, const QJsonArray& args) const;
+    QJsonArray signalArguments(const QVector<int>& types, void** argv) const;
+    void onSignalTriggered(QObject* sender, int signalIndex, void** argv);
+    void deliverEvent(SubscriptionInfo& info);
+    void scheduleThrottled(int delayMs);
+    void removeSubscription(const SubscriptionPtr& info);
+    bool evaluateWaiter(Waiter& waiter, RpcResult* out);
+    void finishWaiter(const QSharedPointer<Waiter>& waiter, const RpcResult& r);
+    void deliverTreeChanges(const QVector<TreeWatcher::Change>& changes);
 
 private slots:
-    void onSignalTriggered();
+    void onExportTick();
+    void flushModelChanges();
+    void flushThrottled();
 };
@@ -0,0 +1,74 @@
+#pragma once
+#include <QThread>
+#include <atomic>
+#include "MpscQueue.hpp"
+#include "Transport.hpp"
+
+// Runs a WebSocketTransport on a dedicated I/O thread, so frame parsing,
+// encoding and socket writes stay off the thread that renders the UI.
+//
+// Decoded requests and connection changes cross to the owning thread through
+// one lock-free queue (keeping their order), replies and events go back
+// through another. Each side is woken at most once per batch. The owning
+// thread handles inbound messages in time-boxed slices and yields to the
+// event loop in between, so a burst of requests does not starve rendering.
+class IoThreadTransport : public Transport {
+    Q_OBJECT
+public:
+    explicit IoThreadTransport(QObject* parent = nullptr);
+    ~IoThreadTransport() override;
+
+    bool listen(const QHostAddress& address, quint16 port) override;
+    bool listenLocal(const QString& name) override;
+    void close() override;
+    bool isListening() const override { return m_listening.load(); }
+    quint16 serverPort() const override { return m_port.load(); }
+    QString localServerName() const override { return m_localName; }
+    bool usesIoThread() const override { return true; }
+
+    void send(quint64 clientId, const QJsonValue& message, const WireCodec* codec,
+              int metricsSlot = Metrics::kUnknownSlot) override;
+    void sendEvent(quint64 clientId, const QString& subscriptionId, const QJsonObject& body,
+                   const WireCodec* codec, QByteArray* encodedBody = nullptr, bool coalescable = true) override;
+
+    // Applied and read on the I/O thread, which owns the outbound queues.
+    void setOutboundLimits(const OutboundLimits& limits) override;
+    OutboundReport outboundReport() const override;
+    void setMetrics(Metrics* metrics) override;
+
+    // Longest stretch spent handling inbound messages before yielding.
+    void setDispatchBudgetMs(int ms) { m_dispatchBudgetMs = ms; }
+
+private:
+    struct Inbound {
+        enum Kind { Connected, Disconnected, Message, EventsLost };
+        Kind kind { Message };
+        quint64 clientId { 0 };
+        QJsonValue message;
+        QStringList subscriptionIds; // EventsLost
+    };
+    struct Outbound {
+        quint64 clientId { 0 };
+        const WireCodec* codec { nullptr };
+        QString subscriptionId; // non-empty for events, whose message is the params body
+        int metricsSlot { Metrics::kUnknownSlot };
+        QJsonValue message;
+        bool coalescable { true };
+    };
+
+    void postInbound(Inbound in);      // I/O thread
+    void postOutbound(Outbound out);   // owning thread
+    void drainInbound();               // owning thread
+    void drainOutbound();              // I/O thread
+
+    QThread m_thread;
+    WebSocketTransport* m_worker { nullptr }; // lives on m_thread
+    MpscQueue<Inbound> m_inbound;
+    MpscQueue<Outbound> m_outbound;
+    std::atomic<bool> m_inboundWake { false };
+    std::atomic<bool> m_outboundWake { false };
+    std::atomic<bool> m_listening { false };
+    std::atomic<quint16> m_port { 0 };
+    QString m_localName; // owning thread only
+    int m_dispatchBudgetMs { 4 };
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include <QDeadlineTimer>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QQueue>
+#include <QString>
+#include <functional>
+class QTimer;
+
+// Cooperative scheduler for RPCs that would otherwise block the event loop.
+// A job is a resumable step function: each call does as much work as fits
+// before the deadline and returns true once finished. Once per event-loop
+// turn the scheduler spends at most budgetMs() on jobs, rotating through
+// clients so one client's heavy requests cannot starve the others; within
+// a client, jobs run in submission order.
+class JobScheduler : public QObject {
+public:
+    using Step = std::function<bool(const QDeadlineTimer& deadline)>;
+    using Done = std::function<void()>;
+
+    struct Stats {
+        quint64 submitted { 0 };
+        quint64 completed { 0 };
+        quint64 cancelled { 0 };
+        quint64 slices { 0 };      // event-loop turns that ran jobs
+        quint64 steps { 0 };       // step calls across all jobs
+        qint64 busyNs { 0 };       // total time spent in slices
+        qint64 maxSliceNs { 0 };
+        int maxQueued { 0 };
+    };
+
+    explicit JobScheduler(QObject* parent = nullptr);
+
+    void setBudgetMs(double ms);
+    double budgetMs() const { return m_budgetNs / 1e6; }
+
+    // onDone runs on completion (not on cancellation).
+    void submit(quint64 client, const QString& requestId, Step step, Done onDone);
+    bool cancel(quint64 client, const QString& requestId);
+    void cancelClient(quint64 client);
+
+    int queued() const { return m_queued; }
+    int activeClients() const { return m_order.size(); }
+    const Stats& stats() const { return m_stats; }
+
+private:
+    struct Job {
+        QString requestId;
+        Step step;
+        Done onDone;
+    };
+
+    void runSlice();
+
+    QHash<quint64, QQueue<Job>> m_queues;
+    QList<quint64> m_order; // clients with pending jobs, next to run first
+    QTimer* m_timer { nullptr };
+    qint64 m_budgetNs { 2000000 };
+    int m_queued { 0 };
+    Stats m_stats;
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include <QHash>
+#include <QJsonArray>
+#include <QString>
+#include <QVariant>
+class ObjectRegistry;
+class QObject;
+struct QMetaObject;
+
+// call_method without a JS round trip: the QMetaMethod for (class, name,
+// argument count) is resolved once, and each call converts the JSON
+// arguments to the method's parameter types and invokes it directly.
+// String arguments to QObject-pointer parameters are resolved as object ids.
+// Calls it cannot handle (no such public method, an argument that does not
+// convert, more than ten arguments) report NotApplicable so the caller can
+// fall back to evaluating a QML call.
+class MethodInvoker {
+public:
+    enum class Outcome { Invoked, NotApplicable, Failed };
+
+    struct Stats {
+        quint64 invoked { 0 };
+        quint64 notApplicable { 0 };
+        int resolved { 0 }; // cached (class, name, argc) lookups
+    };
+
+    explicit MethodInvoker(ObjectRegistry* registry = nullptr);
+
+    // On Invoked, *result holds the return value (invalid for void methods).
+    Outcome invoke(QObject* target, const QString& name, const QJsonArray& args, QVariant* result);
+
+    const Stats& stats() const { return m_stats; }
+
+private:
+    struct Key {
+        const QMetaObject* metaObject;
+        QString name;
+        int argc;
+        bool operator==(const Key& o) const { return metaObject == o.metaObject && argc == o.argc && name == o.name; }
+    };
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    friend size_t qHash(const Key& key, size_t seed) { return qHashMulti(seed, key.metaObject, key.name, key.argc); }
+#else
+    friend uint qHash(const Key& key, uint seed) { return qHash(key.argc, qHash(key.name, qHash(key.metaObject, seed))); }
+#endif
+
+    int resolve(const QMetaObject* mo, const QString& name, int argc); // method index or -1
+    bool convertArg(const QJsonValue& arg, int type, QVariant* out) const;
+
+    ObjectRegistry* m_registry { nullptr };
+    QHash<Key, int> m_methods;
+    Stats m_stats;
+};
@@ -0,0 +1,137 @@
+#pragma once
+#include <QByteArray>
+#include <QHash>
+#include <QJsonObject>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QJsonValue>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+// Fixed-bucket latency histogram, safe to record into from any thread.
+class LatencyHistogram {
+public:
+    // Upper bounds in nanoseconds, 10 µs to 100 ms; one more bucket holds the rest.
+    static constexpr int kBounds = 13;
+    static const std::array<qint64, kBounds>& boundsNs();
+
+    void record(qint64 ns);
+    quint64 count() const { return m_count.load(std::memory_order_relaxed); }
+    qint64 sumNs() const { return qint64(m_sumNs.load(std::memory_order_relaxed)); }
+    quint64 bucket(int i) const { return m_buckets[i].load(std::memory_order_relaxed); }
+    // Upper bound of the bucket holding quantile q; -1 when empty or past the last bound.
+    qint64 quantileNs(double q) const;
+
+private:
+    std::array<std::atomic<quint64>, kBounds + 1> m_buckets {};
+    std::atomic<quint64> m_count { 0 };
+    std::atomic<quint64> m_sumNs { 0 };
+};
+
+// Always-on counters for the bridge's own cost: per-method latency by phase,
+// bytes and frames in/out, event fan-out and time spent on the GUI thread.
+// Recording is a few relaxed atomic adds, so the transport's I/O thread can
+// record too. Methods are given slots before clients connect and are looked
+// up without locking afterwards.
+//
+// Configure with -DQAB_ENABLE_METRICS=OFF to compile recording out: every
+// entry point below then returns immediately and now() never reads the clock.
+class Metrics {
+public:
+#ifdef QAB_ENABLE_METRICS
+    static constexpr bool kEnabled = true;
+#else
+    static constexpr bool kEnabled = false;
+#endif
+    enum Phase { Parse, Execute, Encode, Send, PhaseCount };
+
+    // Frames that are not a request of a known method, and event frames.
+    static constexpr int kUnknownSlot = 0;
+    static constexpr int kEventSlot = 1;
+
+    Metrics();
+
+    static qint64 now()
+    {
+        if (!kEnabled) return 0;
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    int addMethod(const QString& name);
+    int slotFor(const QString& method) const { return m_slotByName.value(method, kUnknownSlot); }
+    int slotFor(const QJsonValue& request) const; // a decoded request frame
+
+    void recordPhase(int slot, Phase phase, qint64 ns)
+    {
+        if (!kEnabled) return;
+        m_methods[size_t(validSlot(slot))]->phases[phase].record(ns);
+    }
+    void recordError(int slot)
+    {
+        if (!kEnabled) return;
+        m_methods[size_t(validSlot(slot))]->errors.fetch_add(1, std::memory_order_relaxed);
+    }
+    void recordIn(qint64 bytes) { addFrame(m_framesIn, m_bytesIn, bytes); }
+    void recordOut(qint64 bytes) { addFrame(m_framesOut, m_bytesOut, bytes); }
+    void recordFanout(int deliveries);
+
+    // Times the outermost scope on the GUI thread; nested scopes add nothing.
+    class GuiScope {
+    public:
+        explicit GuiScope(Metrics& metrics) : m_metrics(metrics)
+        {
+            if (kEnabled && m_metrics.m_guiDepth++ == 0) m_start = now();
+        }
+        ~GuiScope()
+        {
+            if (kEnabled && --m_metrics.m_guiDepth == 0) m_metrics.m_guiNs += now() - m_start;
+        }
+        GuiScope(const GuiScope&) = delete;
+        GuiScope& operator=(const GuiScope&) = delete;
+
+    private:
+        Metrics& m_metrics;
+        qint64 m_start { 0 };
+    };
+
+    qint64 guiNs() const { return m_guiNs; }
+    qint64 phaseTotalNs(Phase phase) const;
+
+    QJsonObject toJson() const;
+    // Text exposition format 0.0.4. GUI-thread time is measured by the caller
+    // (it includes job slices); `gauges` are extra name/value samples.
+    QByteArray toPrometheus(double guiThreadSeconds, const QList<QPair<QByteArray, double>>& gauges) const;
+
+private:
+    struct MethodStats {
+        QString name;
+        std::array<LatencyHistogram, PhaseCount> phases;
+        std::atomic<quint64> errors { 0 };
+    };
+
+    int validSlot(int slot) const { return slot >= 0 && size_t(slot) < m_methods.size() ? slot : kUnknownSlot; }
+    static void addFrame(std::atomic<quint64>& frames, std::atomic<quint64>& bytes, qint64 size)
+    {
+        if (!kEnabled) return;
+        frames.fetch_add(1, std::memory_order_relaxed);
+        bytes.fetch_add(quint64(size), std::memory_order_relaxed);
+    }
+
+    std::vector<std::unique_ptr<MethodStats>> m_methods; // by slot
+    QHash<QString, int> m_slotByName;
+    std::atomic<quint64> m_bytesIn { 0 };
+    std::atomic<quint64> m_bytesOut { 0 };
+    std::atomic<quint64> m_framesIn { 0 };
+    std::atomic<quint64> m_framesOut { 0 };
+    // Deliveries per signal emission, in power-of-two buckets up to 1024 and one more for the rest.
+    std::array<std::atomic<quint64>, 12> m_fanout {};
+    std::atomic<quint64> m_events { 0 };
+    // GUI thread only.
+    int m_guiDepth { 0 };
+    qint64 m_guiNs { 0 };
+};
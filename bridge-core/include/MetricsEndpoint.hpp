@@ -0,0 +1,26 @@
+#pragma once
+#include <QByteArray>
+#include <QHostAddress>
+#include <QObject>
+#include <functional>
+class QTcpServer;
+class QTcpSocket;
+
+// Minimal HTTP/1.0 listener for Prometheus scrapes: GET /metrics answers
+// with the text produced by the render callback, anything else with 404.
+// One request per connection; runs on the owning thread.
+class MetricsEndpoint : public QObject {
+public:
+    using Render = std::function<QByteArray()>;
+
+    MetricsEndpoint(Render render, QObject* parent = nullptr);
+
+    bool listen(const QHostAddress& address, quint16 port);
+    quint16 serverPort() const;
+
+private:
+    void respond(QTcpSocket* socket);
+
+    Render m_render;
+    QTcpServer* m_server { nullptr };
+};
@@ -0,0 +1,51 @@
+#pragma once
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QMetaObject>
+#include <QPointer>
+#include <QString>
+#include <QVector>
+class QAbstractItemModel;
+class VariantConverter;
+
+struct ModelRole {
+    int id { -1 };
+    QString name;
+};
+
+// Chunked, columnar export of one model column. Role names are reported
+// once up front; each chunk then carries one value array per role, so a
+// large model is never materialized as a whole. Row inserts, removals,
+// moves, resets and layout changes invalidate the export, since the
+// remaining row numbers would no longer mean the same rows.
+class ModelExport {
+public:
+    ModelExport(QAbstractItemModel* model, const QVector<ModelRole>& roles, int column,
+                int start, int end, int chunkSize, const VariantConverter* convert);
+    ~ModelExport();
+    ModelExport(const ModelExport&) = delete;
+    ModelExport& operator=(const ModelExport&) = delete;
+
+    // Requested role names (or all roles, ordered by role id) resolved once
+    // through an inverted roleNames() table; unknown names are skipped.
+    static QVector<ModelRole> resolveRoles(const QAbstractItemModel* model, const QJsonValue& names);
+
+    // { start, count, values[[role 0 values], [role 1 values], ...] }
+    QJsonObject nextChunk();
+
+    bool isDone() const { return m_next >= m_end; }
+    // Empty while the export is valid, otherwise "model_changed" or "model_destroyed".
+    QString abortReason() const;
+    int nextRow() const { return m_next; }
+
+private:
+    QPointer<QAbstractItemModel> m_model;
+    QVector<ModelRole> m_roles;
+    int m_column { 0 };
+    int m_next { 0 };
+    int m_end { 0 };
+    int m_chunkSize { 1 };
+    const VariantConverter* m_convert { nullptr };
+    bool m_changed { false };
+    QVector<QMetaObject::Connection> m_connections;
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include <QJsonArray>
+#include <QMetaObject>
+#include <QPointer>
+#include <QVector>
+#include <functional>
+#include "ModelExport.hpp"
+class QAbstractItemModel;
+
+// Change feed behind subscribe_model. Row inserts, removals, moves, data
+// changes, resets and layout changes of the top-level rows are queued as
+// compact ops and handed out once per event-loop turn by takeChanges().
+// Within a turn adjacent or overlapping ranges of the same kind are merged,
+// data changes inside a pending insert are folded into it, and a reset or
+// layout change replaces everything queued before it.
+//
+// Values (optional) are read when changes are taken, except that pending
+// ranges are read early, from the rowsAboutToBe* signals, when an insert,
+// removal or move is about to shift their rows.
+class ModelWatcher {
+public:
+    ModelWatcher(QAbstractItemModel* model, const QVector<ModelRole>& roles, bool includeValues,
+                 int column, const VariantConverter* convert, std::function<void()> onPending);
+    ~ModelWatcher();
+    ModelWatcher(const ModelWatcher&) = delete;
+    ModelWatcher& operator=(const ModelWatcher&) = delete;
+
+    bool hasPending() const { return !m_pending.isEmpty() || m_destroyed; }
+    bool isModelDestroyed() const { return m_destroyed; }
+    int rowCount() const;
+
+    // [{ op, start?, end?, destination?, roles?, values? }], oldest first.
+    QJsonArray takeChanges();
+
+private:
+    enum Op { Insert, Remove, Move, Data, Reset, Layout };
+    struct Change {
+        Op op { Data };
+        int start { 0 };
+        int end { -1 };
+        int destination { -1 };
+        QVector<int> roles;   // Data only; empty = every subscribed role
+        bool read { false };  // values already captured
+        QJsonArray values;
+    };
+
+    void push(const Change& change);
+    void readPending(int fromRow); // pending ranges reaching fromRow or beyond
+    void readValues(Change& change) const;
+    QJsonObject toJson(Change& change) const;
+
+    QPointer<QAbstractItemModel> m_model;
+    QVector<ModelRole> m_roles;
+    bool m_includeValues { false };
+    int m_column { 0 };
+    const VariantConverter* m_convert { nullptr };
+    std::function<void()> m_onPending;
+    QVector<Change> m_pending;
+    bool m_destroyed { false };
+    QVector<QMetaObject::Connection> m_connections;
+};
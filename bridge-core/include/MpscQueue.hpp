@@ -0,0 +1,49 @@
+#pragma once
+#include <atomic>
+#include <utility>
+
+// Unbounded multi-producer / single-consumer queue (Vyukov's linked design).
+// push() is wait-free and may be called from any thread; tryPop() is
+// lock-free and must only be called from the one consumer thread.
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() : m_head(new Node), m_tail(m_head.load(std::memory_order_relaxed)) {}
+    ~MpscQueue()
+    {
+        T discard;
+        while (tryPop(discard)) {}
+        delete m_tail;
+    }
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void push(T value)
+    {
+        Node* node = new Node;
+        node->value = std::move(value);
+        Node* prev = m_head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // False when empty, or while a concurrent push has not linked its node yet.
+    bool tryPop(T& out)
+    {
+        Node* tail = m_tail;
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (!next) return false;
+        out = std::move(next->value);
+        m_tail = next;
+        delete tail;
+        return true;
+    }
+
+private:
+    struct Node {
+        T value {};
+        std::atomic<Node*> next { nullptr };
+    };
+
+    std::atomic<Node*> m_head; // producers
+    Node* m_tail;              // consumer; a stub whose successor is the front
+};
@@ -0,0 +1,76 @@
+#pragma once
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSet>
+
+// Optional objectName / class-name index over the object trees below the
+// engine roots, so find_by_name and find_by_type do not walk the tree.
+//
+// Built lazily on first lookup and kept current through objectNameChanged and
+// destroyed(). ChildAdded/ChildRemoved events and, for Qt Quick items,
+// childrenChanged() only mark the parent dirty; the next lookup diffs each
+// dirty parent's children() against the mirrored list, like TreeWatcher, so
+// objects are indexed once construction finished and a reparent is a move
+// rather than a removal. childrenChanged() also dirties the item's QObject
+// parent, which is where QML's object creator puts items (without
+// ChildAdded) that Loader, Repeater or createObject() attach visually.
+//
+// Lookups never walk the tree. Matches are the roots' descendants, as with
+// QObject::findChildren(); the roots themselves are not matched.
+class ObjectIndex : public QObject {
+    Q_OBJECT
+public:
+    struct Stats {
+        quint64 lookups { 0 };
+        quint64 hits { 0 };    // found at least one match
+        quint64 misses { 0 };  // found none
+        quint64 builds { 0 };
+        quint64 resyncs { 0 }; // dirty parents diffed
+    };
+
+    explicit ObjectIndex(QObject* parent = nullptr);
+
+    QList<QObject*> findByName(const QList<QObject*>& roots, const QString& name);
+    QList<QObject*> findByType(const QList<QObject*>& roots, const QString& className);
+
+    void clear();
+    bool isBuilt() const { return m_built; }
+    int trackedCount() const { return int(m_tracked.size()); }
+    const Stats& stats() const { return m_stats; }
+
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override;
+
+private slots:
+    void onObjectNameChanged(const QString& name);
+    void onDestroyed(QObject* obj);
+    void onChildrenChanged();
+
+private:
+    struct Tracked {
+        QString name;
+        QString type;
+        QObject* parent { nullptr }; // null for roots
+        QObjectList children;        // as of the last sync
+    };
+
+    void sync(const QList<QObject*>& roots);
+    void resync(const QSet<QObject*>& dirty);
+    void markDirty(QObject* obj);
+    void trackSubtree(QObject* obj, QObject* parent);
+    void track(QObject* obj, QObject* parent);
+    void untrackSubtree(QObject* obj);
+    void untrack(QObject* obj);
+    QList<QObject*> lookup(const QMultiHash<QString, QObject*>& table, const QString& key,
+                           const QList<QObject*>& roots);
+
+    QHash<QObject*, Tracked> m_tracked;
+    QMultiHash<QString, QObject*> m_byName;
+    QMultiHash<QString, QObject*> m_byType;
+    QObjectList m_roots;
+    QSet<QObject*> m_dirtyParents; // children may have changed since the last lookup
+    Stats m_stats;
+    int m_childrenChangedSlot { -1 };
+    bool m_built { false };
+};
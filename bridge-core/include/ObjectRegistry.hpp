@@ -0,0 +1,47 @@
+#pragma once
+#include <QHash>
+#include <QObject>
+#include <QString>
+
+// Maps live QObjects to opaque "qobj:<handle>" ids. Handles are handed out
+// from a monotonically increasing counter and never reused, so an id that
+// outlived its object (e.g. after a Loader swap) resolves to nothing instead
+// of to whatever now lives at the same address. Entries are pruned on
+// destroyed().
+class ObjectRegistry : public QObject {
+    Q_OBJECT
+public:
+    struct Entry {
+        quint64 handle { 0 };
+        QObject* object { nullptr };
+        const QMetaObject* metaObject { nullptr }; // cached at registration
+        QString id;
+        QString className;
+    };
+
+    explicit ObjectRegistry(QObject* parent = nullptr);
+
+    // Registers obj on first use; the reference stays valid until the next ensure().
+    const Entry& ensure(QObject* obj);
+    QString idFor(QObject* obj) { return obj ? ensure(obj).id : QString(); }
+
+    // O(1); null for malformed, unknown or destroyed ids.
+    const Entry* find(const QString& id) const;
+    QObject* resolve(const QString& id) const;
+
+    int size() const { return int(m_byHandle.size()); }
+
+signals:
+    // Emitted after the entry of a destroyed object has been dropped.
+    void objectReleased(QObject* obj);
+
+private slots:
+    void onDestroyed(QObject* obj);
+
+private:
+    static quint64 parseHandle(const QString& id);
+
+    QHash<quint64, Entry> m_byHandle;
+    QHash<QObject*, quint64> m_byObject;
+    quint64 m_nextHandle { 1 };
+};
@@ -0,0 +1,32 @@
+#pragma once
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVector>
+struct QMetaObject;
+
+// Per-class description of what inspect reports (declared properties, methods,
+// signals), built once per QMetaObject and shared by every instance. Thousands
+// of delegates of one QML type then cost one schema instead of one each.
+struct ClassSchema {
+    QString schemaId;            // "schema:<n>", stable for the process lifetime
+    QString className;
+    QVector<int> propertyIndices; // metaobject indices, positional order of "values"
+    QStringList propertyNames;
+    QJsonArray methods;
+    QJsonArray signalList;
+    QJsonObject json;            // what get_schema returns
+};
+
+class SchemaCache {
+public:
+    const ClassSchema& forMetaObject(const QMetaObject* mo);
+    const ClassSchema* find(const QString& schemaId) const;
+    int size() const { return int(m_byId.size()); }
+
+private:
+    QHash<const QMetaObject*, QSharedPointer<ClassSchema>> m_byMeta;
+    QVector<QSharedPointer<ClassSchema>> m_byId; // schema:<n> lives at n - 1
+};
@@ -0,0 +1,96 @@
+#pragma once
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QString>
+#include <QVarLengthArray>
+#include <QVector>
+struct QMetaObject;
+
+// Compiled query selector, e.g.
+//
+//   ApplicationWindow > ColumnLayout Button#ok[enabled=true]:nth(1)
+//
+// A selector is a chain of compounds joined by descendant (whitespace) or
+// child (">") combinators; a leading ">" anchors the first compound to the
+// direct children of the scope. A compound holds any of:
+//   Type or *          metaobject class name or a superclass of it; QML
+//                      types also match without their _QMLTYPE_<n> suffix
+//   #name              objectName (bare or quoted)
+//   [prop]             property exists / is non-null
+//   [prop<op>value]    = != ^= $= *= < <= > >=, numeric when value is a number
+//   :nth(n)            n-th (0-based) sibling matching the rest of the compound
+class Selector {
+public:
+    struct Predicate {
+        enum Op { Exists, Equals, NotEquals, Prefix, Suffix, Contains, Less, LessEqual, Greater, GreaterEqual };
+        QByteArray property;
+        Op op { Exists };
+        QString value;
+        double number { 0 };
+        bool numeric { false };
+    };
+    struct Compound {
+        QByteArray type;   // empty = any
+        QString name;
+        bool hasName { false };
+        QVector<Predicate> predicates;
+        int nth { -1 };
+        bool child { false }; // joined to the previous compound (or the scope) by ">"
+    };
+
+    static constexpr int kMaxCompounds = 64;
+
+    // Returns null and sets *error on a syntax error.
+    static QSharedPointer<const Selector> compile(const QString& text, QString* error);
+
+    const QString& text() const { return m_text; }
+    const QVector<Compound>& compounds() const { return m_compounds; }
+    bool usesNth() const { return m_usesNth; }
+
+private:
+    QString m_text;
+    QVector<Compound> m_compounds;
+    bool m_usesNth { false };
+};
+
+// Resumable single-pass evaluation of a Selector over the object trees below
+// a scope. Every object is visited at most once: the walk carries the set of
+// compounds each subtree may still match and skips subtrees where that set
+// is empty. next() stops after `limit` matches or `budget` visited objects,
+// so a broad selector over a large scene is spread across several calls.
+//
+// Between calls only QPointers are kept; objects destroyed in between are
+// skipped, children added or removed under a partly visited parent may be
+// missed or reported twice.
+class SelectorWalk {
+public:
+    SelectorWalk(QSharedPointer<const Selector> selector, const QList<QObject*>& scope);
+
+    // Appends matches to *out; returns true once the walk is exhausted.
+    bool next(int limit, int budget, QList<QObject*>* out);
+    bool isDone() const { return m_stack.isEmpty(); }
+    quint64 visited() const { return m_visited; }
+    const Selector& selector() const { return *m_selector; }
+
+private:
+    struct Frame {
+        QPointer<QObject> parent;
+        bool scope { false };     // iterates the scope list instead of parent's children
+        int next { 0 };
+        quint64 descendant { 0 }; // compounds any descendant may match
+        quint64 child { 0 };      // compounds only the direct children may match
+        QVarLengthArray<int, 4> nthSeen;
+    };
+
+    quint64 typeMask(const QMetaObject* mo);
+    bool matchesRest(const Selector::Compound& c, QObject* obj) const;
+
+    QSharedPointer<const Selector> m_selector;
+    QList<QPointer<QObject>> m_scope;
+    QVector<Frame> m_stack;
+    QHash<const QMetaObject*, quint64> m_typeMasks; // compounds whose type a class satisfies
+    quint64 m_visited { 0 };
+};
@@ -0,0 +1,24 @@
+#pragma once
+#include <QObject>
+#include <functional>
+
+// Receiver for dynamically connected signals that sees the emission's
+// argument array. A slot declared through moc only gets the arguments its
+// own signature names, so a single catch-all slot gets none; the relay
+// instead overrides qt_metacall and answers to one method index past
+// QObject's, the way QSignalSpy does. Connections are always direct.
+class SignalRelay : public QObject {
+public:
+    // args[0] is the (unused) return slot, args[i + 1] points at argument i
+    // of the signal; only valid during the call.
+    using Handler = std::function<void(QObject* sender, int signalIndex, void** args)>;
+
+    explicit SignalRelay(Handler handler, QObject* parent = nullptr);
+
+    QMetaObject::Connection connectTo(QObject* sender, int signalIndex);
+
+    int qt_metacall(QMetaObject::Call call, int id, void** args) override;
+
+private:
+    Handler m_handler;
+};
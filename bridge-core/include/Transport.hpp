@@ -0,0 +1,181 @@
+#pragma once
+#include <QByteArray>
+#include <QHash>
+#include <QHostAddress>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+#include <list>
+#include "Metrics.hpp"
+class QLocalServer;
+class QLocalSocket;
+class QWebSocket;
+class QWebSocketServer;
+class WireCodec;
+
+// Bounds what a slow or stalled client can make the app buffer. Frames are
+// written to the socket while its unsent bytes stay under highWaterBytes;
+// after that they wait in a per-client queue, replies ahead of events, and
+// are written as the socket drains. When the queue holds more than
+// maxQueuedBytes the policy decides what gives. Replies are never dropped:
+// a client whose queued replies alone pass the limit is disconnected.
+struct OutboundLimits {
+    enum Policy {
+        DropOldest, // drop the oldest queued events
+        Coalesce,   // a queued event is replaced by its subscription's next one; then drop oldest
+        Disconnect, // drop the client
+    };
+    Policy policy { DropOldest };
+    qint64 highWaterBytes { 1 << 20 };
+    qint64 maxQueuedBytes { 8 << 20 };
+
+    static const char* policyName(Policy policy);
+    static bool policyFromName(const QString& name, Policy* policy);
+};
+
+struct OutboundClientStats {
+    quint64 clientId { 0 };
+    qint64 socketBytes { 0 };     // written to the socket but not yet sent
+    qint64 queuedBytes { 0 };
+    qint64 peakQueuedBytes { 0 };
+    int queuedReplies { 0 };
+    int queuedEvents { 0 };
+    quint64 droppedEvents { 0 };
+    quint64 coalescedEvents { 0 };
+};
+
+// Framing on the local socket, where there is no WebSocket layer: each frame
+// is a 4-byte big-endian payload length, one kind byte, then the payload.
+// JSON frames correspond to WebSocket text frames and CBOR frames to binary
+// ones, so hello's encoding negotiation works the same on both.
+namespace LocalFrame {
+constexpr int kHeaderBytes = 5;
+constexpr char kJson = 'J';
+constexpr char kCbor = 'C';
+constexpr quint32 kMaxPayload = 64u << 20; // larger frames drop the client
+}
+
+struct OutboundReport {
+    QVector<OutboundClientStats> clients;
+    quint64 disconnects { 0 }; // clients dropped for exceeding maxQueuedBytes
+};
+
+// Network side of the bridge: accepts clients, decodes request frames and
+// encodes/writes replies and events. Clients are plain numeric ids, so the
+// server never holds socket objects, which may live on another thread.
+// Signals are emitted on the thread that owns the transport.
+class Transport : public QObject {
+    Q_OBJECT
+public:
+    using QObject::QObject;
+
+    virtual bool listen(const QHostAddress& address, quint16 port) = 0;
+    // Additionally accepts clients on a local socket (a Unix domain socket,
+    // or a named pipe on Windows) with LocalFrame framing; same client ids,
+    // signals and outbound limits as WebSocket clients. close() stops both.
+    virtual bool listenLocal(const QString& name) = 0;
+    virtual void close() = 0;
+    virtual bool isListening() const = 0;
+    virtual quint16 serverPort() const = 0;
+    virtual QString localServerName() const = 0; // full path, empty when not listening locally
+    virtual bool usesIoThread() const { return false; }
+
+    // `metricsSlot` attributes the reply's encode and send time to its method.
+    virtual void send(quint64 clientId, const QJsonValue& message, const WireCodec* codec,
+                      int metricsSlot = Metrics::kUnknownSlot) = 0;
+    // `encodedBody` caches the encoded params body across clients that share
+    // body and codec; transports that encode on another thread ignore it.
+    // Events that are not `coalescable` (deltas against the previous one) are
+    // never replaced by a later event under the Coalesce policy, only dropped.
+    virtual void sendEvent(quint64 clientId, const QString& subscriptionId, const QJsonObject& body,
+                           const WireCodec* codec, QByteArray* encodedBody = nullptr, bool coalescable = true) = 0;
+
+    virtual void setOutboundLimits(const OutboundLimits& limits) = 0;
+    virtual OutboundReport outboundReport() const = 0;
+
+    // Records parse, encode and send times and traffic; set before listen().
+    virtual void setMetrics(Metrics* metrics) { m_metrics = metrics; }
+
+signals:
+    void clientConnected(quint64 clientId);
+    void clientDisconnected(quint64 clientId);
+    // Text frames are decoded as JSON, binary frames as CBOR; undefined when malformed.
+    void messageReceived(quint64 clientId, const QJsonValue& message);
+    // A client that lost events to the outbound limits has caught up; sent
+    // along with its events_dropped notice.
+    void eventsLost(quint64 clientId, const QStringList& subscriptionIds);
+
+protected:
+    Metrics* m_metrics { nullptr };
+};
+
+// QWebSocketServer, plus the optional QLocalServer, on the owning thread;
+// decoding, encoding and socket writes all happen there.
+class WebSocketTransport : public Transport {
+    Q_OBJECT
+public:
+    explicit WebSocketTransport(QObject* parent = nullptr);
+    ~WebSocketTransport() override;
+
+    bool listen(const QHostAddress& address, quint16 port) override;
+    bool listenLocal(const QString& name) override;
+    void close() override;
+    bool isListening() const override;
+    quint16 serverPort() const override;
+    QString localServerName() const override;
+
+    void send(quint64 clientId, const QJsonValue& message, const WireCodec* codec,
+              int metricsSlot = Metrics::kUnknownSlot) override;
+    void sendEvent(quint64 clientId, const QString& subscriptionId, const QJsonObject& body,
+                   const WireCodec* codec, QByteArray* encodedBody = nullptr, bool coalescable = true) override;
+
+    void setOutboundLimits(const OutboundLimits& limits) override { m_limits = limits; }
+    OutboundReport outboundReport() const override;
+
+private:
+    struct Frame {
+        QByteArray bytes;
+        bool binary { false };
+        QString subscriptionId; // empty for replies
+        int metricsSlot { Metrics::kUnknownSlot };
+        bool coalescable { true };
+    };
+    using FrameQueue = std::list<Frame>;
+    struct Peer {
+        QWebSocket* socket { nullptr }; // exactly one of socket and local is set
+        QLocalSocket* local { nullptr };
+        QByteArray localInput; // partial frame read from local
+        FrameQueue replies;
+        FrameQueue events;
+        QHash<QString, FrameQueue::iterator> pendingBySubscription; // Coalesce: queued event per subscription
+        QSet<QString> lostSubscriptions; // lost events since the last events_dropped notice
+        quint64 lostSinceNotice { 0 };
+        const WireCodec* codec { nullptr }; // latest used, for the events_dropped notice
+        bool closing { false };
+        OutboundClientStats stats;
+
+        QObject* device() const;
+        qint64 bytesToWrite() const;
+    };
+
+    quint64 addPeer(QWebSocket* socket, QLocalSocket* local);
+    void removePeer(quint64 clientId);
+    void readLocal(quint64 clientId);
+    void receive(quint64 clientId, const QByteArray& bytes, const WireCodec* codec);
+    void sendFrame(quint64 clientId, Frame frame, const WireCodec* codec);
+    void enqueue(Peer& peer, Frame frame);
+    void enforceLimit(Peer& peer);
+    void dropEvent(Peer& peer, FrameQueue::iterator it);
+    void flush(Peer& peer);
+    void write(Peer& peer, const Frame& frame);
+
+    QWebSocketServer* m_server { nullptr };
+    QLocalServer* m_localServer { nullptr }; // created by listenLocal()
+    QHash<quint64, Peer> m_peers;
+    quint64 m_nextClientId { 1 };
+    OutboundLimits m_limits;
+    quint64 m_disconnects { 0 };
+};
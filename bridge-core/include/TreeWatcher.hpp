@@ -0,0 +1,106 @@
+#pragma once
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QVector>
+#include <deque>
+#include <functional>
+class ObjectRegistry;
+class QTimer;
+
+// Mirror of the object trees below the engine roots that turns structural
+// changes into numbered deltas for snapshot_tree and subscribe_tree.
+//
+// ChildAdded/ChildRemoved events, Qt Quick childrenChanged(), objectNameChanged
+// and destroyed() only mark objects dirty; at the end of the event-loop turn
+// each dirty object's children() are diffed against the mirror. Diffing
+// rather than replaying events catches objects the QML creator parents
+// without ChildAdded, sees objects after construction finished, and pairs a
+// removal and an addition of the same object into one "reparented" delta.
+//
+// Deltas, each with a sequence number one above the previous:
+//   { seq, op:"added", parentId, index, node }   node as in snapshot()
+//   { seq, op:"removed", objectId, parentId }    descendants go with it
+//   { seq, op:"reparented", objectId, from, to, index }
+//   { seq, op:"renamed", objectId, objectName }
+// The most recent ones are kept, so a client that fell behind can catch up
+// from its last sequence number.
+class TreeWatcher : public QObject {
+    Q_OBJECT
+public:
+    struct Change {
+        quint64 seq { 0 };
+        QJsonObject delta;
+        // Objects the change happened under (or to), for filtering by subtree; may dangle.
+        QObject* anchors[2] { nullptr, nullptr };
+    };
+    // Called at the end of each flush that recorded changes.
+    using Listener = std::function<void(const QVector<Change>& changes)>;
+
+    TreeWatcher(ObjectRegistry* registry, std::function<QObjectList()> roots, Listener listener,
+                QObject* parent = nullptr);
+
+    // Mirrors the trees on first call; later calls are no-ops.
+    void start();
+    bool isStarted() const { return m_started; }
+
+    // Applies pending changes now. With verify, every mirrored object is
+    // re-diffed, which also finds changes that sent no notification.
+    void flush(bool verify = false);
+
+    quint64 seq() const { return m_seq; }
+    // Changes after `since` below `root` (null: all), or false when some were
+    // already dropped from the journal.
+    bool changesSince(quint64 since, QObject* root, QJsonArray* out) const;
+    // Compact tree: { id, type, name?, children?[] }, with childCount? in
+    // place of children past maxDepth. Stops adding nodes past maxNodes.
+    QJsonArray snapshot(QObject* root, int maxDepth, int maxNodes, bool* truncated) const;
+
+    bool contains(QObject* obj) const { return m_nodes.contains(obj); }
+    bool isWithin(QObject* obj, QObject* root) const;
+    int trackedCount() const { return int(m_nodes.size()); }
+    int journalSize() const { return int(m_journal.size()); }
+
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override;
+
+private slots:
+    void onObjectNameChanged();
+    void onDestroyed(QObject* obj);
+    void onChildrenChanged();
+
+private:
+    struct Node {
+        QObject* parent { nullptr };
+        QObjectList children; // as of the last flush
+        QString id;
+        QString type;
+        QString name;
+        bool dead { false };
+    };
+
+    void markDirty(QObject* obj);
+    void track(QObject* obj, QObject* parent);
+    void untrack(QObject* obj);
+    QJsonObject nodeJson(QObject* obj, int depth, int maxDepth, int maxNodes, int* count, bool* truncated) const;
+    void record(QJsonObject delta, QObject* anchor, QObject* second = nullptr);
+    void diffRoots();
+
+    ObjectRegistry* m_registry { nullptr };
+    std::function<QObjectList()> m_rootsFn;
+    Listener m_listener;
+    QTimer* m_flushTimer { nullptr };
+    QHash<QObject*, Node> m_nodes;
+    QObjectList m_roots;
+    QSet<QObject*> m_dirty;
+    QSet<QObject*> m_renamed;
+    std::deque<Change> m_journal;
+    QVector<Change> m_fresh; // recorded by the running flush
+    quint64 m_seq { 0 };
+    int m_childrenChangedSlot { -1 };
+    bool m_started { false };
+    bool m_rootsDirty { false };
+};
@@ -0,0 +1,63 @@
+#pragma once
+#include <QHash>
+#include <QJsonValue>
+#include <QMetaEnum>
+#include <QMetaType>
+#include <QVariant>
+#include <functional>
+#include <vector>
+class ObjectRegistry;
+struct QMetaObject;
+
+// Converts property values, method results and model data to JSON.
+// Built-in types go through one switch on the metatype id:
+//   - numbers, strings, lists and maps map to their JSON counterparts
+//   - QPoint(F) is { x, y }, QSize(F) { width, height }, QRect(F) { x, y, width, height }
+//   - QColor is "#rrggbb" ("#aarrggbb" when translucent), QUrl its string form
+//   - QDateTime, QDate and QTime are ISO 8601
+//   - QObject pointers are object ids, so a value can be inspected directly
+//   - QJSValue is converted through its variant (objects by id)
+// Other types are looked up by id in a flat table that is filled on first
+// sight: registered converters, QObject pointer types, and otherwise the
+// type name. Used on the GUI thread only.
+//
+// fromJson() goes the other way, for writes: it accepts what toJson()
+// produces (plus [x, y]-style arrays for points, sizes and rects, and enum
+// keys by name) and fails with a reason instead of guessing.
+class VariantConverter {
+public:
+    using Converter = std::function<QJsonValue(const QVariant& value, const VariantConverter& converter)>;
+
+    // Without a registry, QObject pointers convert to null.
+    explicit VariantConverter(ObjectRegistry* registry = nullptr);
+
+    QJsonValue toJson(const QVariant& value) const;
+
+    // Converts `value` to `type`, e.g. a property's metatype. With a valid
+    // `enumerator`, strings are read as its keys ("A|B" for flags). On
+    // failure *error says why and *out is untouched.
+    bool fromJson(const QJsonValue& value, QMetaType type, QVariant* out, QString* error,
+                  const QMetaEnum& enumerator = QMetaEnum()) const;
+
+    // For types the built-ins above do not cover; the converter may recurse
+    // through converter.toJson(). Registering a type again replaces it.
+    void registerConverter(int typeId, Converter convert);
+    // Q_GADGET value types, as an object of their readable properties.
+    void registerGadget(int typeId, const QMetaObject* metaObject);
+    template <typename Gadget>
+    void registerGadget() { registerGadget(qMetaTypeId<Gadget>(), &Gadget::staticMetaObject); }
+
+private:
+    enum class Kind : quint8 { Unseen, Named, Object, JsValue, Custom };
+
+    QJsonValue convertOther(const QVariant& value, int typeId) const;
+    Kind classify(int typeId) const;
+    QJsonValue objectId(QObject* obj) const;
+    bool gadgetFromJson(const QJsonObject& value, QMetaType type, QVariant* out, QString* error) const;
+
+    ObjectRegistry* m_registry { nullptr };
+    int m_jsValueType { 0 };
+    QHash<int, Converter> m_custom;
+    // Kind by typeId - QMetaType::User; user type ids are dense, so this stays small.
+    mutable std::vector<Kind> m_userKinds;
+};
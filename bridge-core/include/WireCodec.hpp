@@ -0,0 +1,30 @@
+#pragma once
+#include <QByteArray>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QStringList>
+
+// Wire encoding of protocol messages. Handlers build QJson trees; a codec turns
+// frames into requests and replies/events into frames. Clients pick one via
+// hello { encoding }; JSON over text frames is the default.
+class WireCodec {
+public:
+    virtual ~WireCodec() = default;
+
+    virtual QString name() const = 0;
+    // Binary codecs are sent with sendBinaryMessage, text codecs with sendTextMessage.
+    virtual bool isBinary() const = 0;
+    // Returns an object (single request) or array (batch); undefined on parse errors.
+    virtual QJsonValue decode(const QByteArray& frame) const = 0;
+    virtual QByteArray encode(const QJsonValue& message) const = 0;
+
+    // Events fan out to many subscriptions that differ only in subscriptionId:
+    // the params body is encoded once and each frame splices the id in front.
+    virtual QByteArray encodeEventBody(const QJsonObject& params) const = 0;
+    virtual QByteArray frameEvent(const QString& subscriptionId, const QByteArray& body) const = 0;
+
+    static const WireCodec* json();
+    static const WireCodec* cbor();
+    static const WireCodec* byName(const QString& name);
+    static QStringList names();
+};
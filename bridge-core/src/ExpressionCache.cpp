@@ -0,0 +1,26 @@
+#include "ExpressionCache.hpp"
+
+#include <QQmlContext>
+#include <QQmlExpression>
+
+ExpressionCache::ExpressionCache(int capacity)
+    : m_cache(capacity)
+{
+}
+
+QSharedPointer<QQmlExpression> ExpressionCache::get(QQmlContext* context, QObject* scope, const QString& source)
+{
+    ++m_stats.lookups;
+    const Key key{context, scope, source};
+    if (const Entry* entry = m_cache.object(key)) {
+        if (entry->context == context && entry->scope == scope) {
+            entry->expression->clearError();
+            return entry->expression;
+        }
+    }
+    ++m_stats.compiles;
+    auto* entry = new Entry{context, scope, QSharedPointer<QQmlExpression>::create(context, scope, source)};
+    const QSharedPointer<QQmlExpression> expression = entry->expression;
+    m_cache.insert(key, entry); // replaces a stale entry under the same key
+    return expression;
+}
@@ -0,0 +1,195 @@
+#include "FrameCapture.hpp"
+
+#include <QBuffer>
+#include <QImageWriter>
+#include <QJsonArray>
+#include <QQuickItem>
+#include <QQuickWindow>
+#include <QTimer>
+#include <QtMath>
+#include <cstring>
+#include <utility>
+
+namespace {
+constexpr int kMinTileSize = 16;
+constexpr int kMaxTileSize = 512;
+
+QSize scaledSize(const QSize& size, double scale)
+{
+    return QSize(qMax(1, qRound(size.width() * scale)), qMax(1, qRound(size.height() * scale)));
+}
+
+bool tileChanged(const QImage& before, const QImage& after, const QRect& tile)
+{
+    const size_t offset = size_t(tile.x()) * 4;
+    const size_t bytes = size_t(tile.width()) * 4;
+    for (int y = tile.top(); y <= tile.bottom(); ++y) {
+        if (std::memcmp(before.constScanLine(y) + offset, after.constScanLine(y) + offset, bytes) != 0) return true;
+    }
+    return false;
+}
+}
+
+QString FrameOptions::fromParams(const QJsonObject& params, FrameOptions* out)
+{
+    FrameOptions o;
+    o.scale = params.value("scale").toDouble(1.0);
+    if (!(o.scale > 0 && o.scale <= 1)) return QStringLiteral("scale must be in (0, 1]");
+    const QString encoding = params.value("encoding").toString(QStringLiteral("png"));
+    if (encoding == QLatin1String("png")) o.encoding = Png;
+    else if (encoding == QLatin1String("jpeg")) o.encoding = Jpeg;
+    else return QStringLiteral("encoding must be \"png\" or \"jpeg\"");
+    o.quality = params.value("quality").toInt(o.quality);
+    if (o.quality < 0 || o.quality > 100) return QStringLiteral("quality must be in 0..100");
+    o.tileSize = params.value("tileSize").toInt(o.tileSize);
+    if (o.tileSize < kMinTileSize || o.tileSize > kMaxTileSize)
+        return QStringLiteral("tileSize must be in %1..%2").arg(kMinTileSize).arg(kMaxTileSize);
+    *out = o;
+    return QString();
+}
+
+const char* FrameOptions::encodingName(Encoding encoding)
+{
+    return encoding == Jpeg ? "jpeg" : "png";
+}
+
+QQuickWindow* FrameCapture::windowOf(QObject* obj)
+{
+    if (auto* window = qobject_cast<QQuickWindow*>(obj)) return window;
+    if (auto* item = qobject_cast<QQuickItem*>(obj)) return item->window();
+    return nullptr;
+}
+
+QImage FrameCapture::grab(QQuickWindow* window, double scale)
+{
+    QImage image = window->grabWindow();
+    if (image.isNull()) return image;
+    if (scale < 1) image = image.scaled(scaledSize(image.size(), scale), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    // One fixed 32-bit layout, so frames can be compared with memcmp.
+    return image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+}
+
+QRect FrameCapture::itemRect(QQuickItem* item, const QImage& grab, double scale)
+{
+    const double factor = item->window()->effectiveDevicePixelRatio() * scale;
+    const QRectF scene = item->mapRectToScene(item->boundingRect());
+    const QRect pixels(qFloor(scene.x() * factor), qFloor(scene.y() * factor),
+                       qCeil(scene.width() * factor), qCeil(scene.height() * factor));
+    return pixels.intersected(grab.rect());
+}
+
+QByteArray FrameCapture::encode(const QImage& image, const FrameOptions& options)
+{
+    QByteArray bytes;
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::WriteOnly);
+    QImageWriter writer(&buffer, FrameOptions::encodingName(options.encoding));
+    if (options.encoding == FrameOptions::Jpeg) writer.setQuality(options.quality);
+    else writer.setCompression(1); // PNG: favour speed, tiles are small
+    // JPEG has no alpha; flatten instead of letting the writer pick a colour.
+    const QImage source = options.encoding == FrameOptions::Jpeg ? image.convertToFormat(QImage::Format_RGB32) : image;
+    if (!writer.write(source)) return QByteArray();
+    return bytes;
+}
+
+FrameStream::FrameStream(QQuickWindow* window, const FrameOptions& options, int maxFps, Deliver deliver)
+    : m_window(window), m_options(options), m_intervalMs(1000 / qMax(1, maxFps)), m_deliver(std::move(deliver))
+{
+    m_clock.start();
+    m_timer = new QTimer;
+    m_timer->setSingleShot(true);
+    QObject::connect(m_timer, &QTimer::timeout, m_timer, [this] { tick(); });
+    // Emitted on the render thread with the threaded loop; the timer's
+    // thread affinity makes this a queued call onto the GUI thread then.
+    m_swapped = QObject::connect(window, &QQuickWindow::frameSwapped, m_timer, [this] { onFrameSwapped(); });
+    schedule(); // the first keyframe
+}
+
+FrameStream::~FrameStream()
+{
+    QObject::disconnect(m_swapped);
+    delete m_timer;
+}
+
+QSize FrameStream::frameSize() const
+{
+    if (!m_window) return QSize();
+    return scaledSize(m_window->size() * m_window->effectiveDevicePixelRatio(), m_options.scale);
+}
+
+void FrameStream::requestKeyframe()
+{
+    m_last = QImage();
+    m_dirty = true;
+    schedule();
+}
+
+void FrameStream::onFrameSwapped()
+{
+    if (m_grabbing) return;
+    m_dirty = true;
+    schedule();
+}
+
+void FrameStream::schedule()
+{
+    if (m_timer->isActive()) return;
+    const qint64 due = m_lastGrabMs < 0 ? 0 : m_lastGrabMs + m_intervalMs;
+    m_timer->start(int(qMax<qint64>(0, due - m_clock.elapsed())));
+}
+
+void FrameStream::tick()
+{
+    if (!m_window || !m_dirty) return;
+    m_dirty = false;
+    m_grabbing = true;
+    m_lastGrabMs = m_clock.elapsed();
+    const QImage image = FrameCapture::grab(m_window, m_options.scale);
+    // Swaps that grabbing itself queued arrive before this; real ones after.
+    QMetaObject::invokeMethod(m_timer, [this] { m_grabbing = false; }, Qt::QueuedConnection);
+    if (image.isNull()) return;
+    const QJsonObject event = frameEvent(image);
+    if (!event.isEmpty()) m_deliver(event);
+}
+
+QJsonObject FrameStream::frameEvent(const QImage& image)
+{
+    QJsonArray tiles;
+    auto addTile = [&](const QRect& rect) {
+        const QByteArray data = FrameCapture::encode(image.copy(rect), m_options);
+        tiles.push_back(QJsonObject{{"x", rect.x()}, {"y", rect.y()}, {"width", rect.width()},
+                                    {"height", rect.height()}, {"data", QString::fromLatin1(data.toBase64())}});
+    };
+    const bool keyframe = m_last.size() != image.size();
+    if (keyframe) {
+        addTile(image.rect());
+    } else {
+        const int tile = m_options.tileSize;
+        const int columns = (image.width() + tile - 1) / tile;
+        for (int y = 0; y < image.height(); y += tile) {
+            const int h = qMin(tile, image.height() - y);
+            int runStart = -1;
+            // One past the last column closes a run that reaches the right edge.
+            for (int column = 0; column <= columns; ++column) {
+                const int x = qMin(column * tile, image.width());
+                const bool changed = column < columns
+                    && tileChanged(m_last, image, QRect(x, y, qMin(tile, image.width() - x), h));
+                if (changed && runStart < 0) runStart = x;
+                if (!changed && runStart >= 0) {
+                    addTile(QRect(runStart, y, x - runStart, h));
+                    runStart = -1;
+                }
+            }
+        }
+        if (tiles.isEmpty()) return QJsonObject();
+    }
+    m_last = image;
+    QJsonObject event{{"kind", "frame"},
+                      {"seq", double(++m_seq)},
+                      {"width", image.width()},
+                      {"height", image.height()},
+                      {"encoding", FrameOptions::encodingName(m_options.encoding)},
+                      {"tiles", tiles}};
+    if (keyframe) event.insert("keyframe", true);
+    return event;
+}
@@ -1,8 +1,23 @@
 #include "InspectorServer.hpp"
+#include "ExpressionCache.hpp"
+#ifdef QAB_ENABLE_CAPTURE
+#include "FrameCapture.hpp"
+#endif
+#include "IoThreadTransport.hpp"
+#include "JobScheduler.hpp"
+#include "MethodInvoker.hpp"
+#include "MetricsEndpoint.hpp"
+#include "ModelExport.hpp"
+#include "ModelWatcher.hpp"
+#include "ObjectIndex.hpp"
+#include "ObjectRegistry.hpp"
+#include "Selector.hpp"
+#include "SignalRelay.hpp"
+#include "Transport.hpp"
+#include "TreeWatcher.hpp"
+#include "WireCodec.hpp"
 
 #include <QQmlApplicationEngine>
-#include <QWebSocketServer>
-#include <QWebSocket>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
@@ -15,450 +30,1512 @@
 #include <QQmlEngine>
 #include <QQmlExpression>
 #include <QQmlProperty>
+#include <QFile>
+#include <QJSValue>
+#include <QTimer>
+#ifdef QAB_ENABLE_CAPTURE
+#include <QQuickItem>
+#include <QQuickWindow>
+#endif
+#include <cmath>
+#include <utility>
+
+namespace {
+constexpr int kSelectorCacheSize = 256;
+constexpr int kExpressionCacheSize = 256;
+constexpr int kMaxCursorsPerClient = 16;
+constexpr int kDefaultQueryLimit = 100;
+constexpr int kMaxQueryLimit = 1000;
+constexpr int kDefaultQueryBudget = 50000; // objects visited per query call
+constexpr int kFrameIntervalMs = 16; // coalesce:"frame", ~60 Hz
+constexpr int kDefaultExportChunk = 1000;
+constexpr int kMaxExportChunk = 10000;
+constexpr int kDefaultWaitTimeoutMs = 10000;
+constexpr int kMaxWaitTimeoutMs = 600000;
+constexpr int kMaxWaitersPerClient = 64;
+constexpr int kDefaultTreeDepth = 64;
+constexpr int kDefaultTreeNodes = 100000;
+constexpr int kMaxTreeNodes = 1000000;
+constexpr int kMaxPropertyWrites = 10000; // per set_properties call
+constexpr int kDefaultFrameFps = 10;
+constexpr int kMaxFrameFps = 60;
+
+// Pre-order walk over objects and their descendants that can stop at a
+// deadline and pick up on a later turn; objects deleted in between are skipped.
+class ResumableWalk {
+public:
+    explicit ResumableWalk(const QObjectList& starts)
+    {
+        for (int i = starts.size() - 1; i >= 0; --i) m_stack.push_back(starts.at(i));
+    }
+
+    // Returns true once every object has been visited.
+    template <typename Visit>
+    bool run(const QDeadlineTimer& deadline, Visit&& visit)
+    {
+        int visited = 0;
+        while (!m_stack.isEmpty()) {
+            if ((++visited & 63) == 0 && deadline.hasExpired()) return false;
+            const QPointer<QObject> obj = m_stack.takeLast();
+            if (!obj) continue;
+            visit(obj.data());
+            const QObjectList& children = obj->children();
+            for (int i = children.size() - 1; i >= 0; --i) m_stack.push_back(children.at(i));
+        }
+        return true;
+    }
+
+private:
+    QVector<QPointer<QObject>> m_stack;
+};
+
+// Resident set size of this process in KiB, or null where it cannot be read.
+QJsonValue residentKb()
+{
+#ifdef Q_OS_LINUX
+    QFile status(QStringLiteral("/proc/self/status"));
+    if (!status.open(QIODevice::ReadOnly)) return QJsonValue();
+    const QByteArray text = status.readAll();
+    const int at = text.indexOf("VmRSS:");
+    if (at < 0) return QJsonValue();
+    const int end = text.indexOf('\n', at);
+    bool ok = false;
+    const double kb = text.mid(at + 6, end < 0 ? -1 : end - at - 6).replace("kB", "").trimmed().toDouble(&ok);
+    return ok ? QJsonValue(kb) : QJsonValue();
+#else
+    return QJsonValue();
+#endif
+}
+}
 
 InspectorServer::InspectorServer(QQmlApplicationEngine* engine,
                                  const QHostAddress& addr,
                                  quint16 port,
                                  const QString& token,
                                  QObject* parent)
-    : QObject(parent), m_engine(engine), m_token(token)
+    : QObject(parent), m_engine(engine), m_address(addr), m_token(token), m_selectors(kSelectorCacheSize),
+      m_expressions(kExpressionCacheSize)
+{
+    m_signalRelay = new SignalRelay(
+        [this](QObject* sender, int signalIndex, void** argv) { onSignalTriggered(sender, signalIndex, argv); }, this);
+    m_registry = new ObjectRegistry(this);
+    m_converter = VariantConverter(m_registry);
+    m_invoker = MethodInvoker(m_registry);
+    m_jobs = new JobScheduler(this);
+    m_tree = new TreeWatcher(
+        m_registry, [this] { return m_engine->rootObjects(); },
+        [this](const QVector<TreeWatcher::Change>& changes) { deliverTreeChanges(changes); }, this);
+    // Qt drops the connections of a destroyed sender; drop its buckets with them.
+    connect(m_registry, &ObjectRegistry::objectReleased, this, [this](QObject* obj) {
+        m_dispatch.remove(obj);
+    });
+    registerBuiltinMethods();
+    m_exportTimer = new QTimer(this);
+    m_exportTimer->setInterval(0);
+    connect(m_exportTimer, &QTimer::timeout, this, &InspectorServer::onExportTick);
+    m_clock.start();
+    m_throttleTimer = new QTimer(this);
+    m_throttleTimer->setSingleShot(true);
+    connect(m_throttleTimer, &QTimer::timeout, this, &InspectorServer::flushThrottled);
+    m_modelFlushTimer = new QTimer(this);
+    m_modelFlushTimer->setSingleShot(true);
+    m_modelFlushTimer->setInterval(0);
+    connect(m_modelFlushTimer, &QTimer::timeout, this, &InspectorServer::flushModelChanges);
+    attachTransport(new WebSocketTransport(this), port);
+}
+
+void InspectorServer::attachTransport(Transport* transport, quint16 port)
+{
+    m_transport = transport;
+    m_transport->setOutboundLimits(m_outboundLimits);
+    m_transport->setMetrics(&m_metrics);
+    connect(m_transport, &Transport::clientConnected, this, [this](quint64 client) {
+        m_clients.insert(client, ClientState{});
+    });
+    connect(m_transport, &Transport::clientDisconnected, this, &InspectorServer::onClientDisconnected);
+    connect(m_transport, &Transport::messageReceived, this, &InspectorServer::handleMessage);
+    connect(m_transport, &Transport::eventsLost, this, &InspectorServer::onEventsLost);
+    m_transport->listen(m_address, port);
+    if (!m_localName.isEmpty()) m_transport->listenLocal(m_localName);
+}
+
+void InspectorServer::onClientDisconnected(quint64 client)
+{
+    // Clean up any subscriptions for this client
+    const ClientState state = m_clients.take(client);
+    m_jobs->cancelClient(client);
+    for (const SubscriptionPtr& info : state.subscriptions) removeSubscription(info);
+}
+
+void InspectorServer::onEventsLost(quint64 client, const QStringList& subscriptionIds)
 {
-    m_server = new QWebSocketServer(QStringLiteral("QmlAgentBridge"),
-                                    QWebSocketServer::NonSecureMode, this);
-    if (!m_server->listen(addr, port)) {
-        return;
+#ifdef QAB_ENABLE_CAPTURE
+    // Later tile deltas would apply to a picture the client never got.
+    const auto state = m_clients.constFind(client);
+    if (state == m_clients.cend()) return;
+    for (const QString& subId : subscriptionIds) {
+        const auto stream = state->frameSubscriptions.value(subId);
+        if (stream) stream->requestKeyframe();
     }
+#else
+    Q_UNUSED(client);
+    Q_UNUSED(subscriptionIds);
+#endif
+}
 
-    connect(m_server, &QWebSocketServer::newConnection, this, [this]() {
-        QWebSocket* client = m_server->nextPendingConnection();
-        connect(client, &QWebSocket::textMessageReceived, this, [this, client](const QString& msg){
-            handleTextMessage(client, msg);
-        });
-        connect(client, &QWebSocket::disconnected, this, [this, client]{
-            // Clean up any subscriptions for this client
-            auto it = m_subscriptions.find(client);
-            if (it != m_subscriptions.end()) {
-                for (auto subIt = it->begin(); subIt != it->end(); ++subIt) {
-                    QObject::disconnect(subIt->connection);
+bool InspectorServer::isListening() const
+{
+    return m_transport && m_transport->isListening();
+}
+
+quint16 InspectorServer::serverPort() const
+{
+    return m_transport ? m_transport->serverPort() : 0;
+}
+
+bool InspectorServer::listenLocal(const QString& name)
+{
+    m_localName = name;
+    return m_transport->listenLocal(name);
+}
+
+QString InspectorServer::localServerName() const
+{
+    return m_transport ? m_transport->localServerName() : QString();
+}
+
+void InspectorServer::setIoThreadEnabled(bool enabled)
+{
+    if (enabled == isIoThreadEnabled()) return;
+    const quint16 port = serverPort();
+    const QList<quint64> clients = m_clients.keys();
+    for (quint64 client : clients) onClientDisconnected(client);
+    delete m_transport; // closes the listener and every socket
+    if (enabled) attachTransport(new IoThreadTransport(this), port);
+    else attachTransport(new WebSocketTransport(this), port);
+}
+
+bool InspectorServer::isIoThreadEnabled() const
+{
+    return m_transport && m_transport->usesIoThread();
+}
+
+void InspectorServer::setObjectIndexEnabled(bool enabled)
+{
+    if (enabled == isObjectIndexEnabled()) return;
+    if (enabled) {
+        m_index = new ObjectIndex(this); // built lazily on the first lookup
+    } else {
+        delete m_index;
+        m_index = nullptr;
+    }
+}
+
+bool InspectorServer::isObjectIndexEnabled() const
+{
+    return m_index != nullptr;
+}
+
+void InspectorServer::setOutboundLimits(const OutboundLimits& limits)
+{
+    m_outboundLimits = limits;
+    m_transport->setOutboundLimits(limits);
+}
+
+bool InspectorServer::startMetricsEndpoint(quint16 port, const QHostAddress& address)
+{
+    if (!Metrics::kEnabled) return false;
+    if (!m_metricsEndpoint) m_metricsEndpoint = new MetricsEndpoint([this] { return renderPrometheus(); }, this);
+    return m_metricsEndpoint->listen(address, port);
+}
+
+quint16 InspectorServer::metricsPort() const
+{
+    return m_metricsEndpoint ? m_metricsEndpoint->serverPort() : 0;
+}
+
+qint64 InspectorServer::guiThreadNs() const
+{
+    // Handlers and event delivery, job slices, and frame parsing unless the I/O thread does it.
+    qint64 ns = m_metrics.guiNs() + m_jobs->stats().busyNs;
+    if (!isIoThreadEnabled()) ns += m_metrics.phaseTotalNs(Metrics::Parse);
+    return ns;
+}
+
+QByteArray InspectorServer::renderPrometheus() const
+{
+    return m_metrics.toPrometheus(guiThreadNs() / 1e9,
+                                  {{"qab_clients", double(m_clients.size())},
+                                   {"qab_handles", double(m_registry->size())},
+                                   {"qab_jobs_queued", double(m_jobs->queued())}});
+}
+
+void InspectorServer::setJobBudgetMs(double ms)
+{
+    m_jobs->setBudgetMs(ms);
+}
+
+double InspectorServer::jobBudgetMs() const
+{
+    return m_jobs->budgetMs();
+}
+
+void InspectorServer::registerMethod(const QString& name, RpcHandler handler)
+{
+    if (!m_handlers.contains(name)) m_methodNames.push_back(name);
+    m_handlers.insert(name, handler);
+    m_metrics.addMethod(name);
+}
+
+void InspectorServer::registerBuiltinMethods()
+{
+    registerMethod(QStringLiteral("hello"), &InspectorServer::rpcHello);
+    registerMethod(QStringLiteral("list_roots"), &InspectorServer::rpcListRoots);
+    registerMethod(QStringLiteral("find_by_name"), &InspectorServer::rpcFindByName);
+    registerMethod(QStringLiteral("find_by_type"), &InspectorServer::rpcFindByType);
+    registerMethod(QStringLiteral("inspect"), &InspectorServer::rpcInspect);
+    registerMethod(QStringLiteral("get_schema"), &InspectorServer::rpcGetSchema);
+    registerMethod(QStringLiteral("list_children"), &InspectorServer::rpcListChildren);
+    registerMethod(QStringLiteral("model_info"), &InspectorServer::rpcModelInfo);
+    registerMethod(QStringLiteral("model_fetch"), &InspectorServer::rpcModelFetch);
+    registerMethod(QStringLiteral("model_export"), &InspectorServer::rpcModelExport);
+    registerMethod(QStringLiteral("model_export_cancel"), &InspectorServer::rpcModelExportCancel);
+    registerMethod(QStringLiteral("set_property"), &InspectorServer::rpcSetProperty);
+    registerMethod(QStringLiteral("call_method"), &InspectorServer::rpcCallMethod);
+    registerMethod(QStringLiteral("evaluate"), &InspectorServer::rpcEvaluate);
+    registerMethod(QStringLiteral("subscribe_signal"), &InspectorServer::rpcSubscribeSignal);
+    registerMethod(QStringLiteral("subscribe_property"), &InspectorServer::rpcSubscribeProperty);
+    registerMethod(QStringLiteral("subscribe_model"), &InspectorServer::rpcSubscribeModel);
+    registerMethod(QStringLiteral("unsubscribe"), &InspectorServer::rpcUnsubscribe);
+    registerMethod(QStringLiteral("batch"), &InspectorServer::rpcBatch);
+    registerMethod(QStringLiteral("resolve"), &InspectorServer::rpcResolve);
+    registerMethod(QStringLiteral("stats"), &InspectorServer::rpcStats);
+    registerMethod(QStringLiteral("query"), &InspectorServer::rpcQuery);
+    registerMethod(QStringLiteral("cancel"), &InspectorServer::rpcCancel);
+    registerMethod(QStringLiteral("wait_for"), &InspectorServer::rpcWaitFor);
+    registerMethod(QStringLiteral("snapshot_tree"), &InspectorServer::rpcSnapshotTree);
+    registerMethod(QStringLiteral("subscribe_tree"), &InspectorServer::rpcSubscribeTree);
+    registerMethod(QStringLiteral("set_properties"), &InspectorServer::rpcSetProperties);
+#ifdef QAB_ENABLE_CAPTURE
+    registerMethod(QStringLiteral("capture"), &InspectorServer::rpcCapture);
+    registerMethod(QStringLiteral("subscribe_frames"), &InspectorServer::rpcSubscribeFrames);
+#endif
+}
+
+void InspectorServer::handleMessage(quint64 client, const QJsonValue& msg)
+{
+    const Metrics::GuiScope timing(m_metrics);
+    if (msg.isArray()) {
+        // A top-level array is a batch: one frame in, one array of replies out,
+        // sent once its last item has finished on m_jobs.
+        const RpcContinuation step = batchContinuation(client, msg.toArray(), false);
+        auto result = QSharedPointer<RpcResult>::create();
+        m_jobs->submit(client, QString(),
+                       [step, result](const QDeadlineTimer& deadline) { return step(deadline, result.data()); },
+                       [this, client, result] {
+                           sendMessage(client, result->result.value("replies"), m_metrics.slotFor(QStringLiteral("batch")));
+                       });
+    } else if (!msg.isObject()) {
+        m_metrics.recordError(Metrics::kUnknownSlot);
+        sendMessage(client, replyErr({}, "bad_request", "Invalid request frame"));
+    } else {
+        const auto obj = msg.toObject();
+        const QString method = obj.value("method").toString();
+        const RpcContext ctx{client, obj.value("id").toString(), m_metrics.slotFor(method)};
+        const RpcResult r = dispatch(ctx, method, obj.value("params").toObject());
+        if (r.isDeferred()) scheduleReply(ctx, r.continuation);
+        else if (!r.isParked) sendReply(ctx, r);
+    }
+    // An encoding negotiated by hello applies after its own reply went out.
+    auto state = m_clients.find(client);
+    if (state != m_clients.end() && state->pendingCodec) {
+        state->codec = state->pendingCodec;
+        state->pendingCodec = nullptr;
+    }
+}
+
+InspectorServer::RpcResult InspectorServer::dispatch(const RpcContext& ctx, const QString& method, const QJsonObject& params)
+{
+    const auto it = m_handlers.constFind(method);
+    if (it == m_handlers.cend()) {
+        m_metrics.recordError(Metrics::kUnknownSlot);
+        return RpcResult::error("not_implemented", "Unknown method");
+    }
+    const qint64 start = Metrics::now();
+    RpcResult r = (this->*it.value())(ctx, params);
+    // Deferred and parked handlers are recorded when they finish.
+    if (!r.isDeferred() && !r.isParked) recordExecution(ctx.metricsSlot, r, Metrics::now() - start);
+    return r;
+}
+
+void InspectorServer::recordExecution(int metricsSlot, const RpcResult& r, qint64 ns)
+{
+    m_metrics.recordPhase(metricsSlot, Metrics::Execute, ns);
+    if (r.isError()) m_metrics.recordError(metricsSlot);
+}
+
+void InspectorServer::sendReply(const RpcContext& ctx, const RpcResult& r)
+{
+    sendMessage(ctx.client, r.isError() ? replyErr(ctx.id, r.errorCode, r.errorMessage) : replyOk(ctx.id, r.result),
+                ctx.metricsSlot);
+}
+
+void InspectorServer::scheduleReply(const RpcContext& ctx, const RpcContinuation& continuation)
+{
+    struct Pending {
+        RpcResult result;
+        qint64 executeNs { 0 };
+    };
+    auto pending = QSharedPointer<Pending>::create();
+    m_jobs->submit(ctx.client, ctx.id,
+                   [continuation, pending](const QDeadlineTimer& deadline) {
+                       const qint64 start = Metrics::now();
+                       const bool done = continuation(deadline, &pending->result);
+                       pending->executeNs += Metrics::now() - start;
+                       return done;
+                   },
+                   [this, ctx, pending] {
+                       recordExecution(ctx.metricsSlot, pending->result, pending->executeNs);
+                       sendReply(ctx, pending->result);
+                   });
+}
+
+const WireCodec* InspectorServer::codecFor(quint64 client) const
+{
+    const auto it = m_clients.constFind(client);
+    return it != m_clients.cend() && it->codec ? it->codec : WireCodec::json();
+}
+
+void InspectorServer::sendMessage(quint64 client, const QJsonValue& message, int metricsSlot)
+{
+    m_transport->send(client, message, codecFor(client), metricsSlot);
+}
+
+InspectorServer::RpcContinuation InspectorServer::batchContinuation(quint64 client, const QJsonArray& requests,
+                                                                     bool stopOnError)
+{
+    struct Progress {
+        QJsonArray replies;
+        int next { 0 };
+        bool stopped { false };
+        RpcContext ctx;          // the item being run
+        RpcContinuation pending; // set while that item is deferred
+        qint64 executeNs { 0 };
+    };
+    auto progress = QSharedPointer<Progress>::create();
+    // Items run in order within the job budget; a deferred item is stepped
+    // with the batch's own deadline and resumed on the next slice.
+    return [this, client, requests, stopOnError, progress](const QDeadlineTimer& deadline, RpcResult* out) {
+        do {
+            RpcResult r;
+            if (progress->pending) {
+                const qint64 start = Metrics::now();
+                const bool done = progress->pending(deadline, &r);
+                progress->executeNs += Metrics::now() - start;
+                if (!done) return false;
+                progress->pending = nullptr;
+                recordExecution(progress->ctx.metricsSlot, r, progress->executeNs);
+            } else if (progress->next < requests.size()) {
+                const QJsonValue item = requests.at(progress->next++);
+                const QJsonObject req = item.toObject();
+                const QString method = req.value("method").toString();
+                progress->ctx = RpcContext{client, req.value("id").toString(), m_metrics.slotFor(method)};
+                if (progress->stopped) r = RpcResult::error("skipped", "Skipped after an earlier error");
+                else if (!item.isObject() || method.isEmpty()) r = RpcResult::error("bad_request", "Invalid request");
+                else if (method == QLatin1String("batch")) r = RpcResult::error("bad_request", "Nested batch");
+                else if (method == QLatin1String("wait_for")) r = RpcResult::error("bad_request", "wait_for cannot be batched");
+                else r = dispatch(progress->ctx, method, req.value("params").toObject());
+                if (r.isDeferred()) {
+                    progress->pending = r.continuation;
+                    progress->executeNs = 0;
+                    continue;
                 }
-                m_subscriptions.erase(it);
+            } else {
+                *out = RpcResult::ok({{"replies", progress->replies}});
+                return true;
             }
-            client->deleteLater();
+            if (r.isError() && stopOnError) progress->stopped = true;
+            const QString& id = progress->ctx.id;
+            progress->replies.push_back(r.isError() ? replyErr(id, r.errorCode, r.errorMessage) : replyOk(id, r.result));
+        } while (!deadline.hasExpired());
+        return false;
+    };
+}
+
+InspectorServer::RpcResult InspectorServer::rpcHello(const RpcContext& rpc, const QJsonObject& params)
+{
+    const WireCodec* codec = codecFor(rpc.client);
+    if (params.contains("encoding")) {
+        codec = WireCodec::byName(params.value("encoding").toString());
+        if (!codec) return RpcResult::error("bad_request", "Unsupported encoding");
+        auto state = m_clients.find(rpc.client);
+        if (state != m_clients.end()) state->pendingCodec = codec;
+    }
+    return RpcResult::ok({{"protocol", "qml-agent-bridge"},
+                          {"version", "0.3"},
+                          {"encoding", codec->name()},
+                          {"encodings", QJsonArray::fromStringList(WireCodec::names())},
+                          {"capabilities", QJsonArray::fromStringList(m_methodNames)}});
+}
+
+InspectorServer::RpcResult InspectorServer::rpcListRoots(const RpcContext&, const QJsonObject&)
+{
+    QJsonArray roots;
+    for (QObject* obj : m_engine->rootObjects()) roots.push_back(describeObject(obj));
+    return RpcResult::ok({{"roots", roots}});
+}
+
+InspectorServer::RpcResult InspectorServer::rpcFindByName(const RpcContext&, const QJsonObject& params)
+{
+    const auto name = params.value("name").toString();
+    QJsonArray matches;
+    if (m_index) {
+        for (QObject* m : m_index->findByName(m_engine->rootObjects(), name)) matches.push_back(describeObject(m));
+        return RpcResult::ok({{"matches", matches}});
+    }
+    // Without the index this is a full tree walk; it runs in slices on m_jobs.
+    QObjectList descendants;
+    for (QObject* root : m_engine->rootObjects()) descendants += root->children();
+    auto walk = QSharedPointer<ResumableWalk>::create(descendants);
+    auto found = QSharedPointer<QJsonArray>::create();
+    return RpcResult::deferred([this, walk, found, name](const QDeadlineTimer& deadline, RpcResult* out) {
+        const bool done = walk->run(deadline, [&](QObject* obj) {
+            if (obj->objectName() == name) found->push_back(describeObject(obj));
         });
+        if (done) *out = RpcResult::ok({{"matches", *found}});
+        return done;
     });
 }
 
-void InspectorServer::handleTextMessage(QWebSocket* client, const QString& text)
-{
-    const auto doc = QJsonDocument::fromJson(text.toUtf8());
-    if (!doc.isObject()) {
-        client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyErr({}, "bad_request", "Invalid JSON")).toJson(QJsonDocument::Compact)));
-        return;
-    }
-    const auto obj = doc.object();
-    const QString id = obj.value("id").toString();
-    const QString method = obj.value("method").toString();
-
-    if (method == QLatin1String("hello")) {
-        QJsonObject result{{"protocol", "qml-agent-bridge"},
-                           {"version", "0.2"},
-                           {"capabilities", QJsonArray{
-                               QLatin1String("list_roots"), QLatin1String("find_by_name"), QLatin1String("inspect"),
-                               QLatin1String("list_children"), QLatin1String("set_property"), QLatin1String("call_method"),
-                               QLatin1String("evaluate"), QLatin1String("subscribe_signal"), QLatin1String("subscribe_property"),
-                               QLatin1String("unsubscribe")
-                           }}};
-        client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyOk(id, result)).toJson(QJsonDocument::Compact)));
-        return;
-    }
-
-    if (method == QLatin1String("list_roots")) {
-        QJsonArray roots;
-        for (QObject* obj : m_engine->rootObjects()) {
-            QJsonObject r{{"objectId", idForObject(obj)},
-                          {"type", obj->metaObject()->className()},
-                          {"objectName", obj->objectName()}};
-            roots.push_back(r);
-        }
-        QJsonObject result{{"roots", roots}};
-        client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyOk(id, result)).toJson(QJsonDocument::Compact)));
-        return;
-    }
-
-    if (method == QLatin1String("find_by_name")) {
-        const auto params = obj.value("params").toObject();
-        const auto name = params.value("name").toString();
-        QJsonArray matches;
-        for (QObject* root : m_engine->rootObjects()) {
-            const auto list = root->findChildren<QObject*>(name, Qt::FindChildrenRecursively);
-            for (QObject* m : list) {
-                matches.push_back(QJsonObject{{"objectId", idForObject(m)},
-                                             {"type", m->metaObject()->className()},
-                                             {"objectName", m->objectName()}});
-            }
-        }
-        client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyOk(id, QJsonObject{{"matches", matches}})).toJson(QJsonDocument::Compact)));
-        return;
+InspectorServer::RpcResult InspectorServer::rpcFindByType(const RpcContext&, const QJsonObject& params)
+{
+    const auto type = params.value("type").toString();
+    if (type.isEmpty()) return RpcResult::error("bad_request", "type is required");
+    QJsonArray matches;
+    if (m_index) {
+        for (QObject* m : m_index->findByType(m_engine->rootObjects(), type)) matches.push_back(describeObject(m));
+        return RpcResult::ok({{"matches", matches}});
     }
+    const QByteArray className = type.toLatin1();
+    QObjectList descendants;
+    for (QObject* root : m_engine->rootObjects()) descendants += root->children();
+    auto walk = QSharedPointer<ResumableWalk>::create(descendants);
+    auto found = QSharedPointer<QJsonArray>::create();
+    return RpcResult::deferred([this, walk, found, className](const QDeadlineTimer& deadline, RpcResult* out) {
+        const bool done = walk->run(deadline, [&](QObject* obj) {
+            if (className == obj->metaObject()->className()) found->push_back(describeObject(obj));
+        });
+        if (done) *out = RpcResult::ok({{"matches", *found}});
+        return done;
+    });
+}
 
-    if (method == QLatin1String("list_children")) {
-        const auto params = obj.value("params").toObject();
-        const auto oid = params.value("objectId").toString();
-        QObject* target = objectFromId(oid);
-        if (!target) {
-            client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyErr(id, "not_found", "Object not found")).toJson(QJsonDocument::Compact)));
-            return;
-        }
-        QJsonArray children;
-        for (QObject* c : target->children()) {
-            children.push_back(QJsonObject{{"objectId", idForObject(c)},
-                                          {"type", c->metaObject()->className()},
-                                          {"objectName", c->objectName()}});
-        }
-        qInfo() << "RPC list_children" << oid << "->" << children.size();
-        client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyOk(id, QJsonObject{{"children", children}})).toJson(QJsonDocument::Compact)));
-        return;
+InspectorServer::RpcResult InspectorServer::rpcListChildren(const RpcContext&, const QJsonObject& params)
+{
+    const auto oid = params.value("objectId").toString();
+    QObject* target = objectFromId(oid);
+    if (!target) return RpcResult::error("not_found", "Object not found");
+    QJsonArray children;
+    for (QObject* c : target->children()) children.push_back(describeObject(c));
+    return RpcResult::ok({{"children", children}});
+}
+
+InspectorServer::RpcResult InspectorServer::rpcInspect(const RpcContext&, const QJsonObject& params)
+{
+    QObject* target = objectFromId(params.value("objectId").toString());
+    if (!target) return RpcResult::error("not_found", "Object not found");
+    const bool valuesOnly = params.value("mode").toString() == QLatin1String("values");
+    return RpcResult::ok(inspectObject(target, valuesOnly));
+}
+
+InspectorServer::RpcResult InspectorServer::rpcGetSchema(const RpcContext&, const QJsonObject& params)
+{
+    const ClassSchema* schema = nullptr;
+    if (params.contains("schemaId")) {
+        schema = m_schemas.find(params.value("schemaId").toString());
+    } else if (const ObjectRegistry::Entry* e = m_registry->find(params.value("objectId").toString())) {
+        schema = &m_schemas.forMetaObject(e->metaObject);
     }
+    if (!schema) return RpcResult::error("not_found", "Schema not found");
+    return RpcResult::ok(schema->json);
+}
 
-    if (method == QLatin1String("inspect")) {
-        const auto params = obj.value("params").toObject();
-        const auto oid = params.value("objectId").toString();
-        QObject* target = objectFromId(oid);
-        if (!target) {
-            client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyErr(id, "not_found", "Object not found")).toJson(QJsonDocument::Compact)));
-            return;
-        }
-        client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyOk(id, inspectObject(target))).toJson(QJsonDocument::Compact)));
-        return;
-    }
-
-    if (method == QLatin1String("model_info")) {
-        const auto params = obj.value("params").toObject();
-        const auto oid = params.value("objectId").toString();
-        QObject* target = objectFromId(oid);
-        auto* model = qobject_cast<QAbstractItemModel*>(target);
-        if (!model) { client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyErr(id, "bad_request", "Target is not a model")).toJson(QJsonDocument::Compact))); return; }
-        QJsonObject out;
-        out.insert("rowCount", model->rowCount());
-        out.insert("columnCount", model->columnCount());
-        QJsonArray roles;
-        const auto r = model->roleNames();
-        for (auto it = r.begin(); it != r.end(); ++it) roles.push_back(QString::fromUtf8(it.value()));
-        out.insert("roles", roles);
-        client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyOk(id, out)).toJson(QJsonDocument::Compact)));
-        return;
-    }
-
-    if (method == QLatin1String("model_fetch")) {
-        const auto params = obj.value("params").toObject();
-        const auto oid = params.value("objectId").toString();
-        const int start = params.value("start").toInt(0);
-        const int count = params.value("count").toInt(20);
-        const auto rolesParam = params.value("roles");
-        QObject* target = objectFromId(oid);
-        auto* model = qobject_cast<QAbstractItemModel*>(target);
-        if (!model) { client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyErr(id, "bad_request", "Target is not a model")).toJson(QJsonDocument::Compact))); return; }
-        const int rc = model->rowCount();
-        const int cc = model->columnCount();
-        const int from = qMax(0, start);
-        const int to = qMin(rc, from + qMax(0, count));
-        const auto roleNames = model->roleNames();
-
-        // Build role id set
-        QVector<int> roleIds;
-        if (rolesParam.isArray()) {
-            const auto arr = rolesParam.toArray();
-            for (const auto& v : arr) {
-                if (!v.isString()) continue;
-                const QByteArray name = v.toString().toUtf8();
-                int found = -1;
-                for (auto it = roleNames.begin(); it != roleNames.end(); ++it) {
-                    if (it.value() == name) { found = it.key(); break; }
-                }
-                if (found >= 0) roleIds.push_back(found);
-            }
-        } else {
-            // default: all roles
-            for (auto it = roleNames.begin(); it != roleNames.end(); ++it) roleIds.push_back(it.key());
-        }
+InspectorServer::RpcResult InspectorServer::rpcModelInfo(const RpcContext&, const QJsonObject& params)
+{
+    QObject* target = objectFromId(params.value("objectId").toString());
+    auto* model = qobject_cast<QAbstractItemModel*>(target);
+    if (!model) return RpcResult::error("bad_request", "Target is not a model");
+    QJsonObject out;
+    out.insert("rowCount", model->rowCount());
+    out.insert("columnCount", model->columnCount());
+    QJsonArray roles;
+    const auto r = model->roleNames();
+    for (auto it = r.begin(); it != r.end(); ++it) roles.push_back(QString::fromUtf8(it.value()));
+    out.insert("roles", roles);
+    return RpcResult::ok(out);
+}
 
-        QJsonObject out;
-        out.insert("rowCount", rc);
-        out.insert("columnCount", cc);
-        if (cc <= 1) {
-            QJsonArray items;
-            for (int row = from; row < to; ++row) {
+InspectorServer::RpcResult InspectorServer::rpcModelFetch(const RpcContext&, const QJsonObject& params)
+{
+    const int start = params.value("start").toInt(0);
+    const int count = params.value("count").toInt(20);
+    QObject* target = objectFromId(params.value("objectId").toString());
+    auto* model = qobject_cast<QAbstractItemModel*>(target);
+    if (!model) return RpcResult::error("bad_request", "Target is not a model");
+    const int rc = model->rowCount();
+    const int cc = model->columnCount();
+    const int from = qMax(0, start);
+    const int to = qMin(rc, from + qMax(0, count));
+    const QVector<ModelRole> roles = ModelExport::resolveRoles(model, params.value("roles"));
+
+    // Rows are read in slices on m_jobs; rows removed in between are not returned.
+    const QPointer<QAbstractItemModel> guard(model);
+    auto rows = QSharedPointer<QJsonArray>::create();
+    auto next = QSharedPointer<int>::create(from);
+    const VariantConverter* convert = &m_converter;
+    return RpcResult::deferred([guard, rows, next, to, rc, cc, roles, convert](const QDeadlineTimer& deadline, RpcResult* out) {
+        if (!guard) {
+            *out = RpcResult::error("failed", "Model destroyed");
+            return true;
+        }
+        QAbstractItemModel* model = guard.data();
+        const int end = qMin(to, model->rowCount());
+        while (*next < end) {
+            const int row = (*next)++;
+            if (cc <= 1) {
                 QJsonObject item;
-                for (int role : roleIds) {
-                    const QByteArray roleName = roleNames.value(role);
-                    QVariant v = model->data(model->index(row, 0), role);
-                    item.insert(QString::fromUtf8(roleName), variantToJson(v));
-                }
-                items.push_back(item);
-            }
-            out.insert("items", items);
-        } else {
-            QJsonArray rows;
-            for (int row = from; row < to; ++row) {
+                for (const ModelRole& role : roles)
+                    item.insert(role.name, convert->toJson(model->data(model->index(row, 0), role.id)));
+                rows->push_back(item);
+            } else {
                 QJsonObject rowObj;
                 rowObj.insert("row", row);
                 QJsonArray columns;
                 for (int col = 0; col < cc; ++col) {
                     QJsonObject colObj;
-                    for (int role : roleIds) {
-                        const QByteArray roleName = roleNames.value(role);
-                        QVariant v = model->data(model->index(row, col), role);
-                        colObj.insert(QString::fromUtf8(roleName), variantToJson(v));
-                    }
+                    for (const ModelRole& role : roles)
+                        colObj.insert(role.name, convert->toJson(model->data(model->index(row, col), role.id)));
                     columns.push_back(colObj);
                 }
                 rowObj.insert("columns", columns);
-                rows.push_back(rowObj);
+                rows->push_back(rowObj);
             }
-            out.insert("rows", rows);
+            if (deadline.hasExpired()) return false;
         }
-        client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyOk(id, out)).toJson(QJsonDocument::Compact)));
-        return;
-    }
-
-    if (method == QLatin1String("set_property")) {
-        const auto params = obj.value("params").toObject();
-        const auto oid = params.value("objectId").toString();
-        const auto name = params.value("name").toString();
-        const auto value = params.value("value");
-        QObject* target = objectFromId(oid);
-        if (!target) { client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyErr(id, "not_found", "Object not found")).toJson(QJsonDocument::Compact))); return; }
-        QVariant v;
-        if (value.isBool()) v = value.toBool();
-        else if (value.isDouble()) v = value.toDouble();
-        else if (value.isString()) v = value.toString();
-        else if (value.isNull()) v = QVariant();
-        else { client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyErr(id, "bad_request", "Unsupported value type")).toJson(QJsonDocument::Compact))); return; }
-        bool ok = target->setProperty(name.toUtf8().constData(), v);
-        if (!ok) { client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyErr(id, "failed", "setProperty returned false")).toJson(QJsonDocument::Compact))); return; }
-        client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyOk(id, QJsonObject{{"ok", true}})).toJson(QJsonDocument::Compact)));
-        return;
-    }
-
-    if (method == QLatin1String("call_method")) {
-        const auto params = obj.value("params").toObject();
-        const auto oid = params.value("objectId").toString();
-        const auto name = params.value("name").toString();
-        const auto args = params.value("args").toArray();
-        QObject* target = objectFromId(oid);
-        if (!target) { client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyErr(id, "not_found", "Object not found")).toJson(QJsonDocument::Compact))); return; }
-        bool invoked = false;
-        if (args.isEmpty()) {
-            if (QQmlContext* ctx = QQmlEngine::contextForObject(target)) {
-                QQmlExpression expr(ctx, target, name + QLatin1String("()"));
-                QVariant v = expr.evaluate();
-                if (expr.hasError()) {
-                    client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyErr(id, "failed", expr.error().description())).toJson(QJsonDocument::Compact))); return;
-                }
-                QJsonObject result{{"ok", true}, {"result", variantToJson(v)}};
-                client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyOk(id, result)).toJson(QJsonDocument::Compact)));
-                return;
+        QJsonObject result;
+        result.insert("rowCount", rc);
+        result.insert("columnCount", cc);
+        result.insert(cc <= 1 ? QStringLiteral("items") : QStringLiteral("rows"), *rows);
+        *out = RpcResult::ok(result);
+        return true;
+    });
+}
+
+InspectorServer::RpcResult InspectorServer::rpcModelExport(const RpcContext& rpc, const QJsonObject& params)
+{
+    auto state = m_clients.find(rpc.client);
+    if (state == m_clients.end()) return RpcResult::error("failed", "Client is gone");
+    QObject* target = objectFromId(params.value("objectId").toString());
+    auto* model = qobject_cast<QAbstractItemModel*>(target);
+    if (!model) return RpcResult::error("bad_request", "Target is not a model");
+    const int rc = model->rowCount();
+    const int column = params.value("column").toInt(0);
+    if (column < 0 || column >= qMax(1, model->columnCount())) return RpcResult::error("bad_request", "column out of range");
+    const int from = qBound(0, params.value("start").toInt(0), rc);
+    const int to = params.contains("count") ? qMin(rc, from + qMax(0, params.value("count").toInt())) : rc;
+    const int chunkSize = qBound(1, params.value("chunkSize").toInt(kDefaultExportChunk), kMaxExportChunk);
+    const QVector<ModelRole> roles = ModelExport::resolveRoles(model, params.value("roles"));
+
+    const QString exportId = QStringLiteral("exp:%1").arg(m_nextExportId++);
+    state->exports.insert(exportId, QSharedPointer<ModelExport>::create(model, roles, column, from, to, chunkSize, &m_converter));
+    // Chunks start on the next event-loop turn, after this reply went out.
+    m_exportTimer->start();
+
+    QJsonArray roleNames;
+    for (const ModelRole& role : roles) roleNames.push_back(role.name);
+    return RpcResult::ok({{"exportId", exportId},
+                          {"rowCount", rc},
+                          {"columnCount", model->columnCount()},
+                          {"column", column},
+                          {"start", from},
+                          {"end", to},
+                          {"chunkSize", chunkSize},
+                          {"roles", roleNames}});
+}
+
+InspectorServer::RpcResult InspectorServer::rpcModelExportCancel(const RpcContext& rpc, const QJsonObject& params)
+{
+    auto state = m_clients.find(rpc.client);
+    const QString exportId = params.value("exportId").toString();
+    if (state == m_clients.end() || !state->exports.contains(exportId))
+        return RpcResult::error("not_found", "Export not found or finished");
+    const QSharedPointer<ModelExport> exp = state->exports.take(exportId);
+    // Restart with model_export { start: nextRow } to resume.
+    return RpcResult::ok({{"ok", true}, {"nextRow", exp->nextRow()}});
+}
+
+void InspectorServer::onExportTick()
+{
+    const Metrics::GuiScope timing(m_metrics);
+    bool pending = false;
+    for (auto client = m_clients.begin(); client != m_clients.end(); ++client) {
+        auto& exports = client->exports;
+        for (auto it = exports.begin(); it != exports.end();) {
+            ModelExport& exp = *it.value();
+            QJsonObject chunk;
+            const QString aborted = exp.abortReason();
+            if (aborted.isEmpty()) chunk = exp.nextChunk();
+            else chunk.insert("aborted", aborted);
+            const bool finished = !aborted.isEmpty() || exp.isDone();
+            chunk.insert("exportId", it.key());
+            if (finished) {
+                chunk.insert("done", true);
+                chunk.insert("nextRow", exp.nextRow());
+            }
+            sendMessage(client.key(), QJsonObject{{"method", "model_chunk"}, {"params", chunk}}, Metrics::kEventSlot);
+            if (finished) {
+                it = exports.erase(it);
             } else {
-                invoked = QMetaObject::invokeMethod(target, name.toUtf8().constData());
+                pending = true;
+                ++it;
             }
-        } else {
-            // Build a QML expression: name(arg0, arg1, ...)
-            QStringList parts;
-            parts.reserve(args.size());
-            for (const QJsonValue& v : args) {
-                if (v.isBool()) parts << (v.toBool() ? QLatin1String("true") : QLatin1String("false"));
-                else if (v.isDouble()) parts << QString::number(v.toDouble(), 'g', 16);
-                else if (v.isString()) {
-                    QString s = v.toString();
-                    s.replace(QLatin1String("\\"), QLatin1String("\\\\"));
-                    s.replace(QLatin1String("\""), QLatin1String("\\\""));
-                    s.replace(QLatin1String("\n"), QLatin1String("\\n"));
-                    s.replace(QLatin1String("\r"), QLatin1String("\\r"));
-                    parts << (QLatin1String("\"") + s + QLatin1String("\""));
-                }
-                else if (v.isNull()) parts << QLatin1String("null");
-                else { client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyErr(id, "bad_request", "Unsupported arg type")).toJson(QJsonDocument::Compact))); return; }
+        }
+    }
+    if (!pending) m_exportTimer->stop();
+}
+
+InspectorServer::RpcResult InspectorServer::rpcSetProperty(const RpcContext&, const QJsonObject& params)
+{
+    const auto name = params.value("name").toString();
+    const auto value = params.value("value");
+    QObject* target = objectFromId(params.value("objectId").toString());
+    if (!target) return RpcResult::error("not_found", "Object not found");
+    QVariant v;
+    if (value.isBool()) v = value.toBool();
+    else if (value.isDouble()) v = value.toDouble();
+    else if (value.isString()) v = value.toString();
+    else if (value.isNull()) v = QVariant();
+    else return RpcResult::error("bad_request", "Unsupported value type");
+    bool ok = target->setProperty(name.toUtf8().constData(), v);
+    if (!ok) return RpcResult::error("failed", "setProperty returned false");
+    return RpcResult::ok({{"ok", true}});
+}
+
+InspectorServer::RpcResult InspectorServer::rpcSetProperties(const RpcContext&, const QJsonObject& params)
+{
+    // { objectId, values: { name: value } } for one object, writes[] for any;
+    // both may be given, values first.
+    QJsonArray writes;
+    if (params.contains("values")) {
+        const QJsonObject values = params.value("values").toObject();
+        for (auto it = values.constBegin(); it != values.constEnd(); ++it)
+            writes.push_back(QJsonObject{{"objectId", params.value("objectId")}, {"name", it.key()}, {"value", it.value()}});
+    }
+    for (const QJsonValue& w : params.value("writes").toArray()) writes.push_back(w);
+    if (writes.isEmpty()) return RpcResult::error("bad_request", "Nothing to write: pass values or writes");
+    if (writes.size() > kMaxPropertyWrites)
+        return RpcResult::error("bad_request", QStringLiteral("At most %1 writes per call").arg(kMaxPropertyWrites));
+
+    // Resolve and convert everything before touching anything, so a bad
+    // entry leaves every property as it was.
+    struct Write {
+        QQmlProperty property;
+        QPointer<QObject> target;
+        QVariant value;
+        QVariant previous; // read just before the write, restored if a later one is rejected
+    };
+    QVector<Write> planned;
+    planned.reserve(writes.size());
+    QStringList errors;
+    for (int i = 0; i < writes.size(); ++i) {
+        const QJsonObject w = writes.at(i).toObject();
+        const QString objectId = w.value("objectId").toString();
+        const QString name = w.value("name").toString();
+        const QString where = QStringLiteral("writes[%1] %2.%3: ").arg(i).arg(objectId, name);
+        QObject* target = objectFromId(objectId);
+        if (!target) {
+            errors << where + QLatin1String("object not found");
+            continue;
+        }
+        // QQmlProperty also covers grouped names ("anchors.margins") and QML-declared properties.
+        QQmlProperty prop(target, name);
+        if (!prop.isValid() || !prop.isProperty()) {
+            errors << where + QLatin1String("no such property");
+            continue;
+        }
+        if (!prop.isWritable()) {
+            errors << where + QLatin1String("read-only");
+            continue;
+        }
+        const QMetaProperty mp = prop.property();
+        QVariant value;
+        QString why;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+        const QMetaType type = prop.propertyMetaType();
+#else
+        const QMetaType type(prop.propertyType());
+#endif
+        if (!m_converter.fromJson(w.value("value"), type, &value, &why, mp.isEnumType() ? mp.enumerator() : QMetaEnum())) {
+            errors << where + why;
+            continue;
+        }
+        planned.push_back(Write{prop, target, std::move(value), QVariant()});
+    }
+    if (!errors.isEmpty()) {
+        QString message = errors.first();
+        if (errors.size() > 1) message += QStringLiteral(" (and %1 more)").arg(errors.size() - 1);
+        return RpcResult::error("bad_request", message);
+    }
+
+    // One pass. Bindings that depend on a property re-evaluate synchronously
+    // on each write; only polish and layout wait for the handler to return,
+    // so they run once. Each previous value is read right before its write,
+    // after bindings triggered by earlier writes have run.
+    for (int i = 0; i < planned.size(); ++i) {
+        Write& w = planned[i];
+        if (w.target) w.previous = w.property.read();
+        if (w.target && w.property.write(w.value)) continue;
+        for (int j = i - 1; j >= 0; --j) {
+            if (planned[j].target) planned[j].property.write(planned[j].previous);
+        }
+        return RpcResult::error("failed",
+                                QStringLiteral("writes[%1] %2: write rejected; earlier values were restored, but bindings "
+                                               "on the written properties were removed and are not restored")
+                                    .arg(i)
+                                    .arg(w.property.name()));
+    }
+    return RpcResult::ok({{"ok", true}, {"written", int(planned.size())}});
+}
+
+InspectorServer::RpcResult InspectorServer::rpcCallMethod(const RpcContext&, const QJsonObject& params)
+{
+    const auto name = params.value("name").toString();
+    const auto args = params.value("args").toArray();
+    QObject* target = objectFromId(params.value("objectId").toString());
+    if (!target) return RpcResult::error("not_found", "Object not found");
+    QVariant returned;
+    switch (m_invoker.invoke(target, name, args, &returned)) {
+    case MethodInvoker::Outcome::Invoked:
+        return RpcResult::ok({{"ok", true}, {"result", variantToJson(returned)}});
+    case MethodInvoker::Outcome::Failed:
+        return RpcResult::error("failed", "invoke failed");
+    case MethodInvoker::Outcome::NotApplicable:
+        break;
+    }
+
+    // Not a method of the target that takes these arguments (e.g. a function
+    // of an enclosing QML scope): call it from QML. A cached wrapper function
+    // receives the arguments, so varying arguments do not recompile.
+    QQmlContext* ctx = QQmlEngine::contextForObject(target);
+    if (!ctx) return RpcResult::error("failed", "No QML context for target");
+    const auto wrapper = m_expressions.get(ctx, target, QStringLiteral("(function() { return %1(...arguments); })").arg(name));
+    const QJSValue fn = wrapper->evaluate().value<QJSValue>();
+    if (wrapper->hasError()) return RpcResult::error("failed", wrapper->error().description());
+    if (fn.isCallable()) {
+        QJSValueList jsArgs;
+        jsArgs.reserve(args.size());
+        for (const QJsonValue& arg : args) jsArgs.push_back(ctx->engine()->toScriptValue(arg.toVariant()));
+        const QJSValue ret = fn.call(jsArgs);
+        if (ret.isError()) return RpcResult::error("failed", ret.toString());
+        return RpcResult::ok({{"ok", true}, {"result", variantToJson(QVariant::fromValue(ret))}});
+    }
+
+    // Engines that hand the function back as a plain value: inline the arguments.
+    QStringList parts;
+    parts.reserve(args.size());
+    for (const QJsonValue& v : args) {
+        if (v.isBool()) parts << (v.toBool() ? QLatin1String("true") : QLatin1String("false"));
+        else if (v.isDouble()) parts << QString::number(v.toDouble(), 'g', 16);
+        else if (v.isString()) {
+            QString s = v.toString();
+            s.replace(QLatin1String("\\"), QLatin1String("\\\\"));
+            s.replace(QLatin1String("\""), QLatin1String("\\\""));
+            s.replace(QLatin1String("\n"), QLatin1String("\\n"));
+            s.replace(QLatin1String("\r"), QLatin1String("\\r"));
+            parts << (QLatin1String("\"") + s + QLatin1String("\""));
+        }
+        else if (v.isNull()) parts << QLatin1String("null");
+        else return RpcResult::error("bad_request", "Unsupported arg type");
+    }
+    const QString callExpr = name + QLatin1String("(") + parts.join(QLatin1String(", ")) + QLatin1String(")");
+    const auto expr = m_expressions.get(ctx, target, callExpr);
+    const QVariant result = expr->evaluate();
+    if (expr->hasError()) return RpcResult::error("failed", expr->error().description());
+    return RpcResult::ok({{"ok", true}, {"result", variantToJson(result)}});
+}
+
+InspectorServer::RpcResult InspectorServer::rpcEvaluate(const RpcContext&, const QJsonObject& params)
+{
+    const auto expr = params.value("expression").toString();
+    QObject* target = objectFromId(params.value("objectId").toString());
+    if (!target) return RpcResult::error("not_found", "Object not found");
+    return RpcResult::ok(evaluateOnObject(target, expr));
+}
+
+InspectorServer::RpcResult InspectorServer::rpcSubscribeSignal(const RpcContext& rpc, const QJsonObject& params)
+{
+    const auto oid = params.value("objectId").toString();
+    const auto sig = params.value("signal").toString(); // e.g., "clicked()" or "textChanged(QString)"
+    const auto snapshot = params.value("snapshot"); // array or string of property names
+    QObject* target = objectFromId(oid);
+    if (!target) return RpcResult::error("not_found", "Object not found");
+
+    const QMetaObject* mo = target->metaObject();
+    const QByteArray normalizedWanted = QMetaObject::normalizedSignature(sig.toUtf8().constData());
+    const QString wantedBase = sig.section('(', 0, 0);
+    int signalIndex = -1;
+    QString signalName;
+    for (int i = 0; i < mo->methodCount(); ++i) {
+        QMetaMethod m = mo->method(i);
+        if (m.methodType() == QMetaMethod::Signal) {
+            const QByteArray mnorm = QMetaObject::normalizedSignature(m.methodSignature().constData());
+            const QString mbase = QString::fromLatin1(m.methodSignature()).section('(', 0, 0);
+            if (mnorm == normalizedWanted || mbase == wantedBase) {
+                // Signals with default arguments have cloned entries; senderSignalIndex()
+                // always reports the original, so index the subscription under it.
+                while (i > 0 && (mo->method(i).attributes() & QMetaMethod::Cloned)) --i;
+                signalIndex = i;
+                signalName = QString::fromLatin1(mo->method(i).methodSignature());
+                break;
             }
-            const QString callExpr = name + QLatin1String("(") + parts.join(QLatin1String(", ")) + QLatin1String(")");
-            if (QQmlContext* ctx = QQmlEngine::contextForObject(target)) {
-                QQmlExpression expr(ctx, target, callExpr);
-                QVariant v = expr.evaluate();
-                if (expr.hasError()) { client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyErr(id, "failed", expr.error().description())).toJson(QJsonDocument::Compact))); return; }
-                QJsonObject result{{"ok", true}, {"result", variantToJson(v)}};
-                client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyOk(id, result)).toJson(QJsonDocument::Compact)));
-                return;
-            } else {
-                client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyErr(id, "failed", "No QML context for target")).toJson(QJsonDocument::Compact))); return;
+        }
+    }
+    if (signalIndex < 0) {
+        // Fallback: if requesting FooChanged or FooChanged(...), attempt property notify
+        if (wantedBase.endsWith(QLatin1String("Changed"))) {
+            const QString propName = wantedBase.left(wantedBase.size() - 7);
+            const int pidx = mo->indexOfProperty(propName.toUtf8().constData());
+            if (pidx >= 0 && mo->property(pidx).hasNotifySignal()) {
+                signalIndex = mo->property(pidx).notifySignalIndex();
+                signalName = wantedBase + QLatin1String("()");
+                qInfo() << "RPC subscribe_signal (fallback to property notify)" << oid << signalName;
             }
         }
-        if (!invoked) { client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyErr(id, "failed", "invoke failed")).toJson(QJsonDocument::Compact))); return; }
-        client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyOk(id, QJsonObject{{"ok", true}})).toJson(QJsonDocument::Compact)));
-        return;
-    }
-
-    if (method == QLatin1String("evaluate")) {
-        const auto params = obj.value("params").toObject();
-        const auto oid = params.value("objectId").toString();
-        const auto expr = params.value("expression").toString();
-        QObject* target = objectFromId(oid);
-        if (!target) { client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyErr(id, "not_found", "Object not found")).toJson(QJsonDocument::Compact))); return; }
-        client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyOk(id, evaluateOnObject(target, expr))).toJson(QJsonDocument::Compact)));
-        return;
-    }
-
-    if (method == QLatin1String("subscribe_signal")) {
-        const auto params = obj.value("params").toObject();
-        const auto oid = params.value("objectId").toString();
-        const auto sig = params.value("signal").toString(); // e.g., "clicked()" or "textChanged(QString)"
-        const auto snapshot = params.value("snapshot"); // array or string of property names
-        QObject* target = objectFromId(oid);
-        if (!target) { client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyErr(id, "not_found", "Object not found")).toJson(QJsonDocument::Compact))); return; }
-
-        const QMetaObject* mo = target->metaObject();
-        // (debug dump removed)
-        const QByteArray normalizedWanted = QMetaObject::normalizedSignature(sig.toUtf8().constData());
-        const QString wantedBase = sig.section('(', 0, 0);
-        int signalIndex = -1;
-        QMetaMethod signalMethod;
-        for (int i = 0; i < mo->methodCount(); ++i) {
-            QMetaMethod m = mo->method(i);
-            if (m.methodType() == QMetaMethod::Signal) {
-                const QByteArray mnorm = QMetaObject::normalizedSignature(m.methodSignature().constData());
-                const QString mbase = QString::fromLatin1(m.methodSignature()).section('(', 0, 0);
-                if (mnorm == normalizedWanted || mbase == wantedBase) {
-                    signalIndex = m.methodIndex();
-                    signalMethod = m;
-                    break;
-                }
+    }
+    if (signalIndex < 0) return RpcResult::error("bad_request", "Signal not found on object");
+
+    auto info = SubscriptionPtr::create();
+    info->subscriptionId = QStringLiteral("sub:%1").arg(m_nextSubId++);
+    info->kind = QLatin1String("signal");
+    info->name = signalName;
+    info->objectId = idForObject(target);
+    info->signalIndex = signalIndex;
+    info->target = target;
+    info->client = rpc.client;
+    info->captureArgs = params.value("args").toBool(true);
+    if (snapshot.isArray()) {
+        const auto arr = snapshot.toArray();
+        for (const auto& v : arr) if (v.isString()) info->snapshotProperties.push_back(v.toString());
+    } else if (snapshot.isString()) {
+        info->snapshotProperties.push_back(snapshot.toString());
+    }
+    const QString rateError = applyRateOptions(*info, params);
+    if (!rateError.isEmpty()) return RpcResult::error("bad_request", rateError);
+    if (!addSubscription(info)) return RpcResult::error("failed", "Connection failed");
+    QJsonObject reply = subscriptionReply(*info);
+    if (info->captureArgs) {
+        QJsonArray names;
+        for (const QByteArray& n : mo->method(signalIndex).parameterNames()) names.push_back(QString::fromUtf8(n));
+        reply.insert("parameters", names);
+    }
+    return RpcResult::ok(reply);
+}
+
+InspectorServer::RpcResult InspectorServer::rpcSubscribeProperty(const RpcContext& rpc, const QJsonObject& params)
+{
+    const auto name = params.value("name").toString();
+    QObject* target = objectFromId(params.value("objectId").toString());
+    if (!target) return RpcResult::error("not_found", "Object not found");
+
+    // The context lets attached names ("Layout.fillWidth") resolve too.
+    QQmlProperty prop(target, name, QQmlEngine::contextForObject(target));
+    if (!prop.isValid() || !prop.object()) return RpcResult::error("bad_request", "Invalid property");
+
+    // QQmlProperty resolves grouped names to the core property and the object
+    // that has it: the item itself for value-type groups ("font.pixelSize"),
+    // the group or attached object for object groups ("anchors.margins",
+    // "Layout.fillWidth"). The notify signal fires on that object.
+    const QMetaProperty mp = prop.property();
+    if (!mp.hasNotifySignal()) return RpcResult::error("failed", "Notify connection failed");
+    QObject* sender = prop.object();
+    // Registered so its buckets are dropped when it is destroyed, like any sender's.
+    if (sender != target) m_registry->ensure(sender);
+
+    auto info = SubscriptionPtr::create();
+    info->subscriptionId = QStringLiteral("sub:%1").arg(m_nextSubId++);
+    info->kind = QLatin1String("property");
+    info->name = name;
+    info->objectId = idForObject(target);
+    info->signalIndex = mp.notifySignalIndex();
+    info->target = sender;
+    info->property = prop;
+    info->client = rpc.client;
+    const QString rateError = applyRateOptions(*info, params);
+    if (!rateError.isEmpty()) return RpcResult::error("bad_request", rateError);
+    if (!addSubscription(info)) return RpcResult::error("failed", "Notify connection failed");
+    return RpcResult::ok(subscriptionReply(*info));
+}
+
+QString InspectorServer::applyRateOptions(SubscriptionInfo& info, const QJsonObject& params)
+{
+    const QString coalesce = params.value("coalesce").toString(QStringLiteral("none"));
+    if (coalesce == QLatin1String("turn")) {
+        info.coalesce = true;
+    } else if (coalesce == QLatin1String("frame")) {
+        info.coalesce = true;
+        info.minIntervalMs = kFrameIntervalMs;
+    } else if (coalesce != QLatin1String("none")) {
+        return QStringLiteral("coalesce must be none, turn or frame");
+    }
+    const double minInterval = params.value("minIntervalMs").toDouble(0);
+    const double maxRate = params.value("maxRate").toDouble(0);
+    if (minInterval < 0 || maxRate < 0) return QStringLiteral("minIntervalMs and maxRate must not be negative");
+    info.minIntervalMs = qMax(info.minIntervalMs, int(minInterval));
+    if (maxRate > 0) info.minIntervalMs = qMax(info.minIntervalMs, int(std::ceil(1000.0 / maxRate)));
+    return {};
+}
+
+QJsonObject InspectorServer::subscriptionReply(const SubscriptionInfo& info) const
+{
+    QJsonObject out{{"subscriptionId", info.subscriptionId}};
+    if (info.isThrottled()) {
+        out.insert("coalesce", info.coalesce);
+        out.insert("minIntervalMs", info.minIntervalMs);
+    }
+    return out;
+}
+
+InspectorServer::RpcResult InspectorServer::rpcUnsubscribe(const RpcContext& rpc, const QJsonObject& params)
+{
+    const auto subId = params.value("subscriptionId").toString();
+    auto it = m_clients.find(rpc.client);
+    if (it != m_clients.end() && it->modelSubscriptions.remove(subId)) return RpcResult::ok({{"ok", true}});
+    if (it != m_clients.end() && it->treeSubscriptions.remove(subId)) return RpcResult::ok({{"ok", true}});
+    if (it != m_clients.end() && it->frameSubscriptions.remove(subId)) return RpcResult::ok({{"ok", true}});
+    if (it == m_clients.end() || !it->subscriptions.contains(subId)) return RpcResult::error("not_found", "Subscription not found");
+    removeSubscription(it->subscriptions.take(subId));
+    return RpcResult::ok({{"ok", true}});
+}
+
+InspectorServer::RpcResult InspectorServer::rpcSubscribeModel(const RpcContext& rpc, const QJsonObject& params)
+{
+    auto state = m_clients.find(rpc.client);
+    if (state == m_clients.end()) return RpcResult::error("failed", "Client is gone");
+    QObject* target = objectFromId(params.value("objectId").toString());
+    auto* model = qobject_cast<QAbstractItemModel*>(target);
+    if (!model) return RpcResult::error("bad_request", "Target is not a model");
+    const int column = params.value("column").toInt(0);
+    if (column < 0 || column >= qMax(1, model->columnCount())) return RpcResult::error("bad_request", "column out of range");
+    const QVector<ModelRole> roles = ModelExport::resolveRoles(model, params.value("roles"));
+    const bool includeValues = params.value("values").toBool(false);
+
+    const QString subId = QStringLiteral("sub:%1").arg(m_nextSubId++);
+    const auto watcher = QSharedPointer<ModelWatcher>::create(model, roles, includeValues, column,
+                                                              &m_converter,
+                                                              [this] { m_modelFlushTimer->start(); });
+    state->modelSubscriptions.insert(subId, ModelSubscription{idForObject(model), watcher});
+
+    QJsonArray roleNames;
+    for (const ModelRole& role : roles) roleNames.push_back(role.name);
+    return RpcResult::ok({{"subscriptionId", subId},
+                          {"rowCount", model->rowCount()},
+                          {"columnCount", model->columnCount()},
+                          {"roles", roleNames}});
+}
+
+void InspectorServer::flushModelChanges()
+{
+    const Metrics::GuiScope timing(m_metrics);
+    int deliveries = 0;
+    for (auto client = m_clients.begin(); client != m_clients.end(); ++client) {
+        const WireCodec* codec = codecFor(client.key());
+        auto& subs = client->modelSubscriptions;
+        for (auto it = subs.begin(); it != subs.end();) {
+            ModelWatcher& watcher = *it->watcher;
+            if (!watcher.hasPending()) {
+                ++it;
+                continue;
             }
+            const bool destroyed = watcher.isModelDestroyed();
+            const QJsonObject evt{{"objectId", it->objectId},
+                                  {"kind", "model"},
+                                  {"rowCount", watcher.rowCount()},
+                                  {"changes", watcher.takeChanges()}};
+            m_transport->sendEvent(client.key(), it.key(), evt, codec);
+            ++deliveries;
+            if (destroyed) it = subs.erase(it);
+            else ++it;
         }
-        if (signalIndex < 0) {
-            // Fallback: if requesting FooChanged or FooChanged(...), attempt property notify
-            QString base = wantedBase;
-            if (base.endsWith(QLatin1String("Changed"))) {
-                QString propName = base.left(base.size() - 7);
-                int pidx = mo->indexOfProperty(propName.toUtf8().constData());
-                if (pidx >= 0) {
-                    QMetaProperty mp = mo->property(pidx);
-                    if (mp.hasNotifySignal()) {
-                        int notifyIdx = mp.notifySignal().methodIndex();
-                        int slotIndex = this->metaObject()->indexOfSlot("onSignalTriggered()");
-                        QMetaMethod slotMethod = this->metaObject()->method(slotIndex);
-                        bool ok = QQmlProperty(target, propName).connectNotifySignal(this, slotMethod.methodIndex());
-                        if (ok) {
-                            const QString subId = QStringLiteral("sub:%1").arg(m_nextSubId++);
-                            SubscriptionInfo info;
-                            info.subscriptionId = subId;
-                            info.kind = QLatin1String("signal");
-                            info.name = base + QLatin1String("()");
-                            info.objectId = idForObject(target);
-                            info.signalIndex = notifyIdx;
-                            info.target = target;
-                            // no connection handle available from QQmlProperty::connectNotifySignal
-                            if (snapshot.isArray()) {
-                                const auto arr = snapshot.toArray();
-                                for (const auto& v : arr) if (v.isString()) info.snapshotProperties.push_back(v.toString());
-                            } else if (snapshot.isString()) {
-                                info.snapshotProperties.push_back(snapshot.toString());
-                            }
-                            m_subscriptions[client].insert(subId, info);
-                            qInfo() << "RPC subscribe_signal (fallback to property notify)" << oid << info.name;
-                            client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyOk(id, QJsonObject{{"subscriptionId", subId}})).toJson(QJsonDocument::Compact)));
-                            return;
-                        }
-                    }
+    }
+    m_metrics.recordFanout(deliveries);
+}
+
+InspectorServer::RpcResult InspectorServer::rpcSnapshotTree(const RpcContext&, const QJsonObject& params)
+{
+    QObject* root = nullptr;
+    if (params.contains("root")) {
+        root = objectFromId(params.value("root").toString());
+        if (!root) return RpcResult::error("not_found", "Root object not found");
+    }
+    const int depth = qMax(0, params.value("depth").toInt(kDefaultTreeDepth));
+    const int maxNodes = qBound(1, params.value("maxNodes").toInt(kDefaultTreeNodes), kMaxTreeNodes);
+    m_tree->start();
+    // Brings the mirror (and every subscriber) up to date, so the tree below
+    // is exactly the state after delta `seq`.
+    m_tree->flush(true);
+    if (root && !m_tree->contains(root)) return RpcResult::error("bad_request", "Root is not below the engine's root objects");
+    bool truncated = false;
+    const QJsonArray roots = m_tree->snapshot(root, depth, maxNodes, &truncated);
+    return RpcResult::ok({{"seq", double(m_tree->seq())}, {"truncated", truncated}, {"roots", roots}});
+}
+
+InspectorServer::RpcResult InspectorServer::rpcSubscribeTree(const RpcContext& rpc, const QJsonObject& params)
+{
+    auto state = m_clients.find(rpc.client);
+    if (state == m_clients.end()) return RpcResult::error("failed", "Client is gone");
+    TreeSubscription sub;
+    if (params.contains("root")) {
+        sub.root = objectFromId(params.value("root").toString());
+        sub.scoped = true;
+        if (!sub.root) return RpcResult::error("not_found", "Root object not found");
+    }
+    m_tree->start();
+    m_tree->flush();
+    if (sub.scoped && !m_tree->contains(sub.root)) return RpcResult::error("bad_request", "Root is not below the engine's root objects");
+
+    QJsonObject reply;
+    if (params.contains("sinceSeq")) {
+        // Catch-up: the deltas missed since then, or complete:false when the
+        // journal no longer reaches back that far and a snapshot is needed.
+        QJsonArray missed;
+        const bool complete = m_tree->changesSince(quint64(params.value("sinceSeq").toDouble()), sub.root, &missed);
+        reply.insert("complete", complete);
+        if (complete) reply.insert("changes", missed);
+    }
+    const QString subId = QStringLiteral("sub:%1").arg(m_nextSubId++);
+    state->treeSubscriptions.insert(subId, sub);
+    reply.insert("subscriptionId", subId);
+    reply.insert("seq", double(m_tree->seq()));
+    return RpcResult::ok(reply);
+}
+
+void InspectorServer::deliverTreeChanges(const QVector<TreeWatcher::Change>& changes)
+{
+    const Metrics::GuiScope timing(m_metrics);
+    int deliveries = 0;
+    QJsonArray all;
+    for (auto client = m_clients.begin(); client != m_clients.end(); ++client) {
+        const WireCodec* codec = codecFor(client.key());
+        for (auto it = client->treeSubscriptions.cbegin(); it != client->treeSubscriptions.cend(); ++it) {
+            QJsonArray selected;
+            if (!it->scoped) {
+                if (all.isEmpty())
+                    for (const TreeWatcher::Change& change : changes) all.push_back(change.delta);
+                selected = all;
+            } else {
+                for (const TreeWatcher::Change& change : changes) {
+                    if (m_tree->isWithin(change.anchors[0], it->root) || m_tree->isWithin(change.anchors[1], it->root))
+                        selected.push_back(change.delta);
                 }
             }
-            client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyErr(id, "bad_request", "Signal not found on object")).toJson(QJsonDocument::Compact))); return;
+            if (selected.isEmpty()) continue;
+            m_transport->sendEvent(client.key(), it.key(),
+                                   {{"kind", "tree"}, {"seq", double(changes.back().seq)}, {"changes", selected}}, codec);
+            ++deliveries;
         }
+    }
+    m_metrics.recordFanout(deliveries);
+}
 
-        int slotIndex = this->metaObject()->indexOfSlot("onSignalTriggered()");
-        QMetaMethod slotMethod = this->metaObject()->method(slotIndex);
+#ifdef QAB_ENABLE_CAPTURE
+namespace {
+// objectId (a window or an item in one), or the first window among the engine roots.
+QQuickWindow* captureWindow(const QJsonObject& params, QObject* target, const QObjectList& roots)
+{
+    if (params.contains("objectId")) return FrameCapture::windowOf(target);
+    for (QObject* root : roots) {
+        if (QQuickWindow* window = FrameCapture::windowOf(root)) return window;
+    }
+    return nullptr;
+}
+}
+#endif
 
-        QMetaObject::Connection conn = QObject::connect(target, signalMethod, this, slotMethod);
-        // Fallback to string-based connect for broader compatibility (allows extra args)
-        if (!conn) {
-            const QByteArray sigStr = QByteArrayLiteral("2") + normalizedWanted; // SIGNAL()
-            const QByteArray slotStr = QByteArrayLiteral("1onSignalTriggered()"); // SLOT()
-            conn = QObject::connect(target, sigStr.constData(), this, slotStr.constData());
+InspectorServer::RpcResult InspectorServer::rpcCapture(const RpcContext&, const QJsonObject& params)
+{
+#ifdef QAB_ENABLE_CAPTURE
+    QObject* target = objectFromId(params.value("objectId").toString());
+    if (params.contains("objectId") && !target) return RpcResult::error("not_found", "Object not found");
+    QQuickWindow* window = captureWindow(params, target, m_engine->rootObjects());
+    if (!window) return RpcResult::error("bad_request", "No window to capture");
+    FrameOptions options;
+    const QString optionError = FrameOptions::fromParams(params, &options);
+    if (!optionError.isEmpty()) return RpcResult::error("bad_request", optionError);
+
+    QImage image = FrameCapture::grab(window, options.scale);
+    if (image.isNull()) return RpcResult::error("failed", "Window could not be grabbed");
+    // An item is cropped out of its window's grab.
+    if (auto* item = qobject_cast<QQuickItem*>(target)) {
+        const QRect rect = FrameCapture::itemRect(item, image, options.scale);
+        if (rect.isEmpty()) return RpcResult::error("failed", "Item is outside the window");
+        image = image.copy(rect);
+    }
+    const QByteArray data = FrameCapture::encode(image, options);
+    if (data.isEmpty()) return RpcResult::error("failed", "Image encoding unavailable");
+    return RpcResult::ok({{"width", image.width()},
+                          {"height", image.height()},
+                          {"encoding", FrameOptions::encodingName(options.encoding)},
+                          {"data", QString::fromLatin1(data.toBase64())}});
+#else
+    Q_UNUSED(params);
+    return RpcResult::error("not_implemented", "Built without QAB_ENABLE_CAPTURE");
+#endif
+}
+
+InspectorServer::RpcResult InspectorServer::rpcSubscribeFrames(const RpcContext& rpc, const QJsonObject& params)
+{
+#ifdef QAB_ENABLE_CAPTURE
+    auto state = m_clients.find(rpc.client);
+    if (state == m_clients.end()) return RpcResult::error("failed", "Client is gone");
+    QObject* target = objectFromId(params.value("objectId").toString());
+    if (params.contains("objectId") && !target) return RpcResult::error("not_found", "Object not found");
+    QQuickWindow* window = captureWindow(params, target, m_engine->rootObjects());
+    if (!window) return RpcResult::error("bad_request", "No window to capture");
+    FrameOptions options;
+    const QString optionError = FrameOptions::fromParams(params, &options);
+    if (!optionError.isEmpty()) return RpcResult::error("bad_request", optionError);
+    const int maxFps = params.value("maxFps").toInt(kDefaultFrameFps);
+    if (maxFps < 1 || maxFps > kMaxFrameFps)
+        return RpcResult::error("bad_request", QStringLiteral("maxFps must be in 1..%1").arg(kMaxFrameFps));
+
+    const QString subId = QStringLiteral("sub:%1").arg(m_nextSubId++);
+    const quint64 client = rpc.client;
+    const QString windowId = idForObject(window);
+    const auto stream = QSharedPointer<FrameStream>::create(
+        window, options, maxFps, [this, client, subId, windowId](const QJsonObject& frame) {
+            const Metrics::GuiScope timing(m_metrics);
+            QJsonObject evt = frame;
+            evt.insert("objectId", windowId);
+            // Each frame is a delta against the previous one, so none may be replaced.
+            m_transport->sendEvent(client, subId, evt, codecFor(client), nullptr, false);
+            m_metrics.recordFanout(1);
+        });
+    state->frameSubscriptions.insert(subId, stream);
+    const QSize size = stream->frameSize();
+    return RpcResult::ok({{"subscriptionId", subId},
+                          {"objectId", windowId},
+                          {"width", size.width()},
+                          {"height", size.height()},
+                          {"maxFps", maxFps}});
+#else
+    Q_UNUSED(rpc);
+    Q_UNUSED(params);
+    return RpcResult::error("not_implemented", "Built without QAB_ENABLE_CAPTURE");
+#endif
+}
+
+InspectorServer::RpcResult InspectorServer::rpcResolve(const RpcContext&, const QJsonObject& params)
+{
+    const auto ids = params.value("objectIds");
+    if (!ids.isArray()) return RpcResult::error("bad_request", "objectIds must be an array");
+    QJsonArray objects;
+    for (const QJsonValue& v : ids.toArray()) {
+        const QString oid = v.toString();
+        const ObjectRegistry::Entry* e = m_registry->find(oid);
+        if (!e) {
+            objects.push_back(QJsonObject{{"objectId", oid}, {"alive", false}});
+            continue;
+        }
+        objects.push_back(QJsonObject{{"objectId", oid},
+                                      {"alive", true},
+                                      {"type", e->className},
+                                      {"objectName", e->object->objectName()}});
+    }
+    return RpcResult::ok({{"objects", objects}});
+}
+
+InspectorServer::RpcResult InspectorServer::rpcStats(const RpcContext& rpc, const QJsonObject&)
+{
+    QJsonObject index{{"enabled", m_index != nullptr}};
+    if (m_index) {
+        const ObjectIndex::Stats& st = m_index->stats();
+        index.insert("built", m_index->isBuilt());
+        index.insert("tracked", m_index->trackedCount());
+        index.insert("lookups", double(st.lookups));
+        index.insert("hits", double(st.hits));
+        index.insert("misses", double(st.misses));
+        index.insert("builds", double(st.builds));
+        index.insert("resyncs", double(st.resyncs));
+    }
+    int waiters = 0;
+    for (const ClientState& client : qAsConst(m_clients)) waiters += int(client.waiters.size());
+    QJsonObject frames{{"enabled", false}};
+#ifdef QAB_ENABLE_CAPTURE
+    int frameStreams = 0;
+    quint64 framesSent = 0;
+    for (const ClientState& client : qAsConst(m_clients)) {
+        frameStreams += int(client.frameSubscriptions.size());
+        for (const auto& stream : client.frameSubscriptions) framesSent += stream->framesSent();
+    }
+    frames = QJsonObject{{"enabled", true}, {"streams", frameStreams}, {"sent", double(framesSent)}};
+#endif
+    const JobScheduler::Stats& js = m_jobs->stats();
+    const QJsonObject jobs{{"budgetMs", m_jobs->budgetMs()},
+                           {"queued", m_jobs->queued()},
+                           {"activeClients", m_jobs->activeClients()},
+                           {"maxQueued", js.maxQueued},
+                           {"submitted", double(js.submitted)},
+                           {"completed", double(js.completed)},
+                           {"cancelled", double(js.cancelled)},
+                           {"slices", double(js.slices)},
+                           {"steps", double(js.steps)},
+                           {"busyMs", js.busyNs / 1e6},
+                           {"maxSliceMs", js.maxSliceNs / 1e6}};
+    QJsonObject metrics = m_metrics.toJson();
+    if (Metrics::kEnabled) {
+        metrics.insert("guiThreadMs", guiThreadNs() / 1e6);
+        QJsonArray delivered;
+        const auto state = m_clients.constFind(rpc.client);
+        if (state != m_clients.cend()) {
+            for (const SubscriptionPtr& info : state->subscriptions)
+                delivered.push_back(QJsonObject{{"subscriptionId", info->subscriptionId},
+                                                {"kind", info->kind},
+                                                {"name", info->name},
+                                                {"delivered", double(info->delivered)}});
         }
-        if (!conn) { client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyErr(id, "failed", "Connection failed")).toJson(QJsonDocument::Compact))); return; }
-
-        const QString subId = QStringLiteral("sub:%1").arg(m_nextSubId++);
-        SubscriptionInfo info;
-        info.subscriptionId = subId;
-        info.kind = QLatin1String("signal");
-        info.name = QString::fromLatin1(signalMethod.methodSignature());
-        info.objectId = idForObject(target);
-        info.signalIndex = signalIndex;
-        info.target = target;
-        info.connection = conn;
-        if (snapshot.isArray()) {
-            const auto arr = snapshot.toArray();
-            for (const auto& v : arr) if (v.isString()) info.snapshotProperties.push_back(v.toString());
-        } else if (snapshot.isString()) {
-            info.snapshotProperties.push_back(snapshot.toString());
+        metrics.insert("subscriptions", delivered);
+    }
+    const OutboundReport report = m_transport->outboundReport();
+    QJsonArray outboundClients;
+    for (const OutboundClientStats& c : report.clients) {
+        outboundClients.push_back(QJsonObject{{"client", double(c.clientId)},
+                                              {"self", c.clientId == rpc.client},
+                                              {"socketBytes", double(c.socketBytes)},
+                                              {"queuedBytes", double(c.queuedBytes)},
+                                              {"peakQueuedBytes", double(c.peakQueuedBytes)},
+                                              {"queuedReplies", c.queuedReplies},
+                                              {"queuedEvents", c.queuedEvents},
+                                              {"droppedEvents", double(c.droppedEvents)},
+                                              {"coalescedEvents", double(c.coalescedEvents)}});
+    }
+    const QJsonObject outbound{{"policy", OutboundLimits::policyName(m_outboundLimits.policy)},
+                               {"highWaterBytes", double(m_outboundLimits.highWaterBytes)},
+                               {"maxQueuedBytes", double(m_outboundLimits.maxQueuedBytes)},
+                               {"disconnects", double(report.disconnects)},
+                               {"clients", outboundClients}};
+    return RpcResult::ok({{"clients", int(m_clients.size())},
+                          {"ioThread", isIoThreadEnabled()},
+                          {"localServer", localServerName()},
+                          {"rssKb", residentKb()},
+                          {"handles", m_registry->size()},
+                          {"schemas", m_schemas.size()},
+                          {"selectors", QJsonObject{{"cached", int(m_selectors.size())},
+                                                    {"compiles", double(m_selectorCompiles)}}},
+                          {"calls", QJsonObject{{"direct", double(m_invoker.stats().invoked)},
+                                                {"fallback", double(m_invoker.stats().notApplicable)},
+                                                {"resolvedMethods", m_invoker.stats().resolved},
+                                                {"expressionsCached", m_expressions.size()},
+                                                {"expressionLookups", double(m_expressions.stats().lookups)},
+                                                {"expressionCompiles", double(m_expressions.stats().compiles)}}},
+                          {"jobs", jobs},
+                          {"waiters", waiters},
+                          {"tree", QJsonObject{{"started", m_tree->isStarted()},
+                                               {"tracked", m_tree->trackedCount()},
+                                               {"seq", double(m_tree->seq())},
+                                               {"journal", m_tree->journalSize()}}},
+                          {"frames", frames},
+                          {"outbound", outbound},
+                          {"metrics", metrics},
+                          {"index", index}});
+}
+
+InspectorServer::RpcResult InspectorServer::rpcCancel(const RpcContext& rpc, const QJsonObject& params)
+{
+    const QString requestId = params.value("requestId").toString();
+    if (!m_jobs->cancel(rpc.client, requestId)) {
+        auto state = m_clients.find(rpc.client);
+        if (state == m_clients.end() || !state->waiters.remove(requestId))
+            return RpcResult::error("not_found", "No pending request with that id");
+    }
+    sendReply({rpc.client, requestId, Metrics::kUnknownSlot}, RpcResult::error("cancelled", "Cancelled by the client"));
+    return RpcResult::ok({{"ok", true}});
+}
+
+// A wait_for request parked until its expression turns truthy, its target is
+// destroyed or it times out. The expression re-evaluates only when one of the
+// notify signals it read fires; the timeout is the only timer.
+struct InspectorServer::Waiter {
+    RpcContext ctx;
+    QPointer<QObject> target;
+    QQmlExpression* expression { nullptr };
+    QTimer* timeout { nullptr };
+    QElapsedTimer elapsed;
+    QVariant last;
+    qint64 executeNs { 0 };
+    int evaluations { 0 };
+    bool queued { false }; // a re-evaluation is posted
+
+    ~Waiter()
+    {
+        // Deleted later: this may run inside one of their signals.
+        if (expression) expression->deleteLater();
+        if (timeout) {
+            timeout->stop();
+            timeout->deleteLater();
         }
-        m_subscriptions[client].insert(subId, info);
+    }
 
-        client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyOk(id, QJsonObject{{"subscriptionId", subId}})).toJson(QJsonDocument::Compact)));
-        return;
+    QJsonObject reply(bool satisfied, const QJsonValue& value) const
+    {
+        return {{"satisfied", satisfied},
+                {"value", value},
+                {"evaluations", evaluations},
+                {"elapsedMs", double(elapsed.elapsed())}};
     }
+};
 
-    if (method == QLatin1String("subscribe_property")) {
-        const auto params = obj.value("params").toObject();
-        const auto oid = params.value("objectId").toString();
-        const auto name = params.value("name").toString();
-        QObject* target = objectFromId(oid);
-        if (!target) { client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyErr(id, "not_found", "Object not found")).toJson(QJsonDocument::Compact))); return; }
+InspectorServer::RpcResult InspectorServer::rpcWaitFor(const RpcContext& rpc, const QJsonObject& params)
+{
+    QObject* target = objectFromId(params.value("objectId").toString());
+    if (!target) return RpcResult::error("not_found", "Object not found");
+    const QString expression = params.value("expression").toString();
+    if (expression.isEmpty()) return RpcResult::error("bad_request", "expression is required");
+    if (rpc.id.isEmpty()) return RpcResult::error("bad_request", "wait_for needs a request id");
+    auto state = m_clients.find(rpc.client);
+    if (state == m_clients.end()) return RpcResult::error("failed", "Client is gone");
+    if (state->waiters.contains(rpc.id)) return RpcResult::error("bad_request", "Request id already waiting");
+    if (state->waiters.size() >= kMaxWaitersPerClient) return RpcResult::error("failed", "Too many pending wait_for requests");
+    QQmlContext* ctx = QQmlEngine::contextForObject(target);
+    if (!ctx) return RpcResult::error("failed", "No QML context for target");
+    const int timeoutMs = qBound(0, params.value("timeoutMs").toInt(kDefaultWaitTimeoutMs), kMaxWaitTimeoutMs);
 
-        QQmlProperty prop(target, name);
-        if (!prop.isValid()) { client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyErr(id, "bad_request", "Invalid property")).toJson(QJsonDocument::Compact))); return; }
-
-        int slotIndex = this->metaObject()->indexOfSlot("onSignalTriggered()");
-        QMetaMethod slotMethod = this->metaObject()->method(slotIndex);
-        bool ok = prop.connectNotifySignal(this, slotMethod.methodIndex());
-        if (!ok) { client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyErr(id, "failed", "Notify connection failed")).toJson(QJsonDocument::Compact))); return; }
-
-        // Try to resolve the notify signal index if available
-        int notifyIndex = -1;
-        const QMetaObject* mo = target->metaObject();
-        int propIndex = mo->indexOfProperty(name.toUtf8().constData());
-        if (propIndex >= 0) {
-            QMetaProperty mp = mo->property(propIndex);
-            if (mp.hasNotifySignal()) notifyIndex = mp.notifySignal().methodIndex();
+    auto waiter = QSharedPointer<Waiter>::create();
+    waiter->ctx = rpc;
+    waiter->target = target;
+    waiter->expression = new QQmlExpression(ctx, target, expression);
+    waiter->expression->setNotifyOnValueChanged(true);
+    waiter->elapsed.start();
+    RpcResult done;
+    if (evaluateWaiter(*waiter, &done)) return done;
+    if (timeoutMs == 0) return RpcResult::ok(waiter->reply(false, variantToJson(waiter->last)));
+
+    const QWeakPointer<Waiter> weak = waiter;
+    // Notify signals fire mid-update, so re-evaluate once, after the change.
+    connect(waiter->expression, &QQmlExpression::valueChanged, this, [this, weak] {
+        const auto w = weak.toStrongRef();
+        if (!w || w->queued) return;
+        w->queued = true;
+        QMetaObject::invokeMethod(this, [this, weak] {
+            const auto w = weak.toStrongRef();
+            if (!w) return;
+            const Metrics::GuiScope timing(m_metrics);
+            w->queued = false;
+            RpcResult r;
+            if (evaluateWaiter(*w, &r)) finishWaiter(w, r);
+        }, Qt::QueuedConnection);
+    });
+    connect(target, &QObject::destroyed, waiter->expression, [this, weak] {
+        if (const auto w = weak.toStrongRef()) finishWaiter(w, RpcResult::error("not_found", "Object destroyed"));
+    });
+    waiter->timeout = new QTimer;
+    waiter->timeout->setSingleShot(true);
+    connect(waiter->timeout, &QTimer::timeout, this, [this, weak] {
+        const auto w = weak.toStrongRef();
+        if (!w) return;
+        const Metrics::GuiScope timing(m_metrics);
+        finishWaiter(w, RpcResult::ok(w->reply(false, variantToJson(w->last))));
+    });
+    waiter->timeout->start(timeoutMs);
+    state->waiters.insert(rpc.id, waiter);
+    return RpcResult::parked();
+}
+
+bool InspectorServer::evaluateWaiter(Waiter& waiter, RpcResult* out)
+{
+    const qint64 start = Metrics::now();
+    waiter.expression->clearError();
+    waiter.last = waiter.expression->evaluate();
+    ++waiter.evaluations;
+    bool done = true;
+    if (waiter.expression->hasError())
+        *out = RpcResult::error("failed", waiter.expression->error().description());
+    else if (waiter.expression->engine()->toScriptValue(waiter.last).toBool()) // JS truthiness
+        *out = RpcResult::ok(waiter.reply(true, variantToJson(waiter.last)));
+    else
+        done = false;
+    waiter.executeNs += Metrics::now() - start;
+    return done;
+}
+
+void InspectorServer::finishWaiter(const QSharedPointer<Waiter>& waiter, const RpcResult& r)
+{
+    recordExecution(waiter->ctx.metricsSlot, r, waiter->executeNs);
+    sendReply(waiter->ctx, r);
+    auto state = m_clients.find(waiter->ctx.client);
+    if (state != m_clients.end()) state->waiters.remove(waiter->ctx.id);
+}
+
+InspectorServer::RpcResult InspectorServer::rpcQuery(const RpcContext& rpc, const QJsonObject& params)
+{
+    auto state = m_clients.find(rpc.client);
+    const int limit = qBound(1, params.value("limit").toInt(kDefaultQueryLimit), kMaxQueryLimit);
+    const int budget = qMax(1, params.value("budget").toInt(kDefaultQueryBudget));
+
+    QueryCursor cursor;
+    quint64 cursorId = 0;
+    if (params.contains("cursor")) {
+        bool ok = false;
+        cursorId = params.value("cursor").toString().mid(4).toULongLong(&ok);
+        if (!ok || state == m_clients.end() || !state->cursors.contains(cursorId))
+            return RpcResult::error("not_found", "Cursor not found or expired");
+        cursor = state->cursors.take(cursorId);
+    } else {
+        const QString text = params.value("selector").toString();
+        QSharedPointer<const Selector> selector;
+        if (auto* cached = m_selectors.object(text)) {
+            selector = *cached;
+        } else {
+            QString error;
+            selector = Selector::compile(text, &error);
+            if (!selector) return RpcResult::error("bad_request", QStringLiteral("selector: %1").arg(error));
+            ++m_selectorCompiles;
+            m_selectors.insert(text, new QSharedPointer<const Selector>(selector));
         }
 
-        const QString subId = QStringLiteral("sub:%1").arg(m_nextSubId++);
-        SubscriptionInfo info;
-        info.subscriptionId = subId;
-        info.kind = QLatin1String("property");
-        info.name = name;
-        info.objectId = idForObject(target);
-        info.signalIndex = notifyIndex;
-        info.target = target;
-        // We cannot get a QMetaObject::Connection from QQmlProperty::connectNotifySignal; leave default
-        m_subscriptions[client].insert(subId, info);
-
-        client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyOk(id, QJsonObject{{"subscriptionId", subId}})).toJson(QJsonDocument::Compact)));
-        return;
-    }
-
-    if (method == QLatin1String("unsubscribe")) {
-        const auto params = obj.value("params").toObject();
-        const auto subId = params.value("subscriptionId").toString();
-        auto it = m_subscriptions.find(client);
-        if (it == m_subscriptions.end() || !it->contains(subId)) {
-            client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyErr(id, "not_found", "Subscription not found")).toJson(QJsonDocument::Compact))); return;
+        QList<QObject*> scope;
+        if (params.contains("root")) {
+            QObject* root = objectFromId(params.value("root").toString());
+            if (!root) return RpcResult::error("not_found", "Object not found");
+            scope = root->children();
+        } else {
+            scope = m_engine->rootObjects();
         }
-        SubscriptionInfo info = it->value(subId);
-        if (info.connection) QObject::disconnect(info.connection);
-        it->remove(subId);
-        client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyOk(id, QJsonObject{{"ok", true}})).toJson(QJsonDocument::Compact)));
-        return;
+        cursor.walk = QSharedPointer<SelectorWalk>::create(selector, scope);
+        for (const QJsonValue& f : params.value("fields").toArray()) cursor.fields.push_back(f.toString());
     }
 
-    client->sendTextMessage(QString::fromUtf8(QJsonDocument(replyErr(id, "not_implemented", "Unknown method")).toJson(QJsonDocument::Compact)));
+    QList<QObject*> found;
+    const bool done = cursor.walk->next(limit, budget, &found);
+    QJsonArray matches;
+    for (QObject* obj : found) matches.push_back(projectObject(obj, cursor.fields));
+
+    QJsonObject result{{"matches", matches},
+                       {"done", done},
+                       {"visited", double(cursor.walk->visited())}};
+    if (!done && state != m_clients.end()) {
+        if (!cursorId) cursorId = m_nextCursorId++;
+        state->cursors.insert(cursorId, cursor);
+        while (state->cursors.size() > kMaxCursorsPerClient) state->cursors.erase(state->cursors.begin());
+        result.insert("cursor", QStringLiteral("cur:%1").arg(cursorId));
+    }
+    return RpcResult::ok(result);
+}
+
+InspectorServer::RpcResult InspectorServer::rpcBatch(const RpcContext& rpc, const QJsonObject& params)
+{
+    const auto requests = params.value("requests");
+    if (!requests.isArray()) return RpcResult::error("bad_request", "requests must be an array");
+    return RpcResult::deferred(batchContinuation(rpc.client, requests.toArray(), params.value("stopOnError").toBool(false)));
 }
 
 QJsonObject InspectorServer::replyOk(const QString& id, const QJsonObject& result)
@@ -479,78 +1556,70 @@ QJsonObject InspectorServer::replyErr(const QString& id, const QString& code, co
 
 QString InspectorServer::idForObject(QObject* obj)
 {
-    return QStringLiteral("qobj:%1").arg(reinterpret_cast<quintptr>(obj), 0, 16);
+    return m_registry->idFor(obj);
 }
 
-QObject* InspectorServer::objectFromId(const QString& id)
+QObject* InspectorServer::objectFromId(const QString& id) const
 {
-    if (!id.startsWith(QLatin1String("qobj:"))) return nullptr;
-    bool ok = false;
-    quintptr ptr = id.mid(5).toULongLong(&ok, 16);
-    if (!ok || ptr == 0) return nullptr;
-    return reinterpret_cast<QObject*>(ptr);
+    return m_registry->resolve(id);
 }
 
-QJsonValue InspectorServer::variantToJson(const QVariant& v)
+QJsonObject InspectorServer::describeObject(QObject* obj)
 {
-    if (!v.isValid()) {
-        return QJsonValue();
-    }
-    switch (v.typeId()) {
-    case QMetaType::Bool:
-        return QJsonValue(v.toBool());
-    case QMetaType::Int:
-    case QMetaType::LongLong:
-    case QMetaType::UInt:
-    case QMetaType::ULongLong:
-    case QMetaType::Double:
-        return QJsonValue(v.toDouble());
-    case QMetaType::QString:
-        return QJsonValue(v.toString());
-    case QMetaType::QVariantList: {
-        QJsonArray arr;
-        for (const auto& e : v.toList()) arr.push_back(variantToJson(e));
-        return arr;
-    }
-    case QMetaType::QVariantMap: {
-        QJsonObject o;
-        const auto map = v.toMap();
-        for (auto it = map.begin(); it != map.end(); ++it)
-            o.insert(it.key(), variantToJson(it.value()));
-        return o;
-    }
-    default:
-        return QJsonValue(QString::fromLatin1(v.typeName()));
+    const ObjectRegistry::Entry& e = m_registry->ensure(obj);
+    return QJsonObject{{"objectId", e.id},
+                       {"type", e.className},
+                       {"objectName", obj->objectName()}};
+}
+
+QJsonObject InspectorServer::projectObject(QObject* obj, const QStringList& fields)
+{
+    if (fields.isEmpty()) return describeObject(obj);
+    // Copies: converting an object-valued field registers that object, which
+    // can move the registry's entries.
+    const ObjectRegistry::Entry& e = m_registry->ensure(obj);
+    const QString className = e.className;
+    QJsonObject out{{"objectId", e.id}};
+    for (const QString& field : fields) {
+        if (field == QLatin1String("objectId")) continue;
+        if (field == QLatin1String("type")) out.insert(field, className);
+        else if (field == QLatin1String("objectName")) out.insert(field, obj->objectName());
+        else if (field == QLatin1String("childrenCount")) out.insert(field, obj->children().size());
+        else out.insert(field, variantToJson(obj->property(field.toUtf8().constData())));
     }
+    return out;
 }
 
-QJsonObject InspectorServer::inspectObject(QObject* obj)
+QJsonObject InspectorServer::inspectObject(QObject* obj, bool valuesOnly)
 {
+    const ObjectRegistry::Entry& entry = m_registry->ensure(obj);
+    const QMetaObject* mo = entry.metaObject;
     QJsonObject out;
-    out.insert("objectId", idForObject(obj));
-    out.insert("type", obj->metaObject()->className());
-    out.insert("objectName", obj->objectName());
+    out.insert("objectId", entry.id); // entry is not used past this point: values below may call ensure()
+    const ClassSchema& schema = m_schemas.forMetaObject(mo);
 
-    QJsonObject props;
-    const QMetaObject* mo = obj->metaObject();
-    for (int i = mo->propertyOffset(); i < mo->propertyCount(); ++i) {
-        const QMetaProperty p = mo->property(i);
-        props.insert(QString::fromLatin1(p.name()), variantToJson(obj->property(p.name())));
-    }
-    out.insert("properties", props);
+    out.insert("objectName", obj->objectName());
 
-    QJsonArray methods;
-    QJsonArray signalList;
-    for (int i = mo->methodOffset(); i < mo->methodCount(); ++i) {
-        const QMetaMethod m = mo->method(i);
-        const QString sig = QString::fromLatin1(m.methodSignature());
-        methods.push_back(sig);
-        if (m.methodType() == QMetaMethod::Signal) {
-            signalList.push_back(sig);
+    if (valuesOnly) {
+        // Positional values matching get_schema's property order; names,
+        // methods and signals are fetched once per class instead.
+        QJsonArray values;
+        for (int index : schema.propertyIndices)
+            values.push_back(variantToJson(mo->property(index).read(obj)));
+        out.insert("schemaId", schema.schemaId);
+        out.insert("values", values);
+    } else {
+        QJsonObject props;
+        for (int i = 0; i < schema.propertyIndices.size(); ++i) {
+            const QMetaProperty p = mo->property(schema.propertyIndices.at(i));
+            props.insert(schema.propertyNames.at(i), variantToJson(p.read(obj)));
         }
+        out.insert("type", schema.className);
+        out.insert("schemaId", schema.schemaId);
+        out.insert("properties", props);
+        out.insert("methods", schema.methods);
+        out.insert("signals", schema.signalList);
     }
-    out.insert("methods", methods);
-    out.insert("signals", signalList);
 
     // Child count for quick overview
     out.insert("childrenCount", obj->children().size());
@@ -567,10 +1636,10 @@ QJsonObject InspectorServer::evaluateOnObject(QObject* obj, const QString& expre
 {
     QJsonObject out;
     if (QQmlContext* ctx = QQmlEngine::contextForObject(obj)) {
-        QQmlExpression expr(ctx, obj, expression);
-        QVariant v = expr.evaluate();
-        if (expr.hasError()) {
-            out.insert("error", QJsonObject{{"message", expr.error().description()}, {"line", expr.error().line()}});
+        const auto expr = m_expressions.get(ctx, obj, expression);
+        const QVariant v = expr->evaluate();
+        if (expr->hasError()) {
+            out.insert("error", QJsonObject{{"message", expr->error().description()}, {"line", expr->error().line()}});
         } else {
             out.insert("result", variantToJson(v));
         }
@@ -580,51 +1649,197 @@ QJsonObject InspectorServer::evaluateOnObject(QObject* obj, const QString& expre
     return out;
 }
 
-void InspectorServer::onSignalTriggered()
+bool InspectorServer::addSubscription(const SubscriptionPtr& info)
+{
+    QObject* sender = info->target.data();
+    auto& signalBuckets = m_dispatch[sender];
+    auto bucket = signalBuckets.find(info->signalIndex);
+    if (bucket == signalBuckets.end()) {
+        // First subscriber for this (sender, signal): connect exactly once so the
+        // slot runs once per emission regardless of how many clients listen.
+        QMetaObject::Connection conn = m_signalRelay->connectTo(sender, info->signalIndex);
+        if (!conn) {
+            if (signalBuckets.isEmpty()) m_dispatch.remove(sender);
+            return false;
+        }
+        bucket = signalBuckets.insert(info->signalIndex, DispatchBucket{});
+        bucket->connection = conn;
+        const QMetaMethod signal = sender->metaObject()->method(info->signalIndex);
+        for (int p = 0; p < signal.parameterCount(); ++p) bucket->argTypes.push_back(signal.parameterType(p));
+    }
+    info->sender = sender;
+    if (bucket->argTypes.isEmpty()) info->captureArgs = false;
+    info->payloadKey = info->kind + QLatin1Char('\n') + info->name + QLatin1Char('\n')
+                       + info->snapshotProperties.join(QLatin1Char(','))
+                       + (info->captureArgs ? QLatin1String("\nargs") : QLatin1String());
+    bucket->subscriptions.push_back(info);
+    m_clients[info->client].subscriptions.insert(info->subscriptionId, info);
+    return true;
+}
+
+void InspectorServer::removeSubscription(const SubscriptionPtr& info)
 {
-    QObject* s = sender();
-    const int sigIndex = senderSignalIndex();
+    if (!info) return;
+    if (info->scheduled) {
+        m_throttled.removeOne(info);
+        info->scheduled = false;
+    }
+    auto signalBuckets = m_dispatch.find(info->sender);
+    if (signalBuckets == m_dispatch.end()) return;
+    auto bucket = signalBuckets->find(info->signalIndex);
+    if (bucket == signalBuckets->end() || !bucket->subscriptions.removeOne(info)) return;
+    if (bucket->subscriptions.isEmpty()) {
+        QObject::disconnect(bucket->connection);
+        signalBuckets->erase(bucket);
+        if (signalBuckets->isEmpty()) m_dispatch.erase(signalBuckets);
+    }
+}
+
+void InspectorServer::onSignalTriggered(QObject* s, int sigIndex, void** argv)
+{
+    const Metrics::GuiScope timing(m_metrics);
     if (!s) return;
 
-    // Broadcast to all clients that have a matching subscription
-    for (auto clientIt = m_subscriptions.begin(); clientIt != m_subscriptions.end(); ++clientIt) {
-        QWebSocket* client = clientIt.key();
-        const auto& subs = clientIt.value();
-        for (auto it = subs.begin(); it != subs.end(); ++it) {
-            const SubscriptionInfo& info = it.value();
-            bool matches = false;
-            if (info.target == s) {
-                if (info.signalIndex == -1 || info.signalIndex == sigIndex) {
-                    matches = true;
-                } else if (sigIndex >= 0) {
-                    const QMetaObject* smo = s->metaObject();
-                    if (sigIndex < smo->methodCount()) {
-                        const QMetaMethod em = smo->method(sigIndex);
-                        if (QString::fromLatin1(em.methodSignature()) == info.name) {
-                            matches = true;
-                        }
-                    }
-                }
+    const auto signalBuckets = m_dispatch.constFind(s);
+    if (signalBuckets == m_dispatch.cend()) return;
+    const auto bucket = signalBuckets->constFind(sigIndex);
+    if (bucket == signalBuckets->cend()) return;
+    // Copy (implicitly shared) so a slot re-entering the server cannot invalidate the loop.
+    const QVector<SubscriptionPtr> subs = bucket->subscriptions;
+    const QVector<int> argTypes = bucket->argTypes;
+
+    // Params bodies are built once per payload shape and encoded once per
+    // (shape, codec), then spliced with each subscription id, instead of
+    // building one document per subscription. With the I/O thread enabled
+    // the encoding happens there.
+    QHash<QString, QJsonObject> bodies;
+    QHash<QPair<QString, const WireCodec*>, QByteArray> encodedBodies;
+    // Arguments are read straight from the emission, converted once for
+    // every subscription that wants them; argv is only valid until we return.
+    QJsonArray args;
+    bool argsConverted = false;
+    const auto emissionArgs = [&]() -> const QJsonArray& {
+        if (!argsConverted) {
+            args = signalArguments(argTypes, argv);
+            argsConverted = true;
+        }
+        return args;
+    };
+    qint64 now = -1;
+    int deliveries = 0;
+    for (const SubscriptionPtr& info : subs) {
+        if (info->target != s) continue;
+        if (info->isThrottled()) {
+            if (info->captureArgs) info->lastArgs = emissionArgs();
+            // Fold into the pending delivery, or open a new window; the
+            // delivery reads the state current at that time.
+            if (info->scheduled) {
+                ++info->dropped;
+                continue;
             }
-            if (matches) {
-                QJsonObject evt{{"subscriptionId", info.subscriptionId},
-                                {"objectId", info.objectId},
-                                {"kind", info.kind},
-                                {"name", info.name}};
-                if (info.kind == QLatin1String("property")) {
-                    const QVariant val = s->property(info.name.toUtf8().constData());
-                    evt.insert("value", variantToJson(val));
-                }
-                if (info.kind == QLatin1String("signal") && !info.snapshotProperties.isEmpty()) {
-                    QJsonObject snap;
-                    for (const QString& propName : info.snapshotProperties) {
-                        snap.insert(propName, variantToJson(s->property(propName.toUtf8().constData())));
-                    }
-                    evt.insert("snapshot", snap);
-                }
-                QJsonObject envelope{{"method", "event"}, {"params", evt}};
-                client->sendTextMessage(QString::fromUtf8(QJsonDocument(envelope).toJson(QJsonDocument::Compact)));
+            if (now < 0) now = m_clock.elapsed();
+            const qint64 due = info->lastDeliveredMs < 0 ? now : info->lastDeliveredMs + info->minIntervalMs;
+            if (!info->coalesce && now >= due) {
+                deliverEvent(*info);
+                ++deliveries;
+                continue;
             }
+            info->scheduled = true;
+            m_throttled.push_back(info);
+            scheduleThrottled(int(qMax<qint64>(0, due - now)));
+            continue;
+        }
+        const WireCodec* codec = codecFor(info->client);
+        auto body = bodies.find(info->payloadKey);
+        if (body == bodies.end()) {
+            body = bodies.insert(info->payloadKey,
+                                 eventBody(*info, s, info->captureArgs ? emissionArgs() : QJsonArray()));
+        }
+        m_transport->sendEvent(info->client, info->subscriptionId, *body, codec,
+                               &encodedBodies[qMakePair(info->payloadKey, codec)]);
+        ++info->delivered;
+        ++deliveries;
+    }
+    m_metrics.recordFanout(deliveries);
+}
+
+QJsonArray InspectorServer::signalArguments(const QVector<int>& types, void** argv) const
+{
+    QJsonArray out;
+    for (int i = 0; i < types.size(); ++i) {
+        const void* data = argv[i + 1];
+        const int type = types.at(i);
+        switch (type) {
+        case QMetaType::Bool: out.push_back(*static_cast<const bool*>(data)); break;
+        case QMetaType::Int: out.push_back(*static_cast<const int*>(data)); break;
+        case QMetaType::Double: out.push_back(*static_cast<const double*>(data)); break;
+        case QMetaType::QString: out.push_back(*static_cast<const QString*>(data)); break;
+        case QMetaType::QVariant: out.push_back(variantToJson(*static_cast<const QVariant*>(data))); break;
+        case QMetaType::UnknownType: out.push_back(QJsonValue()); break;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+        default: out.push_back(variantToJson(QVariant(QMetaType(type), data))); break;
+#else
+        default: out.push_back(variantToJson(QVariant(type, data))); break;
+#endif
+        }
+    }
+    return out;
+}
+
+QJsonObject InspectorServer::eventBody(const SubscriptionInfo& info, QObject* sender, const QJsonArray& args) const
+{
+    QJsonObject evt{{"objectId", info.objectId},
+                    {"kind", info.kind},
+                    {"name", info.name}};
+    if (info.kind == QLatin1String("property")) evt.insert("value", variantToJson(info.property.read()));
+    if (info.kind == QLatin1String("signal") && !info.snapshotProperties.isEmpty()) {
+        QJsonObject snap;
+        for (const QString& propName : info.snapshotProperties) {
+            snap.insert(propName, variantToJson(sender->property(propName.toUtf8().constData())));
+        }
+        evt.insert("snapshot", snap);
+    }
+    if (info.captureArgs) evt.insert("args", args);
+    return evt;
+}
+
+void InspectorServer::deliverEvent(SubscriptionInfo& info)
+{
+    QObject* target = info.target.data();
+    if (!target) return;
+    QJsonObject evt = eventBody(info, target, info.lastArgs);
+    evt.insert("dropped", double(info.dropped));
+    info.dropped = 0;
+    info.lastDeliveredMs = m_clock.elapsed();
+    ++info.delivered;
+    m_transport->sendEvent(info.client, info.subscriptionId, evt, codecFor(info.client));
+}
+
+void InspectorServer::scheduleThrottled(int delayMs)
+{
+    if (!m_throttleTimer->isActive() || m_throttleTimer->remainingTime() > delayMs) m_throttleTimer->start(delayMs);
+}
+
+void InspectorServer::flushThrottled()
+{
+    const Metrics::GuiScope timing(m_metrics);
+    const qint64 now = m_clock.elapsed();
+    qint64 nextDue = -1;
+    int deliveries = 0;
+    // Take the list so deliveries (or subscriptions they trigger) can queue anew.
+    const QVector<SubscriptionPtr> pending = std::exchange(m_throttled, {});
+    for (const SubscriptionPtr& info : pending) {
+        if (!info->scheduled) continue; // removed meanwhile
+        const qint64 due = info->lastDeliveredMs < 0 ? now : info->lastDeliveredMs + info->minIntervalMs;
+        if (due > now) {
+            m_throttled.push_back(info);
+            if (nextDue < 0 || due < nextDue) nextDue = due;
+            continue;
         }
+        info->scheduled = false;
+        deliverEvent(*info);
+        ++deliveries;
     }
+    m_metrics.recordFanout(deliveries);
+    if (nextDue >= 0) scheduleThrottled(int(nextDue - now));
 }
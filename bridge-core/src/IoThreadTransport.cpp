@@ -0,0 +1,144 @@
+#include "IoThreadTransport.hpp"
+
+#include <QElapsedTimer>
+#include <QMetaObject>
+#include <utility>
+
+IoThreadTransport::IoThreadTransport(QObject* parent)
+    : Transport(parent)
+{
+    m_thread.setObjectName(QStringLiteral("qab-io"));
+    m_worker = new WebSocketTransport;
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+
+    // Direct connections: these run on the I/O thread and only enqueue.
+    connect(m_worker, &Transport::clientConnected, m_worker, [this](quint64 id) {
+        postInbound({Inbound::Connected, id, {}});
+    }, Qt::DirectConnection);
+    connect(m_worker, &Transport::clientDisconnected, m_worker, [this](quint64 id) {
+        postInbound({Inbound::Disconnected, id, {}});
+    }, Qt::DirectConnection);
+    connect(m_worker, &Transport::messageReceived, m_worker, [this](quint64 id, const QJsonValue& message) {
+        postInbound({Inbound::Message, id, message});
+    }, Qt::DirectConnection);
+    connect(m_worker, &Transport::eventsLost, m_worker, [this](quint64 id, const QStringList& subscriptionIds) {
+        postInbound({Inbound::EventsLost, id, {}, subscriptionIds});
+    }, Qt::DirectConnection);
+
+    m_thread.start();
+}
+
+IoThreadTransport::~IoThreadTransport()
+{
+    close();
+    m_thread.quit();
+    m_thread.wait();
+}
+
+bool IoThreadTransport::listen(const QHostAddress& address, quint16 port)
+{
+    bool ok = false;
+    QMetaObject::invokeMethod(m_worker, [&] {
+        ok = m_worker->listen(address, port);
+        m_port.store(m_worker->serverPort());
+    }, Qt::BlockingQueuedConnection);
+    m_listening.store(ok);
+    return ok;
+}
+
+bool IoThreadTransport::listenLocal(const QString& name)
+{
+    bool ok = false;
+    QString fullName;
+    QMetaObject::invokeMethod(m_worker, [&] {
+        ok = m_worker->listenLocal(name);
+        fullName = m_worker->localServerName();
+    }, Qt::BlockingQueuedConnection);
+    m_localName = fullName;
+    return ok;
+}
+
+void IoThreadTransport::close()
+{
+    if (!m_thread.isRunning()) return;
+    QMetaObject::invokeMethod(m_worker, [this] { m_worker->close(); }, Qt::BlockingQueuedConnection);
+    m_listening.store(false);
+    m_localName.clear();
+}
+
+void IoThreadTransport::send(quint64 clientId, const QJsonValue& message, const WireCodec* codec, int metricsSlot)
+{
+    postOutbound({clientId, codec, {}, metricsSlot, message});
+}
+
+void IoThreadTransport::sendEvent(quint64 clientId, const QString& subscriptionId, const QJsonObject& body,
+                                  const WireCodec* codec, QByteArray*, bool coalescable)
+{
+    postOutbound({clientId, codec, subscriptionId, Metrics::kEventSlot, body, coalescable});
+}
+
+void IoThreadTransport::setOutboundLimits(const OutboundLimits& limits)
+{
+    QMetaObject::invokeMethod(m_worker, [this, limits] { m_worker->setOutboundLimits(limits); }, Qt::QueuedConnection);
+}
+
+OutboundReport IoThreadTransport::outboundReport() const
+{
+    OutboundReport report;
+    QMetaObject::invokeMethod(m_worker, [&] { report = m_worker->outboundReport(); }, Qt::BlockingQueuedConnection);
+    return report;
+}
+
+void IoThreadTransport::setMetrics(Metrics* metrics)
+{
+    Transport::setMetrics(metrics);
+    QMetaObject::invokeMethod(m_worker, [this, metrics] { m_worker->setMetrics(metrics); }, Qt::BlockingQueuedConnection);
+}
+
+void IoThreadTransport::postInbound(Inbound in)
+{
+    m_inbound.push(std::move(in));
+    if (!m_inboundWake.exchange(true))
+        QMetaObject::invokeMethod(this, &IoThreadTransport::drainInbound, Qt::QueuedConnection);
+}
+
+void IoThreadTransport::postOutbound(Outbound out)
+{
+    m_outbound.push(std::move(out));
+    if (!m_outboundWake.exchange(true))
+        QMetaObject::invokeMethod(m_worker, [this] { drainOutbound(); }, Qt::QueuedConnection);
+}
+
+void IoThreadTransport::drainInbound()
+{
+    // Clear before draining: a producer that pushes after this posts a new wake.
+    m_inboundWake.store(false);
+    QElapsedTimer slice;
+    slice.start();
+    Inbound in;
+    while (m_inbound.tryPop(in)) {
+        switch (in.kind) {
+        case Inbound::Connected: emit clientConnected(in.clientId); break;
+        case Inbound::Disconnected: emit clientDisconnected(in.clientId); break;
+        case Inbound::Message: emit messageReceived(in.clientId, in.message); break;
+        case Inbound::EventsLost: emit eventsLost(in.clientId, in.subscriptionIds); break;
+        }
+        if (slice.elapsed() >= m_dispatchBudgetMs) {
+            // Let the UI render; pick up the rest on the next turn.
+            QMetaObject::invokeMethod(this, &IoThreadTransport::drainInbound, Qt::QueuedConnection);
+            return;
+        }
+    }
+}
+
+void IoThreadTransport::drainOutbound()
+{
+    m_outboundWake.store(false);
+    Outbound out;
+    while (m_outbound.tryPop(out)) {
+        if (out.subscriptionId.isEmpty()) m_worker->send(out.clientId, out.message, out.codec, out.metricsSlot);
+        else m_worker->sendEvent(out.clientId, out.subscriptionId, out.message.toObject(), out.codec, nullptr,
+                                 out.coalescable);
+    }
+}
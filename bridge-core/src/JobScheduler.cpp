@@ -0,0 +1,99 @@
+#include "JobScheduler.hpp"
+
+#include <QElapsedTimer>
+#include <QTimer>
+#include <utility>
+
+namespace {
+// Lower bound of a client's share of a slice, so every turn makes progress.
+constexpr qint64 kMinShareNs = 200000;
+}
+
+JobScheduler::JobScheduler(QObject* parent)
+    : QObject(parent)
+{
+    m_timer = new QTimer(this);
+    m_timer->setInterval(0);
+    connect(m_timer, &QTimer::timeout, this, &JobScheduler::runSlice);
+}
+
+void JobScheduler::setBudgetMs(double ms)
+{
+    m_budgetNs = qMax<qint64>(kMinShareNs, qint64(ms * 1e6));
+}
+
+void JobScheduler::submit(quint64 client, const QString& requestId, Step step, Done onDone)
+{
+    auto& queue = m_queues[client];
+    if (queue.isEmpty()) m_order.push_back(client);
+    queue.enqueue(Job{requestId, std::move(step), std::move(onDone)});
+    ++m_stats.submitted;
+    m_stats.maxQueued = qMax(m_stats.maxQueued, ++m_queued);
+    if (!m_timer->isActive()) m_timer->start();
+}
+
+bool JobScheduler::cancel(quint64 client, const QString& requestId)
+{
+    auto queue = m_queues.find(client);
+    if (queue == m_queues.end()) return false;
+    for (int i = 0; i < queue->size(); ++i) {
+        if (queue->at(i).requestId != requestId) continue;
+        queue->removeAt(i);
+        --m_queued;
+        ++m_stats.cancelled;
+        if (queue->isEmpty()) {
+            m_queues.erase(queue);
+            m_order.removeOne(client);
+        }
+        return true;
+    }
+    return false;
+}
+
+void JobScheduler::cancelClient(quint64 client)
+{
+    const QQueue<Job> queue = m_queues.take(client);
+    m_queued -= queue.size();
+    m_stats.cancelled += queue.size();
+    m_order.removeOne(client);
+}
+
+void JobScheduler::runSlice()
+{
+    QElapsedTimer clock;
+    clock.start();
+    ++m_stats.slices;
+    // Each client gets an equal share of the slice; clients that finish early
+    // leave the rest to the ones after them.
+    int turns = m_order.size();
+    while (turns-- > 0 && !m_order.isEmpty()) {
+        const qint64 left = m_budgetNs - clock.nsecsElapsed();
+        if (left <= 0) break;
+        const quint64 client = m_order.takeFirst();
+        const qint64 share = qMax(kMinShareNs, left / (m_order.size() + 1));
+        QDeadlineTimer deadline;
+        deadline.setPreciseRemainingTime(0, qMin(share, left), Qt::PreciseTimer);
+
+        while (!deadline.hasExpired()) {
+            auto queue = m_queues.find(client);
+            if (queue == m_queues.end() || queue->isEmpty()) break;
+            ++m_stats.steps;
+            // Copy the step: it may submit or cancel jobs, which can reshape the queue.
+            const Step step = queue->head().step;
+            const QString requestId = queue->head().requestId;
+            if (!step(deadline)) break;
+            queue = m_queues.find(client);
+            if (queue == m_queues.end() || queue->isEmpty() || queue->head().requestId != requestId) continue;
+            const Job job = queue->dequeue();
+            --m_queued;
+            ++m_stats.completed;
+            if (queue->isEmpty()) m_queues.erase(queue);
+            if (job.onDone) job.onDone();
+        }
+        if (m_queues.contains(client) && !m_order.contains(client)) m_order.push_back(client);
+    }
+    const qint64 spent = clock.nsecsElapsed();
+    m_stats.busyNs += spent;
+    m_stats.maxSliceNs = qMax(m_stats.maxSliceNs, spent);
+    if (m_order.isEmpty()) m_timer->stop();
+}
@@ -0,0 +1,121 @@
+#include "MethodInvoker.hpp"
+#include "ObjectRegistry.hpp"
+
+#include <QMetaMethod>
+#include <QMetaObject>
+#include <QObject>
+#include <array>
+#include <utility>
+
+namespace {
+constexpr int kMaxArgs = 10; // what QMetaMethod::invoke takes
+}
+
+MethodInvoker::MethodInvoker(ObjectRegistry* registry)
+    : m_registry(registry)
+{
+}
+
+int MethodInvoker::resolve(const QMetaObject* mo, const QString& name, int argc)
+{
+    const Key key{mo, name, argc};
+    const auto known = m_methods.constFind(key);
+    if (known != m_methods.cend()) return known.value();
+
+    // Most derived first, like a JS call on the object would pick.
+    const QByteArray utf8 = name.toUtf8();
+    int found = -1;
+    for (int i = mo->methodCount() - 1; i >= 0 && found < 0; --i) {
+        const QMetaMethod m = mo->method(i);
+        if (m.access() != QMetaMethod::Public || m.methodType() == QMetaMethod::Constructor) continue;
+        if (m.parameterCount() != argc || m.name() != utf8) continue;
+        bool typesKnown = m.returnType() != QMetaType::UnknownType;
+        for (int p = 0; p < argc && typesKnown; ++p) typesKnown = m.parameterType(p) != QMetaType::UnknownType;
+        if (typesKnown) found = i;
+    }
+    m_methods.insert(key, found);
+    m_stats.resolved = int(m_methods.size());
+    return found;
+}
+
+bool MethodInvoker::convertArg(const QJsonValue& arg, int type, QVariant* out) const
+{
+    if (type == QMetaType::QVariant) { // untyped QML function parameters
+        *out = arg.toVariant();
+        return true;
+    }
+    if (type == QMetaType::QJsonValue) {
+        *out = QVariant::fromValue(arg);
+        return true;
+    }
+    const QMetaType meta(type);
+    if (meta.flags() & QMetaType::PointerToQObject) {
+        QObject* obj = nullptr;
+        if (arg.isString()) {
+            obj = m_registry ? m_registry->resolve(arg.toString()) : nullptr;
+            if (!obj || (meta.metaObject() && !obj->metaObject()->inherits(meta.metaObject()))) return false;
+        } else if (!arg.isNull()) {
+            return false;
+        }
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+        *out = QVariant(meta, &obj);
+#else
+        *out = QVariant(type, &obj);
+#endif
+        return true;
+    }
+    QVariant v = arg.toVariant();
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    if (v.metaType() != meta && !v.convert(meta)) return false;
+#else
+    if (v.userType() != type && !v.convert(type)) return false;
+#endif
+    *out = std::move(v);
+    return true;
+}
+
+MethodInvoker::Outcome MethodInvoker::invoke(QObject* target, const QString& name, const QJsonArray& args, QVariant* result)
+{
+    const int argc = int(args.size());
+    const QMetaObject* mo = target->metaObject();
+    const int index = argc <= kMaxArgs ? resolve(mo, name, argc) : -1;
+    if (index < 0) {
+        ++m_stats.notApplicable;
+        return Outcome::NotApplicable;
+    }
+    const QMetaMethod method = mo->method(index);
+
+    std::array<QVariant, kMaxArgs> values;
+    std::array<QGenericArgument, kMaxArgs> generic;
+    for (int i = 0; i < argc; ++i) {
+        const int type = method.parameterType(i);
+        if (!convertArg(args.at(i), type, &values[size_t(i)])) {
+            ++m_stats.notApplicable;
+            return Outcome::NotApplicable;
+        }
+        // A QVariant parameter takes the QVariant itself, any other type its payload.
+        generic[size_t(i)] = type == QMetaType::QVariant
+            ? QGenericArgument("QVariant", &values[size_t(i)])
+            : QGenericArgument(QMetaType(type).name(), values[size_t(i)].constData());
+    }
+
+    const int returnType = method.returnType();
+    QVariant ret;
+    QGenericReturnArgument returnArg;
+    if (returnType == QMetaType::QVariant) {
+        returnArg = QGenericReturnArgument("QVariant", &ret);
+    } else if (returnType != QMetaType::Void) {
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+        ret = QVariant(QMetaType(returnType));
+#else
+        ret = QVariant(returnType, nullptr);
+#endif
+        returnArg = QGenericReturnArgument(QMetaType(returnType).name(), ret.data());
+    }
+    if (!method.invoke(target, Qt::DirectConnection, returnArg, generic[0], generic[1], generic[2], generic[3],
+                       generic[4], generic[5], generic[6], generic[7], generic[8], generic[9]))
+        return Outcome::Failed;
+    ++m_stats.invoked;
+    *result = std::move(ret);
+    return Outcome::Invoked;
+}
@@ -0,0 +1,177 @@
+#include "Metrics.hpp"
+
+#include <QJsonArray>
+
+namespace {
+const char* const kPhaseNames[Metrics::PhaseCount] = {"parse", "execute", "encode", "send"};
+
+QByteArray number(double value)
+{
+    return QByteArray::number(value, 'g', 12);
+}
+
+QJsonObject histogramJson(const LatencyHistogram& h)
+{
+    auto ms = [](qint64 ns) { return ns < 0 ? QJsonValue() : QJsonValue(ns / 1e6); };
+    return QJsonObject{{"count", double(h.count())},
+                       {"sumMs", h.sumNs() / 1e6},
+                       {"p50Ms", ms(h.quantileNs(0.5))},
+                       {"p90Ms", ms(h.quantileNs(0.9))},
+                       {"p99Ms", ms(h.quantileNs(0.99))}};
+}
+}
+
+const std::array<qint64, LatencyHistogram::kBounds>& LatencyHistogram::boundsNs()
+{
+    static const std::array<qint64, kBounds> bounds {
+        10000, 25000, 50000, 100000, 250000, 500000,
+        1000000, 2500000, 5000000, 10000000, 25000000, 50000000, 100000000};
+    return bounds;
+}
+
+void LatencyHistogram::record(qint64 ns)
+{
+    const auto& bounds = boundsNs();
+    int i = 0;
+    while (i < kBounds && ns > bounds[size_t(i)]) ++i;
+    m_buckets[size_t(i)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sumNs.fetch_add(quint64(qMax<qint64>(0, ns)), std::memory_order_relaxed);
+}
+
+qint64 LatencyHistogram::quantileNs(double q) const
+{
+    const quint64 total = count();
+    if (total == 0) return -1;
+    const quint64 rank = quint64(q * double(total - 1)) + 1;
+    quint64 seen = 0;
+    for (int i = 0; i < kBounds; ++i) {
+        seen += bucket(i);
+        if (seen >= rank) return boundsNs()[size_t(i)];
+    }
+    return -1;
+}
+
+Metrics::Metrics()
+{
+    addMethod(QStringLiteral("unknown"));
+    addMethod(QStringLiteral("event"));
+}
+
+int Metrics::addMethod(const QString& name)
+{
+    const auto it = m_slotByName.constFind(name);
+    if (it != m_slotByName.cend()) return it.value();
+    auto stats = std::make_unique<MethodStats>();
+    stats->name = name;
+    m_methods.push_back(std::move(stats));
+    const int slot = int(m_methods.size()) - 1;
+    m_slotByName.insert(name, slot);
+    return slot;
+}
+
+int Metrics::slotFor(const QJsonValue& request) const
+{
+    if (request.isArray()) return slotFor(QStringLiteral("batch"));
+    return slotFor(request.toObject().value(QLatin1String("method")).toString());
+}
+
+void Metrics::recordFanout(int deliveries)
+{
+    if (!kEnabled || deliveries <= 0) return;
+    size_t bucket = 0;
+    while (bucket + 1 < m_fanout.size() && deliveries > (1 << bucket)) ++bucket;
+    m_fanout[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_events.fetch_add(quint64(deliveries), std::memory_order_relaxed);
+}
+
+qint64 Metrics::phaseTotalNs(Phase phase) const
+{
+    qint64 total = 0;
+    for (const auto& method : m_methods) total += method->phases[phase].sumNs();
+    return total;
+}
+
+QJsonObject Metrics::toJson() const
+{
+    if (!kEnabled) return QJsonObject{{"enabled", false}};
+    QJsonObject methods;
+    for (const auto& method : m_methods) {
+        QJsonObject entry;
+        for (int phase = 0; phase < PhaseCount; ++phase) {
+            if (method->phases[size_t(phase)].count() > 0)
+                entry.insert(kPhaseNames[phase], histogramJson(method->phases[size_t(phase)]));
+        }
+        if (entry.isEmpty()) continue;
+        entry.insert("errors", double(method->errors.load(std::memory_order_relaxed)));
+        methods.insert(method->name, entry);
+    }
+    QJsonArray fanout;
+    for (const auto& bucket : m_fanout) fanout.push_back(double(bucket.load(std::memory_order_relaxed)));
+    return QJsonObject{{"enabled", true},
+                       {"bytesIn", double(m_bytesIn.load(std::memory_order_relaxed))},
+                       {"bytesOut", double(m_bytesOut.load(std::memory_order_relaxed))},
+                       {"framesIn", double(m_framesIn.load(std::memory_order_relaxed))},
+                       {"framesOut", double(m_framesOut.load(std::memory_order_relaxed))},
+                       {"events", double(m_events.load(std::memory_order_relaxed))},
+                       {"fanout", fanout},
+                       {"methods", methods}};
+}
+
+QByteArray Metrics::toPrometheus(double guiThreadSeconds, const QList<QPair<QByteArray, double>>& gauges) const
+{
+    QByteArray out;
+    if (!kEnabled) return out;
+    out += "# TYPE qab_rpc_duration_seconds histogram\n";
+    const auto& bounds = LatencyHistogram::boundsNs();
+    for (const auto& method : m_methods) {
+        const QByteArray name = method->name.toUtf8();
+        for (int phase = 0; phase < PhaseCount; ++phase) {
+            const LatencyHistogram& h = method->phases[size_t(phase)];
+            if (h.count() == 0) continue;
+            const QByteArray labels = "method=\"" + name + "\",phase=\"" + kPhaseNames[phase] + '"';
+            quint64 cumulative = 0;
+            for (int i = 0; i < LatencyHistogram::kBounds; ++i) {
+                cumulative += h.bucket(i);
+                out += "qab_rpc_duration_seconds_bucket{" + labels + ",le=\"" + number(bounds[size_t(i)] / 1e9)
+                       + "\"} " + QByteArray::number(cumulative) + '\n';
+            }
+            out += "qab_rpc_duration_seconds_bucket{" + labels + ",le=\"+Inf\"} " + QByteArray::number(h.count()) + '\n';
+            out += "qab_rpc_duration_seconds_sum{" + labels + "} " + number(h.sumNs() / 1e9) + '\n';
+            out += "qab_rpc_duration_seconds_count{" + labels + "} " + QByteArray::number(h.count()) + '\n';
+        }
+    }
+    out += "# TYPE qab_rpc_errors_total counter\n";
+    for (const auto& method : m_methods) {
+        const quint64 errors = method->errors.load(std::memory_order_relaxed);
+        if (errors > 0)
+            out += "qab_rpc_errors_total{method=\"" + method->name.toUtf8() + "\"} " + QByteArray::number(errors) + '\n';
+    }
+    const QPair<const char*, const std::atomic<quint64>*> counters[] = {
+        {"qab_received_bytes_total", &m_bytesIn},
+        {"qab_sent_bytes_total", &m_bytesOut},
+        {"qab_received_frames_total", &m_framesIn},
+        {"qab_sent_frames_total", &m_framesOut},
+        {"qab_events_total", &m_events},
+    };
+    for (const auto& counter : counters) {
+        out += QByteArray("# TYPE ") + counter.first + " counter\n";
+        out += QByteArray(counter.first) + ' ' + QByteArray::number(counter.second->load(std::memory_order_relaxed)) + '\n';
+    }
+    out += "# TYPE qab_event_fanout histogram\n";
+    quint64 cumulative = 0;
+    for (size_t i = 0; i < m_fanout.size(); ++i) {
+        cumulative += m_fanout[i].load(std::memory_order_relaxed);
+        const QByteArray le = i + 1 < m_fanout.size() ? QByteArray::number(1 << i) : QByteArray("+Inf");
+        out += "qab_event_fanout_bucket{le=\"" + le + "\"} " + QByteArray::number(cumulative) + '\n';
+    }
+    out += "qab_event_fanout_sum " + QByteArray::number(m_events.load(std::memory_order_relaxed)) + '\n';
+    out += "qab_event_fanout_count " + QByteArray::number(cumulative) + '\n';
+    out += "# TYPE qab_gui_thread_seconds_total counter\n";
+    out += "qab_gui_thread_seconds_total " + number(guiThreadSeconds) + '\n';
+    for (const auto& gauge : gauges) {
+        out += "# TYPE " + gauge.first + " gauge\n";
+        out += gauge.first + ' ' + number(gauge.second) + '\n';
+    }
+    return out;
+}
@@ -0,0 +1,48 @@
+#include "MetricsEndpoint.hpp"
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <utility>
+
+namespace {
+constexpr int kMaxRequestBytes = 8192;
+}
+
+MetricsEndpoint::MetricsEndpoint(Render render, QObject* parent)
+    : QObject(parent), m_render(std::move(render))
+{
+    m_server = new QTcpServer(this);
+    connect(m_server, &QTcpServer::newConnection, this, [this] {
+        while (QTcpSocket* socket = m_server->nextPendingConnection()) {
+            connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            connect(socket, &QTcpSocket::readyRead, this, [this, socket] { respond(socket); });
+        }
+    });
+}
+
+bool MetricsEndpoint::listen(const QHostAddress& address, quint16 port)
+{
+    return m_server->listen(address, port);
+}
+
+quint16 MetricsEndpoint::serverPort() const
+{
+    return m_server->serverPort();
+}
+
+void MetricsEndpoint::respond(QTcpSocket* socket)
+{
+    // Wait for the whole header block; the request line is all we look at.
+    const QByteArray head = socket->peek(kMaxRequestBytes);
+    if (!head.contains("\r\n\r\n") && head.size() < kMaxRequestBytes) return;
+    disconnect(socket, &QTcpSocket::readyRead, this, nullptr);
+    const QList<QByteArray> requestLine = head.left(head.indexOf("\r\n")).split(' ');
+    const bool found = requestLine.size() >= 2 && requestLine.at(0) == "GET"
+                       && (requestLine.at(1) == "/metrics" || requestLine.at(1).startsWith("/metrics?"));
+    const QByteArray body = found ? m_render() : QByteArray("not found\n");
+    QByteArray response = found ? "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                                : "HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\n";
+    response += "Content-Length: " + QByteArray::number(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+    socket->write(response);
+    socket->disconnectFromHost();
+}
@@ -0,0 +1,71 @@
+#include "ModelExport.hpp"
+#include "VariantConverter.hpp"
+
+#include <QAbstractItemModel>
+#include <QHash>
+#include <QJsonArray>
+#include <QVariant>
+#include <algorithm>
+
+ModelExport::ModelExport(QAbstractItemModel* model, const QVector<ModelRole>& roles, int column,
+                         int start, int end, int chunkSize, const VariantConverter* convert)
+    : m_model(model), m_roles(roles), m_column(column), m_next(start), m_end(end),
+      m_chunkSize(qMax(1, chunkSize)), m_convert(convert)
+{
+    const auto invalidate = [this] { m_changed = true; };
+    m_connections = {
+        QObject::connect(model, &QAbstractItemModel::rowsInserted, invalidate),
+        QObject::connect(model, &QAbstractItemModel::rowsRemoved, invalidate),
+        QObject::connect(model, &QAbstractItemModel::rowsMoved, invalidate),
+        QObject::connect(model, &QAbstractItemModel::modelReset, invalidate),
+        QObject::connect(model, &QAbstractItemModel::layoutChanged, invalidate),
+    };
+}
+
+ModelExport::~ModelExport()
+{
+    for (const auto& c : m_connections) QObject::disconnect(c);
+}
+
+QVector<ModelRole> ModelExport::resolveRoles(const QAbstractItemModel* model, const QJsonValue& names)
+{
+    const QHash<int, QByteArray> roleNames = model->roleNames();
+    QVector<ModelRole> roles;
+    if (!names.isArray()) {
+        for (auto it = roleNames.begin(); it != roleNames.end(); ++it)
+            roles.push_back({it.key(), QString::fromUtf8(it.value())});
+        std::sort(roles.begin(), roles.end(), [](const ModelRole& a, const ModelRole& b) { return a.id < b.id; });
+        return roles;
+    }
+    QHash<QByteArray, int> byName;
+    byName.reserve(roleNames.size());
+    for (auto it = roleNames.begin(); it != roleNames.end(); ++it) byName.insert(it.value(), it.key());
+    for (const QJsonValue& v : names.toArray()) {
+        if (!v.isString()) continue;
+        const auto it = byName.constFind(v.toString().toUtf8());
+        if (it != byName.cend()) roles.push_back({it.value(), v.toString()});
+    }
+    return roles;
+}
+
+QJsonObject ModelExport::nextChunk()
+{
+    const int from = m_next;
+    const int to = qMin(m_end, from + m_chunkSize);
+    QJsonArray values;
+    for (const ModelRole& role : m_roles) {
+        QJsonArray column;
+        for (int row = from; row < to; ++row)
+            column.push_back(m_convert->toJson(m_model->data(m_model->index(row, m_column), role.id)));
+        values.push_back(column);
+    }
+    m_next = to;
+    return QJsonObject{{"start", from}, {"count", to - from}, {"values", values}};
+}
+
+QString ModelExport::abortReason() const
+{
+    if (!m_model) return QStringLiteral("model_destroyed");
+    if (m_changed) return QStringLiteral("model_changed");
+    return {};
+}
@@ -0,0 +1,207 @@
+#include "ModelWatcher.hpp"
+#include "VariantConverter.hpp"
+
+#include <QAbstractItemModel>
+#include <QJsonObject>
+#include <QVariant>
+#include <algorithm>
+#include <utility>
+
+namespace {
+// Past this many unmergeable changes in one turn, a reset is cheaper to replay.
+constexpr int kMaxPendingChanges = 1000;
+}
+
+ModelWatcher::ModelWatcher(QAbstractItemModel* model, const QVector<ModelRole>& roles, bool includeValues,
+                           int column, const VariantConverter* convert, std::function<void()> onPending)
+    : m_model(model), m_roles(roles), m_includeValues(includeValues), m_column(column),
+      m_convert(convert), m_onPending(std::move(onPending))
+{
+    m_connections = {
+        // Values of pending changes at or below a shift are read while their rows are still in place.
+        QObject::connect(model, &QAbstractItemModel::rowsAboutToBeInserted, [this](const QModelIndex& parent, int first, int) {
+            if (!parent.isValid()) readPending(first);
+        }),
+        QObject::connect(model, &QAbstractItemModel::rowsAboutToBeRemoved, [this](const QModelIndex& parent, int first, int) {
+            if (!parent.isValid()) readPending(first);
+        }),
+        QObject::connect(model, &QAbstractItemModel::rowsAboutToBeMoved,
+                         [this](const QModelIndex& parent, int start, int, const QModelIndex& destination, int row) {
+            if (!parent.isValid() && !destination.isValid()) readPending(qMin(start, row));
+            else if (!parent.isValid()) readPending(start);
+            else if (!destination.isValid()) readPending(row);
+        }),
+        QObject::connect(model, &QAbstractItemModel::rowsInserted, [this](const QModelIndex& parent, int first, int last) {
+            if (!parent.isValid()) push({Insert, first, last});
+        }),
+        QObject::connect(model, &QAbstractItemModel::rowsRemoved, [this](const QModelIndex& parent, int first, int last) {
+            if (!parent.isValid()) push({Remove, first, last});
+        }),
+        QObject::connect(model, &QAbstractItemModel::rowsMoved,
+                         [this](const QModelIndex& parent, int start, int end, const QModelIndex& destination, int row) {
+            if (!parent.isValid() && !destination.isValid()) push({Move, start, end, row});
+            else if (!parent.isValid()) push({Remove, start, end});
+            else if (!destination.isValid()) push({Insert, row, row + end - start});
+        }),
+        QObject::connect(model, &QAbstractItemModel::dataChanged,
+                         [this](const QModelIndex& topLeft, const QModelIndex& bottomRight, const QVector<int>& roles) {
+            if (topLeft.parent().isValid() || m_column < topLeft.column() || m_column > bottomRight.column()) return;
+            Change change{Data, topLeft.row(), bottomRight.row()};
+            if (!roles.isEmpty()) {
+                for (const ModelRole& r : m_roles) {
+                    if (roles.contains(r.id)) change.roles.push_back(r.id);
+                }
+                if (change.roles.isEmpty()) return; // none of the subscribed roles
+                if (change.roles.size() == m_roles.size()) change.roles.clear();
+            }
+            push(change);
+        }),
+        QObject::connect(model, &QAbstractItemModel::modelReset, [this] { push({Reset}); }),
+        QObject::connect(model, &QAbstractItemModel::layoutChanged, [this] { push({Layout}); }),
+        QObject::connect(model, &QObject::destroyed, [this] {
+            const bool wasIdle = !hasPending();
+            m_destroyed = true;
+            m_pending.clear();
+            if (wasIdle && m_onPending) m_onPending();
+        }),
+    };
+}
+
+ModelWatcher::~ModelWatcher()
+{
+    for (const auto& c : m_connections) QObject::disconnect(c);
+}
+
+int ModelWatcher::rowCount() const
+{
+    return m_model ? m_model->rowCount() : 0;
+}
+
+void ModelWatcher::push(const Change& change)
+{
+    const bool wasIdle = !hasPending();
+    if (m_destroyed) return;
+    // After a pending reset or layout change the client re-fetches anyway.
+    if (!m_pending.isEmpty() && (m_pending.last().op == Reset || m_pending.last().op == Layout)) return;
+
+    bool merged = false;
+    switch (change.op) {
+    case Reset:
+    case Layout:
+        m_pending.clear();
+        break;
+    case Data:
+        // Look back over the data changes since the last structural change.
+        for (int i = m_pending.size() - 1; i >= 0 && !merged; --i) {
+            Change& p = m_pending[i];
+            if (p.op == Insert && !p.read && change.start >= p.start && change.end <= p.end) {
+                merged = true; // the insert's values are read later anyway
+            } else if (p.op != Data) {
+                break;
+            } else if (!p.read && change.start <= p.end + 1 && change.end >= p.start - 1) {
+                p.start = qMin(p.start, change.start);
+                p.end = qMax(p.end, change.end);
+                if (p.roles.isEmpty() || change.roles.isEmpty()) {
+                    p.roles.clear();
+                } else {
+                    for (int role : change.roles) {
+                        if (!p.roles.contains(role)) p.roles.push_back(role);
+                    }
+                }
+                merged = true;
+            }
+        }
+        break;
+    case Insert:
+    case Remove:
+    case Move:
+        if (!m_pending.isEmpty()) {
+            Change& last = m_pending.last();
+            const int count = change.end - change.start + 1;
+            if (last.op == Insert && change.op == Insert && !last.read && change.start >= last.start
+                && change.start <= last.end + 1) {
+                last.end += count;
+                merged = true;
+            } else if (last.op == Remove && change.op == Remove && change.start == last.start) {
+                last.end += count;
+                merged = true;
+            } else if (last.op == Remove && change.op == Remove && change.end + 1 == last.start) {
+                last.start = change.start;
+                last.end += count;
+                merged = true;
+            }
+        }
+        break;
+    }
+
+    if (!merged) {
+        if (m_pending.size() >= kMaxPendingChanges) {
+            m_pending.clear();
+            m_pending.push_back({Reset});
+        } else {
+            m_pending.push_back(change);
+        }
+    }
+    if (wasIdle && m_onPending) m_onPending();
+}
+
+void ModelWatcher::readPending(int fromRow)
+{
+    if (!m_includeValues) return;
+    for (Change& c : m_pending) {
+        if (!c.read && (c.op == Insert || c.op == Data) && c.end >= fromRow) readValues(c);
+    }
+}
+
+void ModelWatcher::readValues(Change& change) const
+{
+    change.read = true;
+    change.values = QJsonArray();
+    if (!m_model) return;
+    const auto readRole = [&](int role) {
+        QJsonArray column;
+        for (int row = change.start; row <= change.end; ++row)
+            column.push_back(m_convert->toJson(m_model->data(m_model->index(row, m_column), role)));
+        change.values.push_back(column);
+    };
+    if (change.roles.isEmpty()) {
+        for (const ModelRole& r : m_roles) readRole(r.id);
+    } else {
+        for (int role : change.roles) readRole(role);
+    }
+}
+
+QJsonObject ModelWatcher::toJson(Change& change) const
+{
+    static const char* const names[] = {"insert", "remove", "move", "data", "reset", "layout"};
+    QJsonObject out{{"op", QLatin1String(names[change.op])}};
+    if (change.op == Reset || change.op == Layout) return out;
+    out.insert("start", change.start);
+    out.insert("end", change.end);
+    if (change.op == Move) out.insert("destination", change.destination);
+    if (change.op == Data && !change.roles.isEmpty()) {
+        QJsonArray roles;
+        for (int role : change.roles) {
+            const auto it = std::find_if(m_roles.cbegin(), m_roles.cend(), [role](const ModelRole& r) { return r.id == role; });
+            roles.push_back(it->name);
+        }
+        out.insert("roles", roles);
+    }
+    if (m_includeValues && (change.op == Insert || change.op == Data)) {
+        if (!change.read) readValues(change);
+        out.insert("values", change.values);
+    }
+    return out;
+}
+
+QJsonArray ModelWatcher::takeChanges()
+{
+    QJsonArray out;
+    if (m_destroyed) {
+        out.push_back(QJsonObject{{"op", "destroyed"}});
+    } else {
+        for (Change& c : m_pending) out.push_back(toJson(c));
+    }
+    m_pending.clear();
+    return out;
+}
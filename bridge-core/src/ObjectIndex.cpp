@@ -0,0 +1,207 @@
+#include "ObjectIndex.hpp"
+
+#include <QEvent>
+#include <QMetaObject>
+#include <QVector>
+#include <utility>
+
+ObjectIndex::ObjectIndex(QObject* parent)
+    : QObject(parent)
+{
+    m_childrenChangedSlot = metaObject()->indexOfSlot("onChildrenChanged()");
+}
+
+QList<QObject*> ObjectIndex::findByName(const QList<QObject*>& roots, const QString& name)
+{
+    return lookup(m_byName, name, roots);
+}
+
+QList<QObject*> ObjectIndex::findByType(const QList<QObject*>& roots, const QString& className)
+{
+    return lookup(m_byType, className, roots);
+}
+
+QList<QObject*> ObjectIndex::lookup(const QMultiHash<QString, QObject*>& table, const QString& key,
+                                    const QList<QObject*>& roots)
+{
+    sync(roots);
+    ++m_stats.lookups;
+    QList<QObject*> found;
+    for (auto it = table.constFind(key); it != table.cend() && it.key() == key; ++it) {
+        // Only descendants, and only while they still are: an object moved
+        // without any notification is not reported from its old place.
+        QObject* obj = it.value();
+        QObject* up = obj->parent();
+        while (up && !roots.contains(up)) up = up->parent();
+        if (up) found.push_back(obj);
+    }
+    if (found.isEmpty()) ++m_stats.misses;
+    else ++m_stats.hits;
+    return found;
+}
+
+void ObjectIndex::sync(const QList<QObject*>& roots)
+{
+    if (!m_built) {
+        m_built = true;
+        ++m_stats.builds;
+    }
+    for (QObject* root : QObjectList(m_roots)) {
+        if (roots.contains(root)) continue;
+        untrackSubtree(root);
+        m_roots.removeOne(root);
+    }
+    for (QObject* root : roots) {
+        if (m_roots.contains(root)) continue;
+        m_roots.push_back(root);
+        if (!m_tracked.contains(root)) trackSubtree(root, nullptr);
+    }
+    if (!m_dirtyParents.isEmpty()) resync(std::exchange(m_dirtyParents, {}));
+}
+
+void ObjectIndex::resync(const QSet<QObject*>& dirty)
+{
+    // New child lists of the dirty parents, and who arrived in them.
+    QVector<QPair<QObject*, QObjectList>> lists;
+    QHash<QObject*, QObject*> arrivals; // child -> new parent
+    for (QObject* parent : dirty) {
+        if (!m_tracked.contains(parent)) continue;
+        ++m_stats.resyncs;
+        const QObjectList now = parent->children();
+        for (QObject* child : now) {
+            const auto c = m_tracked.constFind(child);
+            if (c == m_tracked.cend() || c->parent != parent) arrivals.insert(child, parent);
+        }
+        lists.push_back({parent, now});
+    }
+
+    // Departures: a child that arrived elsewhere was reparented, the rest left the trees.
+    for (const auto& list : qAsConst(lists)) {
+        const QObjectList before = m_tracked.value(list.first).children;
+        for (QObject* child : before) {
+            const auto c = m_tracked.find(child);
+            if (c == m_tracked.end() || c->parent != list.first || list.second.contains(child)) continue;
+            if (QObject* to = arrivals.take(child)) c->parent = to;
+            else untrackSubtree(child);
+        }
+    }
+
+    // Arrivals: moved in from a parent that sent no notification, or new.
+    for (auto it = arrivals.cbegin(); it != arrivals.cend(); ++it) {
+        QObject* child = it.key();
+        if (!m_tracked.contains(it.value())) continue; // left the trees in this pass
+        const auto c = m_tracked.find(child);
+        if (c == m_tracked.end()) {
+            trackSubtree(child, it.value());
+            continue;
+        }
+        if (c->parent == it.value()) continue; // tracked with a subtree added earlier in this pass
+        const auto from = m_tracked.find(c->parent);
+        if (from != m_tracked.end()) from->children.removeOne(child);
+        c->parent = it.value();
+    }
+
+    for (const auto& list : qAsConst(lists)) {
+        const auto p = m_tracked.find(list.first);
+        if (p != m_tracked.end()) p->children = list.second;
+    }
+}
+
+void ObjectIndex::markDirty(QObject* obj)
+{
+    if (m_built) m_dirtyParents.insert(obj);
+}
+
+void ObjectIndex::trackSubtree(QObject* obj, QObject* parent)
+{
+    track(obj, parent);
+    for (QObject* child : obj->children()) {
+        if (!m_tracked.contains(child)) trackSubtree(child, obj);
+    }
+}
+
+void ObjectIndex::track(QObject* obj, QObject* parent)
+{
+    Tracked t{obj->objectName(), QString::fromLatin1(obj->metaObject()->className()), parent, obj->children()};
+    if (!t.name.isEmpty()) m_byName.insert(t.name, obj);
+    m_byType.insert(t.type, obj);
+    m_tracked.insert(obj, t);
+
+    obj->installEventFilter(this);
+    connect(obj, &QObject::objectNameChanged, this, &ObjectIndex::onObjectNameChanged);
+    connect(obj, &QObject::destroyed, this, &ObjectIndex::onDestroyed);
+    // Qt Quick items announce visual reparenting, which is how Loader and
+    // friends attach objects created without ChildAdded.
+    const int childrenChanged = obj->metaObject()->indexOfSignal("childrenChanged()");
+    if (childrenChanged >= 0) QMetaObject::connect(obj, childrenChanged, this, m_childrenChangedSlot);
+}
+
+void ObjectIndex::untrackSubtree(QObject* obj)
+{
+    const auto it = m_tracked.constFind(obj);
+    if (it == m_tracked.cend()) return;
+    const QObjectList children = it->children;
+    untrack(obj);
+    for (QObject* child : children) {
+        const auto c = m_tracked.constFind(child);
+        if (c != m_tracked.cend() && c->parent == obj) untrackSubtree(child);
+    }
+}
+
+void ObjectIndex::untrack(QObject* obj)
+{
+    const auto it = m_tracked.find(obj);
+    if (it == m_tracked.end()) return;
+    if (!it->name.isEmpty()) m_byName.remove(it->name, obj);
+    m_byType.remove(it->type, obj);
+    m_tracked.erase(it);
+    m_dirtyParents.remove(obj);
+    obj->removeEventFilter(this);
+    QObject::disconnect(obj, nullptr, this, nullptr);
+}
+
+void ObjectIndex::clear()
+{
+    const auto tracked = m_tracked.keys();
+    for (QObject* obj : tracked) untrack(obj);
+    m_roots.clear();
+    m_dirtyParents.clear();
+    m_built = false;
+}
+
+bool ObjectIndex::eventFilter(QObject* watched, QEvent* event)
+{
+    // ChildAdded usually comes from the child's QObject constructor, before
+    // its class is known; the diff on the next lookup sees the finished object.
+    const QEvent::Type type = event->type();
+    if (type == QEvent::ChildAdded || type == QEvent::ChildRemoved) markDirty(watched);
+    return QObject::eventFilter(watched, event);
+}
+
+void ObjectIndex::onObjectNameChanged(const QString& name)
+{
+    QObject* obj = sender();
+    const auto it = m_tracked.find(obj);
+    if (it == m_tracked.end()) return;
+    if (!it->name.isEmpty()) m_byName.remove(it->name, obj);
+    it->name = name;
+    if (!name.isEmpty()) m_byName.insert(name, obj);
+}
+
+void ObjectIndex::onDestroyed(QObject* obj)
+{
+    // Called from ~QObject: only the bookkeeping is touched, never obj itself.
+    const auto it = m_tracked.find(obj);
+    if (it == m_tracked.end()) return;
+    if (!it->name.isEmpty()) m_byName.remove(it->name, obj);
+    m_byType.remove(it->type, obj);
+    m_tracked.erase(it);
+    m_dirtyParents.remove(obj);
+}
+
+void ObjectIndex::onChildrenChanged()
+{
+    QObject* item = sender();
+    markDirty(item);
+    if (m_tracked.contains(item->parent())) markDirty(item->parent());
+}
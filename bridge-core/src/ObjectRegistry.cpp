@@ -0,0 +1,53 @@
+#include "ObjectRegistry.hpp"
+
+#include <QMetaObject>
+
+ObjectRegistry::ObjectRegistry(QObject* parent)
+    : QObject(parent)
+{
+}
+
+const ObjectRegistry::Entry& ObjectRegistry::ensure(QObject* obj)
+{
+    const auto known = m_byObject.constFind(obj);
+    if (known != m_byObject.cend()) return *m_byHandle.constFind(known.value());
+
+    Entry e;
+    e.handle = m_nextHandle++;
+    e.object = obj;
+    e.metaObject = obj->metaObject();
+    e.id = QStringLiteral("qobj:%1").arg(e.handle);
+    e.className = QString::fromLatin1(e.metaObject->className());
+    m_byObject.insert(obj, e.handle);
+    connect(obj, &QObject::destroyed, this, &ObjectRegistry::onDestroyed);
+    return *m_byHandle.insert(e.handle, e);
+}
+
+quint64 ObjectRegistry::parseHandle(const QString& id)
+{
+    if (!id.startsWith(QLatin1String("qobj:"))) return 0;
+    bool ok = false;
+    const quint64 handle = QStringView(id).mid(5).toULongLong(&ok, 10);
+    return ok ? handle : 0;
+}
+
+const ObjectRegistry::Entry* ObjectRegistry::find(const QString& id) const
+{
+    const auto it = m_byHandle.constFind(parseHandle(id));
+    return it != m_byHandle.cend() ? &it.value() : nullptr;
+}
+
+QObject* ObjectRegistry::resolve(const QString& id) const
+{
+    const Entry* e = find(id);
+    return e ? e->object : nullptr;
+}
+
+void ObjectRegistry::onDestroyed(QObject* obj)
+{
+    const auto it = m_byObject.find(obj);
+    if (it == m_byObject.end()) return;
+    m_byHandle.remove(it.value());
+    m_byObject.erase(it);
+    emit objectReleased(obj);
+}
@@ -0,0 +1,61 @@
+#include "SchemaCache.hpp"
+
+#include <QMetaMethod>
+#include <QMetaObject>
+#include <QMetaProperty>
+
+namespace {
+
+bool describes(const ClassSchema& schema, const QMetaObject* mo)
+{
+    // QML type metaobjects are owned by the engine; guard against a freed one
+    // whose address was reused by a different class.
+    return schema.className == QLatin1String(mo->className())
+           && schema.propertyIndices.size() == mo->propertyCount() - mo->propertyOffset()
+           && schema.methods.size() == mo->methodCount() - mo->methodOffset();
+}
+
+} // namespace
+
+const ClassSchema& SchemaCache::forMetaObject(const QMetaObject* mo)
+{
+    const auto cached = m_byMeta.constFind(mo);
+    if (cached != m_byMeta.cend() && describes(**cached, mo)) return **cached;
+
+    auto schema = QSharedPointer<ClassSchema>::create();
+    schema->schemaId = QStringLiteral("schema:%1").arg(m_byId.size() + 1);
+    schema->className = QString::fromLatin1(mo->className());
+
+    QJsonArray props;
+    for (int i = mo->propertyOffset(); i < mo->propertyCount(); ++i) {
+        const QMetaProperty p = mo->property(i);
+        schema->propertyIndices.push_back(i);
+        schema->propertyNames.push_back(QString::fromLatin1(p.name()));
+        props.push_back(QJsonObject{{"name", schema->propertyNames.constLast()},
+                                    {"type", QString::fromLatin1(p.typeName())}});
+    }
+    for (int i = mo->methodOffset(); i < mo->methodCount(); ++i) {
+        const QMetaMethod m = mo->method(i);
+        const QString sig = QString::fromLatin1(m.methodSignature());
+        schema->methods.push_back(sig);
+        if (m.methodType() == QMetaMethod::Signal) schema->signalList.push_back(sig);
+    }
+    schema->json = QJsonObject{{"schemaId", schema->schemaId},
+                               {"type", schema->className},
+                               {"properties", props},
+                               {"methods", schema->methods},
+                               {"signals", schema->signalList}};
+
+    m_byMeta.insert(mo, schema);
+    m_byId.push_back(schema);
+    return *schema;
+}
+
+const ClassSchema* SchemaCache::find(const QString& schemaId) const
+{
+    if (!schemaId.startsWith(QLatin1String("schema:"))) return nullptr;
+    bool ok = false;
+    const int n = QStringView(schemaId).mid(7).toInt(&ok);
+    if (!ok || n < 1 || n > m_byId.size()) return nullptr;
+    return m_byId.at(n - 1).data();
+}
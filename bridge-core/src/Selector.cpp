@@ -0,0 +1,355 @@
+#include "Selector.hpp"
+
+#include <QMetaObject>
+#include <QObject>
+#include <QVariant>
+#include <QtAlgorithms>
+#include <algorithm>
+
+namespace {
+
+bool isIdentChar(QChar c)
+{
+    return c.isLetterOrNumber() || c == QLatin1Char('_');
+}
+
+bool isNameChar(QChar c)
+{
+    return isIdentChar(c) || c == QLatin1Char('-') || c == QLatin1Char('.');
+}
+
+// Exact class name, or a QML type name without its generated suffix
+// ("Button" for "Button_QMLTYPE_12"), anywhere up the superclass chain.
+bool classMatches(const QMetaObject* mo, const QByteArray& type)
+{
+    for (; mo; mo = mo->superClass()) {
+        const char* name = mo->className();
+        if (type == name) return true;
+        if (qstrncmp(name, type.constData(), type.size()) == 0) {
+            const char* rest = name + type.size();
+            if (qstrncmp(rest, "_QMLTYPE_", 9) == 0 || qstrncmp(rest, "_QML_", 5) == 0) return true;
+        }
+    }
+    return false;
+}
+
+class Parser {
+public:
+    explicit Parser(const QString& text) : m_s(text) {}
+
+    bool parse(QVector<Selector::Compound>* out)
+    {
+        skipSpace();
+        if (atEnd()) return fail(QStringLiteral("empty selector"));
+        bool child = false;
+        if (peek() == QLatin1Char('>')) {
+            child = true;
+            ++m_pos;
+            skipSpace();
+        }
+        for (;;) {
+            Selector::Compound c;
+            c.child = child;
+            if (!compound(&c)) return false;
+            out->push_back(c);
+            if (out->size() > Selector::kMaxCompounds) return fail(QStringLiteral("too many compounds"));
+
+            const int before = m_pos;
+            skipSpace();
+            if (atEnd()) return true;
+            if (peek() == QLatin1Char('>')) {
+                child = true;
+                ++m_pos;
+                skipSpace();
+            } else if (m_pos > before) {
+                child = false;
+            } else {
+                return fail(QStringLiteral("unexpected '%1'").arg(peek()));
+            }
+            if (atEnd()) return fail(QStringLiteral("selector ends with a combinator"));
+        }
+    }
+
+    QString error() const { return m_error; }
+
+private:
+    bool atEnd() const { return m_pos >= m_s.size(); }
+    QChar peek() const { return atEnd() ? QChar() : m_s.at(m_pos); }
+    void skipSpace()
+    {
+        while (!atEnd() && m_s.at(m_pos).isSpace()) ++m_pos;
+    }
+    bool fail(const QString& message)
+    {
+        if (m_error.isEmpty()) m_error = QStringLiteral("%1 at %2").arg(message).arg(m_pos);
+        return false;
+    }
+
+    QString take(bool (*accept)(QChar))
+    {
+        const int start = m_pos;
+        while (!atEnd() && accept(m_s.at(m_pos))) ++m_pos;
+        return m_s.mid(start, m_pos - start);
+    }
+
+    bool quoted(QString* out)
+    {
+        const QChar quote = m_s.at(m_pos++);
+        QString value;
+        while (!atEnd() && m_s.at(m_pos) != quote) {
+            if (m_s.at(m_pos) == QLatin1Char('\\') && m_pos + 1 < m_s.size()) ++m_pos;
+            value += m_s.at(m_pos++);
+        }
+        if (atEnd()) return fail(QStringLiteral("unterminated string"));
+        ++m_pos;
+        *out = value;
+        return true;
+    }
+
+    static bool isQuote(QChar c) { return c == QLatin1Char('"') || c == QLatin1Char('\''); }
+
+    bool compound(Selector::Compound* c)
+    {
+        const int start = m_pos;
+        if (peek() == QLatin1Char('*')) ++m_pos;
+        else c->type = take(isIdentChar).toLatin1();
+        for (;;) {
+            const QChar ch = peek();
+            if (ch == QLatin1Char('#')) {
+                ++m_pos;
+                if (c->hasName) return fail(QStringLiteral("duplicate #name"));
+                if (isQuote(peek())) {
+                    if (!quoted(&c->name)) return false;
+                } else {
+                    c->name = take(isNameChar);
+                    if (c->name.isEmpty()) return fail(QStringLiteral("expected objectName after '#'"));
+                }
+                c->hasName = true;
+            } else if (ch == QLatin1Char('[')) {
+                ++m_pos;
+                if (!predicate(c)) return false;
+            } else if (ch == QLatin1Char(':')) {
+                if (!nth(c)) return false;
+            } else {
+                break;
+            }
+        }
+        if (m_pos == start) return fail(QStringLiteral("expected type, *, #name, [predicate] or :nth()"));
+        return true;
+    }
+
+    bool predicate(Selector::Compound* c)
+    {
+        Selector::Predicate p;
+        skipSpace();
+        p.property = take(isIdentChar).toLatin1();
+        if (p.property.isEmpty()) return fail(QStringLiteral("expected property name"));
+        skipSpace();
+        if (peek() != QLatin1Char(']')) {
+            static const struct { const char* text; Selector::Predicate::Op op; } ops[] = {
+                {"!=", Selector::Predicate::NotEquals}, {"^=", Selector::Predicate::Prefix},
+                {"$=", Selector::Predicate::Suffix},    {"*=", Selector::Predicate::Contains},
+                {"<=", Selector::Predicate::LessEqual}, {">=", Selector::Predicate::GreaterEqual},
+                {"=", Selector::Predicate::Equals},     {"<", Selector::Predicate::Less},
+                {">", Selector::Predicate::Greater},
+            };
+            bool found = false;
+            for (const auto& op : ops) {
+                const QLatin1String text(op.text);
+                if (QStringView(m_s).mid(m_pos).startsWith(text)) {
+                    p.op = op.op;
+                    m_pos += text.size();
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) return fail(QStringLiteral("expected operator or ']'"));
+            skipSpace();
+            if (isQuote(peek())) {
+                if (!quoted(&p.value)) return false;
+            } else {
+                const int start = m_pos;
+                while (!atEnd() && m_s.at(m_pos) != QLatin1Char(']')) ++m_pos;
+                p.value = m_s.mid(start, m_pos - start).trimmed();
+                p.number = p.value.toDouble(&p.numeric);
+            }
+            skipSpace();
+        }
+        if (peek() != QLatin1Char(']')) return fail(QStringLiteral("expected ']'"));
+        ++m_pos;
+        c->predicates.push_back(p);
+        return true;
+    }
+
+    bool nth(Selector::Compound* c)
+    {
+        if (!QStringView(m_s).mid(m_pos).startsWith(QLatin1String(":nth("))) return fail(QStringLiteral("unknown pseudo-class"));
+        if (c->nth >= 0) return fail(QStringLiteral("duplicate :nth()"));
+        m_pos += 5;
+        bool ok = false;
+        c->nth = take([](QChar ch) { return ch.isDigit(); }).toInt(&ok);
+        if (!ok) return fail(QStringLiteral("expected index in :nth()"));
+        if (peek() != QLatin1Char(')')) return fail(QStringLiteral("expected ')'"));
+        ++m_pos;
+        return true;
+    }
+
+    QString m_s;
+    int m_pos { 0 };
+    QString m_error;
+};
+
+bool compareNumbers(Selector::Predicate::Op op, double lhs, double rhs)
+{
+    switch (op) {
+    case Selector::Predicate::Equals: return lhs == rhs;
+    case Selector::Predicate::NotEquals: return lhs != rhs;
+    case Selector::Predicate::Less: return lhs < rhs;
+    case Selector::Predicate::LessEqual: return lhs <= rhs;
+    case Selector::Predicate::Greater: return lhs > rhs;
+    case Selector::Predicate::GreaterEqual: return lhs >= rhs;
+    default: return false;
+    }
+}
+
+bool compareStrings(Selector::Predicate::Op op, const QString& lhs, const QString& rhs)
+{
+    switch (op) {
+    case Selector::Predicate::Equals: return lhs == rhs;
+    case Selector::Predicate::NotEquals: return lhs != rhs;
+    case Selector::Predicate::Prefix: return lhs.startsWith(rhs);
+    case Selector::Predicate::Suffix: return lhs.endsWith(rhs);
+    case Selector::Predicate::Contains: return lhs.contains(rhs);
+    case Selector::Predicate::Less: return lhs < rhs;
+    case Selector::Predicate::LessEqual: return lhs <= rhs;
+    case Selector::Predicate::Greater: return lhs > rhs;
+    case Selector::Predicate::GreaterEqual: return lhs >= rhs;
+    default: return false;
+    }
+}
+
+} // namespace
+
+QSharedPointer<const Selector> Selector::compile(const QString& text, QString* error)
+{
+    auto selector = QSharedPointer<Selector>::create();
+    Parser parser(text);
+    if (!parser.parse(&selector->m_compounds)) {
+        if (error) *error = parser.error();
+        return {};
+    }
+    selector->m_text = text;
+    for (const Compound& c : selector->m_compounds) {
+        if (c.nth >= 0) selector->m_usesNth = true;
+    }
+    return selector;
+}
+
+SelectorWalk::SelectorWalk(QSharedPointer<const Selector> selector, const QList<QObject*>& scope)
+    : m_selector(std::move(selector))
+{
+    for (QObject* obj : scope) m_scope.push_back(obj);
+    Frame frame;
+    frame.scope = true;
+    if (m_selector->compounds().first().child) frame.child = 1;
+    else frame.descendant = 1;
+    if (m_selector->usesNth()) {
+        frame.nthSeen.resize(m_selector->compounds().size());
+        std::fill(frame.nthSeen.begin(), frame.nthSeen.end(), 0);
+    }
+    m_stack.push_back(frame);
+}
+
+bool SelectorWalk::next(int limit, int budget, QList<QObject*>* out)
+{
+    const QVector<Selector::Compound>& compounds = m_selector->compounds();
+    const int last = compounds.size() - 1;
+    int found = 0;
+    int visits = 0;
+    while (!m_stack.isEmpty()) {
+        if (found >= limit || visits >= budget) return false;
+        Frame& frame = m_stack.last();
+        if (!frame.scope && !frame.parent) { // destroyed since the last call
+            m_stack.removeLast();
+            continue;
+        }
+        const int count = frame.scope ? m_scope.size() : frame.parent->children().size();
+        if (frame.next >= count) {
+            m_stack.removeLast();
+            continue;
+        }
+        QObject* obj = frame.scope ? m_scope.at(frame.next).data() : frame.parent->children().at(frame.next);
+        ++frame.next;
+        if (!obj) continue;
+        ++visits;
+        ++m_visited;
+
+        // Compounds this object's descendants / children may still match.
+        quint64 descendant = frame.descendant;
+        quint64 child = 0;
+        bool matched = false;
+        for (quint64 bits = (frame.descendant | frame.child) & typeMask(obj->metaObject()); bits; bits &= bits - 1) {
+            const int i = qCountTrailingZeroBits(bits);
+            const Selector::Compound& c = compounds.at(i);
+            if (!matchesRest(c, obj)) continue;
+            if (c.nth >= 0 && frame.nthSeen[i]++ != c.nth) continue;
+            if (i == last) matched = true;
+            else if (compounds.at(i + 1).child) child |= quint64(1) << (i + 1);
+            else descendant |= quint64(1) << (i + 1);
+        }
+        if (matched) {
+            out->push_back(obj);
+            ++found;
+        }
+        // Nothing left to match below this object: prune the subtree.
+        if ((descendant | child) && !obj->children().isEmpty()) {
+            Frame sub;
+            sub.parent = obj;
+            sub.descendant = descendant;
+            sub.child = child;
+            if (m_selector->usesNth()) {
+                sub.nthSeen.resize(compounds.size());
+                std::fill(sub.nthSeen.begin(), sub.nthSeen.end(), 0);
+            }
+            m_stack.push_back(sub);
+        }
+    }
+    return true;
+}
+
+quint64 SelectorWalk::typeMask(const QMetaObject* mo)
+{
+    auto it = m_typeMasks.constFind(mo);
+    if (it != m_typeMasks.cend()) return it.value();
+    quint64 mask = 0;
+    const QVector<Selector::Compound>& compounds = m_selector->compounds();
+    for (int i = 0; i < compounds.size(); ++i) {
+        if (compounds.at(i).type.isEmpty() || classMatches(mo, compounds.at(i).type)) mask |= quint64(1) << i;
+    }
+    m_typeMasks.insert(mo, mask);
+    return mask;
+}
+
+bool SelectorWalk::matchesRest(const Selector::Compound& c, QObject* obj) const
+{
+    if (c.hasName && obj->objectName() != c.name) return false;
+    for (const Selector::Predicate& p : c.predicates) {
+        const QVariant v = obj->property(p.property.constData());
+        if (!v.isValid()) return false;
+        if (p.op == Selector::Predicate::Exists) {
+            if (v.isNull()) return false;
+            continue;
+        }
+        if (p.numeric) {
+            bool ok = false;
+            const double d = v.toDouble(&ok);
+            if (ok && p.op != Selector::Predicate::Prefix && p.op != Selector::Predicate::Suffix
+                && p.op != Selector::Predicate::Contains) {
+                if (!compareNumbers(p.op, d, p.number)) return false;
+                continue;
+            }
+        }
+        if (!compareStrings(p.op, v.toString(), p.value)) return false;
+    }
+    return true;
+}
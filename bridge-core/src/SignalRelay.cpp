@@ -0,0 +1,22 @@
+#include "SignalRelay.hpp"
+
+#include <utility>
+
+SignalRelay::SignalRelay(Handler handler, QObject* parent)
+    : QObject(parent), m_handler(std::move(handler))
+{
+}
+
+QMetaObject::Connection SignalRelay::connectTo(QObject* sender, int signalIndex)
+{
+    return QMetaObject::connect(sender, signalIndex, this, QObject::staticMetaObject.methodCount(),
+                                Qt::DirectConnection);
+}
+
+int SignalRelay::qt_metacall(QMetaObject::Call call, int id, void** args)
+{
+    id = QObject::qt_metacall(call, id, args);
+    if (id < 0 || call != QMetaObject::InvokeMetaMethod) return id;
+    if (id == 0 && m_handler) m_handler(sender(), senderSignalIndex(), args);
+    return id - 1;
+}
@@ -0,0 +1,345 @@
+#include "Transport.hpp"
+#include "WireCodec.hpp"
+
+#include <QJsonArray>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QMetaObject>
+#include <QVector>
+#include <QWebSocket>
+#include <QWebSocketServer>
+#include <QtEndian>
+#include <utility>
+
+const char* OutboundLimits::policyName(Policy policy)
+{
+    switch (policy) {
+    case DropOldest: return "drop_oldest";
+    case Coalesce: return "coalesce";
+    case Disconnect: return "disconnect";
+    }
+    return "drop_oldest";
+}
+
+bool OutboundLimits::policyFromName(const QString& name, Policy* policy)
+{
+    for (Policy p : {DropOldest, Coalesce, Disconnect}) {
+        if (name == QLatin1String(policyName(p))) {
+            *policy = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+WebSocketTransport::WebSocketTransport(QObject* parent)
+    : Transport(parent)
+{
+    m_server = new QWebSocketServer(QStringLiteral("QmlAgentBridge"),
+                                    QWebSocketServer::NonSecureMode, this);
+    connect(m_server, &QWebSocketServer::newConnection, this, [this]() {
+        while (QWebSocket* socket = m_server->nextPendingConnection()) {
+            const quint64 id = addPeer(socket, nullptr);
+            connect(socket, &QWebSocket::textMessageReceived, this, [this, id](const QString& msg) {
+                receive(id, msg.toUtf8(), WireCodec::json());
+            });
+            connect(socket, &QWebSocket::binaryMessageReceived, this, [this, id](const QByteArray& msg) {
+                receive(id, msg, WireCodec::cbor());
+            });
+            connect(socket, &QWebSocket::bytesWritten, this, [this, id] {
+                auto peer = m_peers.find(id);
+                if (peer != m_peers.end()) flush(*peer);
+            });
+            connect(socket, &QWebSocket::disconnected, this, [this, id] { removePeer(id); });
+            emit clientConnected(id);
+        }
+    });
+}
+
+quint64 WebSocketTransport::addPeer(QWebSocket* socket, QLocalSocket* local)
+{
+    const quint64 id = m_nextClientId++;
+    Peer& peer = m_peers[id];
+    peer.socket = socket;
+    peer.local = local;
+    peer.stats.clientId = id;
+    peer.device()->setParent(this);
+    return id;
+}
+
+void WebSocketTransport::removePeer(quint64 clientId)
+{
+    const auto it = m_peers.find(clientId);
+    if (it == m_peers.end()) return;
+    it->device()->deleteLater();
+    m_peers.erase(it);
+    emit clientDisconnected(clientId);
+}
+
+QObject* WebSocketTransport::Peer::device() const
+{
+    return socket ? static_cast<QObject*>(socket) : local;
+}
+
+qint64 WebSocketTransport::Peer::bytesToWrite() const
+{
+    return socket ? socket->bytesToWrite() : local->bytesToWrite();
+}
+
+WebSocketTransport::~WebSocketTransport()
+{
+    close();
+}
+
+bool WebSocketTransport::listen(const QHostAddress& address, quint16 port)
+{
+    return m_server->listen(address, port);
+}
+
+bool WebSocketTransport::listenLocal(const QString& name)
+{
+    if (!m_localServer) {
+        m_localServer = new QLocalServer(this);
+        // Only the user running the app may connect, like a loopback-only TCP port.
+        m_localServer->setSocketOptions(QLocalServer::UserAccessOption);
+        connect(m_localServer, &QLocalServer::newConnection, this, [this]() {
+            while (QLocalSocket* socket = m_localServer->nextPendingConnection()) {
+                const quint64 id = addPeer(nullptr, socket);
+                connect(socket, &QLocalSocket::readyRead, this, [this, id] { readLocal(id); });
+                connect(socket, &QLocalSocket::bytesWritten, this, [this, id] {
+                    auto peer = m_peers.find(id);
+                    if (peer != m_peers.end()) flush(*peer);
+                });
+                connect(socket, &QLocalSocket::disconnected, this, [this, id] { removePeer(id); });
+                emit clientConnected(id);
+            }
+        });
+    }
+    m_localServer->close();
+    // A socket file left behind by a crashed run would make listen() fail.
+    QLocalServer::removeServer(name);
+    return m_localServer->listen(name);
+}
+
+void WebSocketTransport::close()
+{
+    m_server->close();
+    if (m_localServer) m_localServer->close();
+    // Dropped without clientDisconnected: the owner resets its client state itself.
+    for (const Peer& peer : qAsConst(m_peers)) {
+        disconnect(peer.device(), nullptr, this, nullptr);
+        if (peer.socket) peer.socket->abort();
+        else peer.local->abort();
+        peer.device()->deleteLater();
+    }
+    m_peers.clear();
+}
+
+bool WebSocketTransport::isListening() const
+{
+    return m_server->isListening();
+}
+
+quint16 WebSocketTransport::serverPort() const
+{
+    return m_server->serverPort();
+}
+
+QString WebSocketTransport::localServerName() const
+{
+    return m_localServer && m_localServer->isListening() ? m_localServer->fullServerName() : QString();
+}
+
+void WebSocketTransport::readLocal(quint64 clientId)
+{
+    auto it = m_peers.find(clientId);
+    if (it == m_peers.end() || it->closing) return;
+    QByteArray& input = it->localInput;
+    input += it->local->readAll();
+
+    // Split off every complete frame before handling any: handling one can
+    // re-enter and drop this peer.
+    QVector<QPair<QByteArray, const WireCodec*>> frames;
+    qsizetype pos = 0;
+    while (input.size() - pos >= LocalFrame::kHeaderBytes) {
+        const quint32 size = qFromBigEndian<quint32>(input.constData() + pos);
+        const char kind = input.at(pos + 4);
+        if (size > LocalFrame::kMaxPayload || (kind != LocalFrame::kJson && kind != LocalFrame::kCbor)) {
+            // Out of sync or hostile; there is no way to find the next frame.
+            QMetaObject::invokeMethod(it->local, &QLocalSocket::abort, Qt::QueuedConnection);
+            it->closing = true;
+            return;
+        }
+        if (input.size() - pos - LocalFrame::kHeaderBytes < qsizetype(size)) break;
+        frames.push_back({input.mid(pos + LocalFrame::kHeaderBytes, size),
+                          kind == LocalFrame::kCbor ? WireCodec::cbor() : WireCodec::json()});
+        pos += LocalFrame::kHeaderBytes + size;
+    }
+    input.remove(0, pos);
+    for (const auto& frame : qAsConst(frames)) receive(clientId, frame.first, frame.second);
+}
+
+void WebSocketTransport::receive(quint64 clientId, const QByteArray& bytes, const WireCodec* codec)
+{
+    const qint64 start = Metrics::now();
+    const QJsonValue message = codec->decode(bytes);
+    if (m_metrics) {
+        m_metrics->recordPhase(m_metrics->slotFor(message), Metrics::Parse, Metrics::now() - start);
+        m_metrics->recordIn(bytes.size());
+    }
+    emit messageReceived(clientId, message);
+}
+
+void WebSocketTransport::send(quint64 clientId, const QJsonValue& message, const WireCodec* codec, int metricsSlot)
+{
+    const qint64 start = Metrics::now();
+    QByteArray bytes = codec->encode(message);
+    if (m_metrics) m_metrics->recordPhase(metricsSlot, Metrics::Encode, Metrics::now() - start);
+    sendFrame(clientId, Frame{std::move(bytes), codec->isBinary(), {}, metricsSlot}, codec);
+}
+
+void WebSocketTransport::sendEvent(quint64 clientId, const QString& subscriptionId, const QJsonObject& body,
+                                   const WireCodec* codec, QByteArray* encodedBody, bool coalescable)
+{
+    const qint64 start = Metrics::now();
+    QByteArray local;
+    QByteArray& encoded = encodedBody ? *encodedBody : local;
+    if (encoded.isEmpty()) encoded = codec->encodeEventBody(body);
+    QByteArray bytes = codec->frameEvent(subscriptionId, encoded);
+    if (m_metrics) m_metrics->recordPhase(Metrics::kEventSlot, Metrics::Encode, Metrics::now() - start);
+    sendFrame(clientId, Frame{std::move(bytes), codec->isBinary(), subscriptionId, Metrics::kEventSlot, coalescable},
+              codec);
+}
+
+OutboundReport WebSocketTransport::outboundReport() const
+{
+    OutboundReport report;
+    report.disconnects = m_disconnects;
+    for (const Peer& peer : m_peers) {
+        OutboundClientStats stats = peer.stats;
+        stats.socketBytes = peer.bytesToWrite();
+        stats.queuedReplies = int(peer.replies.size());
+        stats.queuedEvents = int(peer.events.size());
+        report.clients.push_back(stats);
+    }
+    return report;
+}
+
+void WebSocketTransport::sendFrame(quint64 clientId, Frame frame, const WireCodec* codec)
+{
+    auto it = m_peers.find(clientId);
+    if (it == m_peers.end() || it->closing) return;
+    Peer& peer = *it;
+    peer.codec = codec;
+    const bool backlog = !peer.replies.empty() || !peer.events.empty();
+    if (!backlog && peer.bytesToWrite() < m_limits.highWaterBytes) {
+        write(peer, frame);
+        return;
+    }
+    enqueue(peer, std::move(frame));
+    enforceLimit(peer);
+}
+
+void WebSocketTransport::enqueue(Peer& peer, Frame frame)
+{
+    const qint64 size = frame.bytes.size();
+    if (frame.subscriptionId.isEmpty()) {
+        peer.replies.push_back(std::move(frame));
+    } else if (m_limits.policy == OutboundLimits::Coalesce && frame.coalescable
+               && peer.pendingBySubscription.contains(frame.subscriptionId)) {
+        // Keep the older slot, so the subscription does not lose its place in line.
+        Frame& queued = *peer.pendingBySubscription.value(frame.subscriptionId);
+        peer.stats.queuedBytes -= queued.bytes.size();
+        queued.bytes = std::move(frame.bytes);
+        ++peer.stats.coalescedEvents;
+        ++peer.lostSinceNotice;
+        peer.lostSubscriptions.insert(queued.subscriptionId);
+    } else {
+        const QString subscriptionId = frame.subscriptionId;
+        peer.events.push_back(std::move(frame));
+        if (m_limits.policy == OutboundLimits::Coalesce && peer.events.back().coalescable)
+            peer.pendingBySubscription.insert(subscriptionId, std::prev(peer.events.end()));
+    }
+    peer.stats.queuedBytes += size;
+    peer.stats.peakQueuedBytes = qMax(peer.stats.peakQueuedBytes, peer.stats.queuedBytes);
+}
+
+void WebSocketTransport::enforceLimit(Peer& peer)
+{
+    if (peer.stats.queuedBytes <= m_limits.maxQueuedBytes) return;
+    if (m_limits.policy != OutboundLimits::Disconnect) {
+        while (peer.stats.queuedBytes > m_limits.maxQueuedBytes && !peer.events.empty())
+            dropEvent(peer, peer.events.begin());
+        if (peer.stats.queuedBytes <= m_limits.maxQueuedBytes) return;
+    }
+    // Free the queue now but tear the socket down on a later turn: the caller
+    // may be iterating subscriptions that clientDisconnected would remove.
+    ++m_disconnects;
+    peer.closing = true;
+    peer.replies.clear();
+    peer.events.clear();
+    peer.pendingBySubscription.clear();
+    peer.stats.queuedBytes = 0;
+    if (peer.socket) QMetaObject::invokeMethod(peer.socket, &QWebSocket::abort, Qt::QueuedConnection);
+    else QMetaObject::invokeMethod(peer.local, &QLocalSocket::abort, Qt::QueuedConnection);
+}
+
+void WebSocketTransport::dropEvent(Peer& peer, FrameQueue::iterator it)
+{
+    peer.stats.queuedBytes -= it->bytes.size();
+    ++peer.stats.droppedEvents;
+    ++peer.lostSinceNotice;
+    peer.lostSubscriptions.insert(it->subscriptionId);
+    const auto pending = peer.pendingBySubscription.constFind(it->subscriptionId);
+    if (pending != peer.pendingBySubscription.cend() && pending.value() == it)
+        peer.pendingBySubscription.erase(pending);
+    peer.events.erase(it);
+}
+
+void WebSocketTransport::flush(Peer& peer)
+{
+    if (peer.closing) return;
+    while (peer.bytesToWrite() < m_limits.highWaterBytes) {
+        FrameQueue& queue = !peer.replies.empty() ? peer.replies : peer.events;
+        if (queue.empty()) break;
+        const auto pending = peer.pendingBySubscription.constFind(queue.front().subscriptionId);
+        if (pending != peer.pendingBySubscription.cend() && pending.value() == queue.begin())
+            peer.pendingBySubscription.erase(pending);
+        Frame frame = std::move(queue.front());
+        queue.pop_front();
+        peer.stats.queuedBytes -= frame.bytes.size();
+        write(peer, frame);
+    }
+    if (!peer.replies.empty() || !peer.events.empty() || peer.lostSubscriptions.isEmpty() || !peer.codec) return;
+    // Caught up: tell the client which subscriptions lost events, so it can re-read their state.
+    const QStringList lost(peer.lostSubscriptions.cbegin(), peer.lostSubscriptions.cend());
+    const QJsonObject notice{{"method", "events_dropped"},
+                             {"params", QJsonObject{{"count", double(peer.lostSinceNotice)},
+                                                    {"subscriptions", QJsonArray::fromStringList(lost)}}}};
+    peer.lostSubscriptions.clear();
+    peer.lostSinceNotice = 0;
+    write(peer, Frame{peer.codec->encode(notice), peer.codec->isBinary(), {}});
+    emit eventsLost(peer.stats.clientId, lost);
+}
+
+void WebSocketTransport::write(Peer& peer, const Frame& frame)
+{
+    const qint64 start = Metrics::now();
+    if (peer.local) {
+        char header[LocalFrame::kHeaderBytes];
+        qToBigEndian<quint32>(quint32(frame.bytes.size()), header);
+        header[4] = frame.binary ? LocalFrame::kCbor : LocalFrame::kJson;
+        peer.local->write(header, sizeof header);
+        peer.local->write(frame.bytes);
+    } else if (frame.binary) {
+        peer.socket->sendBinaryMessage(frame.bytes);
+    } else {
+        // QWebSocket only takes text frames as QString, so JSON clients pay one UTF-8
+        // decode per frame; binary clients hand the encoded bytes over as they are.
+        peer.socket->sendTextMessage(QString::fromUtf8(frame.bytes));
+    }
+    if (m_metrics) {
+        m_metrics->recordPhase(frame.metricsSlot, Metrics::Send, Metrics::now() - start);
+        m_metrics->recordOut(frame.bytes.size());
+    }
+}
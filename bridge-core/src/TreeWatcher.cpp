@@ -0,0 +1,313 @@
+#include "TreeWatcher.hpp"
+#include "ObjectRegistry.hpp"
+
+#include <QEvent>
+#include <QMetaObject>
+#include <QTimer>
+#include <climits>
+#include <utility>
+
+namespace {
+// Deltas kept for clients catching up with changesSince().
+constexpr size_t kJournalSize = 10000;
+}
+
+TreeWatcher::TreeWatcher(ObjectRegistry* registry, std::function<QObjectList()> roots, Listener listener,
+                         QObject* parent)
+    : QObject(parent), m_registry(registry), m_rootsFn(std::move(roots)), m_listener(std::move(listener))
+{
+    m_childrenChangedSlot = metaObject()->indexOfSlot("onChildrenChanged()");
+    m_flushTimer = new QTimer(this);
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(0);
+    connect(m_flushTimer, &QTimer::timeout, this, [this] { flush(); });
+}
+
+void TreeWatcher::start()
+{
+    if (m_started) return;
+    m_started = true;
+    m_roots = m_rootsFn();
+    for (QObject* root : qAsConst(m_roots)) track(root, nullptr);
+}
+
+void TreeWatcher::track(QObject* obj, QObject* parent)
+{
+    const auto known = m_nodes.constFind(obj);
+    if (known != m_nodes.cend() && !known->dead) {
+        // Moved in from elsewhere within this turn: drop it there first.
+        if (known->parent) {
+            record({{"op", "removed"}, {"objectId", known->id}, {"parentId", m_nodes.value(known->parent).id}},
+                   known->parent, obj);
+            const auto from = m_nodes.find(known->parent);
+            if (from != m_nodes.end()) from->children.removeOne(obj);
+        }
+        untrack(obj);
+    } else if (known != m_nodes.cend()) {
+        untrack(obj); // a destroyed object's record at a reused address
+    }
+
+    const ObjectRegistry::Entry& entry = m_registry->ensure(obj);
+    Node node;
+    node.parent = parent;
+    node.id = entry.id;
+    node.type = entry.className;
+    node.name = obj->objectName();
+    node.children = obj->children();
+    const QObjectList children = node.children;
+    m_nodes.insert(obj, node);
+
+    obj->installEventFilter(this);
+    connect(obj, &QObject::objectNameChanged, this, &TreeWatcher::onObjectNameChanged);
+    connect(obj, &QObject::destroyed, this, &TreeWatcher::onDestroyed);
+    const int childrenChanged = obj->metaObject()->indexOfSignal("childrenChanged()");
+    if (childrenChanged >= 0) QMetaObject::connect(obj, childrenChanged, this, m_childrenChangedSlot);
+    for (QObject* child : children) track(child, obj);
+}
+
+void TreeWatcher::untrack(QObject* obj)
+{
+    const auto it = m_nodes.find(obj);
+    if (it == m_nodes.end()) return;
+    const Node node = *it;
+    m_nodes.erase(it);
+    m_dirty.remove(obj);
+    m_renamed.remove(obj);
+    if (!node.dead) {
+        obj->removeEventFilter(this);
+        QObject::disconnect(obj, nullptr, this, nullptr);
+    }
+    for (QObject* child : node.children) {
+        const auto c = m_nodes.constFind(child);
+        if (c != m_nodes.cend() && c->parent == obj) untrack(child);
+    }
+}
+
+void TreeWatcher::markDirty(QObject* obj)
+{
+    m_dirty.insert(obj);
+    if (!m_flushTimer->isActive()) m_flushTimer->start();
+}
+
+bool TreeWatcher::eventFilter(QObject* watched, QEvent* event)
+{
+    const QEvent::Type type = event->type();
+    if (type == QEvent::ChildAdded || type == QEvent::ChildRemoved) markDirty(watched);
+    return QObject::eventFilter(watched, event);
+}
+
+void TreeWatcher::onChildrenChanged()
+{
+    markDirty(sender());
+}
+
+void TreeWatcher::onObjectNameChanged()
+{
+    m_renamed.insert(sender());
+    if (!m_flushTimer->isActive()) m_flushTimer->start();
+}
+
+void TreeWatcher::onDestroyed(QObject* obj)
+{
+    // Called from ~QObject: only the mirror is touched, never obj itself.
+    const auto it = m_nodes.find(obj);
+    if (it == m_nodes.end()) return;
+    it->dead = true;
+    if (it->parent) {
+        markDirty(it->parent);
+    } else {
+        m_rootsDirty = true;
+        if (!m_flushTimer->isActive()) m_flushTimer->start();
+    }
+}
+
+void TreeWatcher::record(QJsonObject delta, QObject* anchor, QObject* second)
+{
+    Change change;
+    change.seq = ++m_seq;
+    delta.insert("seq", double(change.seq));
+    change.delta = delta;
+    change.anchors[0] = anchor;
+    change.anchors[1] = second;
+    m_journal.push_back(change);
+    if (m_journal.size() > kJournalSize) m_journal.pop_front();
+    m_fresh.push_back(change);
+}
+
+void TreeWatcher::diffRoots()
+{
+    const QObjectList now = m_rootsFn();
+    for (QObject* root : QObjectList(m_roots)) {
+        const auto n = m_nodes.constFind(root);
+        if (n != m_nodes.cend() && !n->dead && now.contains(root)) continue;
+        if (n != m_nodes.cend()) record({{"op", "removed"}, {"objectId", n->id}, {"parentId", QJsonValue()}}, nullptr, root);
+        untrack(root);
+        m_roots.removeOne(root);
+    }
+    for (QObject* root : now) {
+        if (m_roots.contains(root)) continue;
+        m_roots.push_back(root);
+        track(root, nullptr);
+        int count = 0;
+        bool truncated = false;
+        record({{"op", "added"}, {"parentId", QJsonValue()}, {"index", int(m_roots.size()) - 1},
+                {"node", nodeJson(root, 0, INT_MAX, INT_MAX, &count, &truncated)}}, nullptr, root);
+    }
+}
+
+void TreeWatcher::flush(bool verify)
+{
+    if (!m_started) return;
+    m_flushTimer->stop();
+    if (verify || m_rootsDirty) diffRoots();
+    m_rootsDirty = false;
+    if (verify) {
+        for (auto it = m_nodes.cbegin(); it != m_nodes.cend(); ++it) {
+            if (!it->dead && it.key()->children() != it->children) m_dirty.insert(it.key());
+        }
+    }
+
+    // New child lists of the dirty objects, and who arrived in them.
+    const QSet<QObject*> dirty = std::exchange(m_dirty, {});
+    QVector<QPair<QObject*, QObjectList>> lists;
+    QHash<QObject*, QObject*> arrivals; // child -> new parent
+    for (QObject* parent : dirty) {
+        const auto p = m_nodes.constFind(parent);
+        if (p == m_nodes.cend() || p->dead) continue;
+        const QObjectList now = parent->children();
+        for (QObject* child : now) {
+            const auto c = m_nodes.constFind(child);
+            if (c == m_nodes.cend() || c->dead || c->parent != parent) arrivals.insert(child, parent);
+        }
+        lists.push_back({parent, now});
+    }
+
+    // Departures: a child that arrived elsewhere was reparented, the rest are gone.
+    for (const auto& list : qAsConst(lists)) {
+        QObject* parent = list.first;
+        const QObjectList before = m_nodes.value(parent).children;
+        for (QObject* child : before) {
+            const auto c = m_nodes.find(child);
+            if (c == m_nodes.end() || c->parent != parent) continue;
+            if (!c->dead && list.second.contains(child)) continue;
+            if (!c->dead && arrivals.contains(child)) {
+                QObject* to = arrivals.take(child);
+                c->parent = to;
+                record({{"op", "reparented"}, {"objectId", c->id}, {"from", m_nodes.value(parent).id},
+                        {"to", m_nodes.value(to).id}, {"index", int(to->children().indexOf(child))}},
+                       parent, to);
+            } else {
+                record({{"op", "removed"}, {"objectId", c->id}, {"parentId", m_nodes.value(parent).id}}, parent, child);
+                untrack(child);
+            }
+        }
+    }
+
+    // Arrivals: moved in from an object that sent no notification, or new.
+    for (auto it = arrivals.cbegin(); it != arrivals.cend(); ++it) {
+        QObject* child = it.key();
+        QObject* parent = it.value();
+        const auto p = m_nodes.constFind(parent);
+        if (p == m_nodes.cend() || p->dead) continue;
+        const auto c = m_nodes.find(child);
+        if (c != m_nodes.end() && !c->dead) {
+            if (c->parent == parent) continue; // tracked with a subtree added earlier in this flush
+            QObject* from = c->parent;
+            const auto f = m_nodes.find(from);
+            if (f != m_nodes.end()) f->children.removeOne(child);
+            c->parent = parent;
+            record({{"op", "reparented"}, {"objectId", c->id}, {"from", m_nodes.value(from).id},
+                    {"to", p->id}, {"index", int(parent->children().indexOf(child))}},
+                   from, parent);
+            continue;
+        }
+        track(child, parent);
+        int count = 0;
+        bool truncated = false;
+        record({{"op", "added"}, {"parentId", m_nodes.value(parent).id}, {"index", int(parent->children().indexOf(child))},
+                {"node", nodeJson(child, 0, INT_MAX, INT_MAX, &count, &truncated)}}, parent);
+    }
+
+    for (const auto& list : qAsConst(lists)) {
+        const auto p = m_nodes.find(list.first);
+        if (p != m_nodes.end() && !p->dead) p->children = list.second;
+    }
+
+    const QSet<QObject*> renamed = std::exchange(m_renamed, {});
+    for (QObject* obj : renamed) {
+        const auto n = m_nodes.find(obj);
+        if (n == m_nodes.end() || n->dead || obj->objectName() == n->name) continue;
+        n->name = obj->objectName();
+        record({{"op", "renamed"}, {"objectId", n->id}, {"objectName", n->name}}, n->parent, obj);
+    }
+
+    if (m_fresh.isEmpty()) return;
+    const QVector<Change> fresh = std::exchange(m_fresh, {});
+    if (m_listener) m_listener(fresh);
+}
+
+bool TreeWatcher::isWithin(QObject* obj, QObject* root) const
+{
+    while (obj) {
+        if (obj == root) return true;
+        const auto n = m_nodes.constFind(obj);
+        if (n == m_nodes.cend()) return false;
+        obj = n->parent;
+    }
+    return false;
+}
+
+bool TreeWatcher::changesSince(quint64 since, QObject* root, QJsonArray* out) const
+{
+    const quint64 oldest = m_journal.empty() ? m_seq + 1 : m_journal.front().seq;
+    if (since + 1 < oldest) return false;
+    for (const Change& change : m_journal) {
+        if (change.seq <= since) continue;
+        if (root && !isWithin(change.anchors[0], root) && !isWithin(change.anchors[1], root)) continue;
+        out->push_back(change.delta);
+    }
+    return true;
+}
+
+QJsonArray TreeWatcher::snapshot(QObject* root, int maxDepth, int maxNodes, bool* truncated) const
+{
+    QJsonArray out;
+    int count = 0;
+    *truncated = false;
+    const QObjectList roots = root ? QObjectList{root} : m_roots;
+    for (QObject* r : roots) {
+        if (!m_nodes.contains(r)) continue;
+        if (count >= maxNodes) {
+            *truncated = true;
+            break;
+        }
+        out.push_back(nodeJson(r, 0, maxDepth, maxNodes, &count, truncated));
+    }
+    return out;
+}
+
+QJsonObject TreeWatcher::nodeJson(QObject* obj, int depth, int maxDepth, int maxNodes, int* count, bool* truncated) const
+{
+    const Node& node = *m_nodes.constFind(obj);
+    ++*count;
+    QJsonObject out{{"id", node.id}, {"type", node.type}};
+    if (!node.name.isEmpty()) out.insert("name", node.name);
+    if (node.children.isEmpty()) return out;
+    if (depth >= maxDepth) {
+        out.insert("childCount", int(node.children.size()));
+        return out;
+    }
+    QJsonArray children;
+    for (QObject* child : node.children) {
+        const auto c = m_nodes.constFind(child);
+        if (c == m_nodes.cend() || c->dead || c->parent != obj) continue;
+        if (*count >= maxNodes) {
+            *truncated = true;
+            break;
+        }
+        children.push_back(nodeJson(child, depth + 1, maxDepth, maxNodes, count, truncated));
+    }
+    if (children.size() < node.children.size()) out.insert("childCount", int(node.children.size()));
+    if (!children.isEmpty()) out.insert("children", children);
+    return out;
+}
@@ -0,0 +1,440 @@
+#include "VariantConverter.hpp"
+#include "ObjectRegistry.hpp"
+
+#include <QDateTime>
+#include <QJSValue>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QMetaProperty>
+#include <QPointF>
+#include <QRectF>
+#include <QSizeF>
+#include <QStringList>
+#include <QUrl>
+#include <cmath>
+#include <utility>
+
+namespace {
+QJsonValue pointJson(const QPointF& p)
+{
+    return QJsonObject{{"x", p.x()}, {"y", p.y()}};
+}
+
+QJsonValue sizeJson(const QSizeF& s)
+{
+    return QJsonObject{{"width", s.width()}, {"height", s.height()}};
+}
+
+QJsonValue rectJson(const QRectF& r)
+{
+    return QJsonObject{{"x", r.x()}, {"y", r.y()}, {"width", r.width()}, {"height", r.height()}};
+}
+
+// Reads { names[0], names[1], ... } or [n0, n1, ...] into out.
+template <size_t N>
+bool numbersFromJson(const QJsonValue& value, const char* const (&names)[N], double (&out)[N])
+{
+    if (value.isArray()) {
+        const QJsonArray arr = value.toArray();
+        if (arr.size() != qsizetype(N)) return false;
+        for (size_t i = 0; i < N; ++i) {
+            if (!arr.at(qsizetype(i)).isDouble()) return false;
+            out[i] = arr.at(qsizetype(i)).toDouble();
+        }
+        return true;
+    }
+    if (!value.isObject()) return false;
+    const QJsonObject obj = value.toObject();
+    for (size_t i = 0; i < N; ++i) {
+        const QJsonValue v = obj.value(QLatin1String(names[i]));
+        if (!v.isDouble()) return false;
+        out[i] = v.toDouble();
+    }
+    return true;
+}
+
+bool fail(QString* error, const QString& why)
+{
+    if (error) *error = why;
+    return false;
+}
+
+// Qt 5 has only the int type-id forms of these.
+bool convertTo(QVariant& v, QMetaType type)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    return v.metaType() == type || v.convert(type);
+#else
+    return v.userType() == type.id() || v.convert(type.id());
+#endif
+}
+
+QVariant makeVariant(QMetaType type, const void* copy)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    return QVariant(type, copy);
+#else
+    return QVariant(type.id(), copy);
+#endif
+}
+
+QMetaType propertyType(const QMetaProperty& p)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    return p.metaType();
+#else
+    return QMetaType(p.userType());
+#endif
+}
+
+constexpr const char* kPointNames[] = {"x", "y"};
+constexpr const char* kSizeNames[] = {"width", "height"};
+constexpr const char* kRectNames[] = {"x", "y", "width", "height"};
+}
+
+VariantConverter::VariantConverter(ObjectRegistry* registry)
+    : m_registry(registry), m_jsValueType(qMetaTypeId<QJSValue>())
+{
+}
+
+QJsonValue VariantConverter::toJson(const QVariant& v) const
+{
+    if (!v.isValid()) return QJsonValue();
+    const int type = v.userType(); // typeId() is Qt 6 only
+    switch (type) {
+    case QMetaType::Nullptr:
+        return QJsonValue();
+    case QMetaType::Bool:
+        return QJsonValue(v.toBool());
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+    case QMetaType::Long:
+    case QMetaType::ULong:
+    case QMetaType::Short:
+    case QMetaType::UShort:
+    case QMetaType::Char:
+    case QMetaType::SChar:
+    case QMetaType::UChar:
+    case QMetaType::Float:
+    case QMetaType::Double:
+        return QJsonValue(v.toDouble());
+    case QMetaType::QString:
+        return QJsonValue(*static_cast<const QString*>(v.constData()));
+    case QMetaType::QChar:
+    case QMetaType::QByteArray:
+        return QJsonValue(v.toString());
+    case QMetaType::QStringList:
+        return QJsonArray::fromStringList(*static_cast<const QStringList*>(v.constData()));
+    case QMetaType::QUrl:
+        return QJsonValue(static_cast<const QUrl*>(v.constData())->toString());
+    case QMetaType::QColor:
+        // QtGui registers the QColor -> QString conversion (QColor::name()).
+        return QJsonValue(v.toString());
+    case QMetaType::QDateTime:
+        return QJsonValue(static_cast<const QDateTime*>(v.constData())->toString(Qt::ISODateWithMs));
+    case QMetaType::QDate:
+        return QJsonValue(static_cast<const QDate*>(v.constData())->toString(Qt::ISODate));
+    case QMetaType::QTime:
+        return QJsonValue(static_cast<const QTime*>(v.constData())->toString(Qt::ISODateWithMs));
+    case QMetaType::QPointF:
+        return pointJson(*static_cast<const QPointF*>(v.constData()));
+    case QMetaType::QPoint:
+        return pointJson(QPointF(*static_cast<const QPoint*>(v.constData())));
+    case QMetaType::QSizeF:
+        return sizeJson(*static_cast<const QSizeF*>(v.constData()));
+    case QMetaType::QSize:
+        return sizeJson(QSizeF(*static_cast<const QSize*>(v.constData())));
+    case QMetaType::QRectF:
+        return rectJson(*static_cast<const QRectF*>(v.constData()));
+    case QMetaType::QRect:
+        return rectJson(QRectF(*static_cast<const QRect*>(v.constData())));
+    case QMetaType::QObjectStar:
+        return objectId(*static_cast<QObject* const*>(v.constData()));
+    case QMetaType::QJsonValue:
+        return *static_cast<const QJsonValue*>(v.constData());
+    case QMetaType::QJsonObject:
+        return *static_cast<const QJsonObject*>(v.constData());
+    case QMetaType::QJsonArray:
+        return *static_cast<const QJsonArray*>(v.constData());
+    case QMetaType::QVariantList: {
+        QJsonArray arr;
+        for (const QVariant& e : *static_cast<const QVariantList*>(v.constData())) arr.push_back(toJson(e));
+        return arr;
+    }
+    case QMetaType::QVariantMap: {
+        QJsonObject o;
+        const auto& map = *static_cast<const QVariantMap*>(v.constData());
+        for (auto it = map.cbegin(); it != map.cend(); ++it) o.insert(it.key(), toJson(it.value()));
+        return o;
+    }
+    case QMetaType::QVariantHash: {
+        QJsonObject o;
+        const auto& hash = *static_cast<const QVariantHash*>(v.constData());
+        for (auto it = hash.cbegin(); it != hash.cend(); ++it) o.insert(it.key(), toJson(it.value()));
+        return o;
+    }
+    default:
+        return convertOther(v, type);
+    }
+}
+
+QJsonValue VariantConverter::convertOther(const QVariant& v, int type) const
+{
+    switch (classify(type)) {
+    case Kind::Object:
+        return objectId(*static_cast<QObject* const*>(v.constData()));
+    case Kind::JsValue: {
+        const auto& js = *static_cast<const QJSValue*>(v.constData());
+        if (js.isQObject()) return objectId(js.toQObject());
+        if (js.isUndefined() || js.isNull()) return QJsonValue();
+        return toJson(js.toVariant());
+    }
+    case Kind::Custom: {
+        const auto it = m_custom.constFind(type);
+        if (it != m_custom.cend()) return it.value()(v, *this);
+        break;
+    }
+    default:
+        break;
+    }
+    return QJsonValue(QString::fromLatin1(v.typeName()));
+}
+
+VariantConverter::Kind VariantConverter::classify(int type) const
+{
+    if (type < QMetaType::User) return m_custom.contains(type) ? Kind::Custom : Kind::Named;
+    const size_t slot = size_t(type - QMetaType::User);
+    if (slot < m_userKinds.size() && m_userKinds[slot] != Kind::Unseen) return m_userKinds[slot];
+
+    Kind kind = Kind::Named;
+    if (m_custom.contains(type)) kind = Kind::Custom;
+    else if (type == m_jsValueType) kind = Kind::JsValue;
+    else if (QMetaType(type).flags() & QMetaType::PointerToQObject) kind = Kind::Object;
+    if (slot >= m_userKinds.size()) m_userKinds.resize(slot + 1, Kind::Unseen);
+    m_userKinds[slot] = kind;
+    return kind;
+}
+
+bool VariantConverter::fromJson(const QJsonValue& value, QMetaType type, QVariant* out, QString* error,
+                                const QMetaEnum& enumerator) const
+{
+    if (enumerator.isValid() && value.isString()) {
+        const QByteArray keys = value.toString().toUtf8();
+        bool ok = false;
+        const int n = enumerator.isFlag() ? enumerator.keysToValue(keys.constData(), &ok)
+                                          : enumerator.keyToValue(keys.constData(), &ok);
+        if (!ok) return fail(error, QStringLiteral("no %1 key \"%2\"").arg(QLatin1String(enumerator.name()), value.toString()));
+        QVariant v(n);
+        if (!convertTo(v, type)) return fail(error, QStringLiteral("cannot convert to %1").arg(QLatin1String(type.name())));
+        *out = std::move(v);
+        return true;
+    }
+
+    const int id = type.id();
+    switch (id) {
+    case QMetaType::QVariant: // untyped (QML var) properties take anything
+        *out = value.toVariant();
+        return true;
+    case QMetaType::QJsonValue:
+        *out = QVariant::fromValue(value);
+        return true;
+    case QMetaType::QJsonObject:
+        if (!value.isObject()) return fail(error, QStringLiteral("expected an object"));
+        *out = QVariant::fromValue(value.toObject());
+        return true;
+    case QMetaType::QJsonArray:
+        if (!value.isArray()) return fail(error, QStringLiteral("expected an array"));
+        *out = QVariant::fromValue(value.toArray());
+        return true;
+    case QMetaType::Bool:
+        if (!value.isBool()) return fail(error, QStringLiteral("expected a boolean"));
+        *out = value.toBool();
+        return true;
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+    case QMetaType::Long:
+    case QMetaType::ULong:
+    case QMetaType::Short:
+    case QMetaType::UShort:
+    case QMetaType::Char:
+    case QMetaType::SChar:
+    case QMetaType::UChar: {
+        if (!value.isDouble()) return fail(error, QStringLiteral("expected a number"));
+        const double d = value.toDouble();
+        if (d != std::trunc(d)) return fail(error, QStringLiteral("expected an integer"));
+        QVariant v(d);
+        // The round trip catches values the target type cannot hold.
+        if (!convertTo(v, type) || v.toDouble() != d) return fail(error, QStringLiteral("out of range for %1").arg(QLatin1String(type.name())));
+        *out = std::move(v);
+        return true;
+    }
+    case QMetaType::Float:
+    case QMetaType::Double: {
+        if (!value.isDouble()) return fail(error, QStringLiteral("expected a number"));
+        QVariant v(value.toDouble());
+        convertTo(v, type);
+        *out = std::move(v);
+        return true;
+    }
+    case QMetaType::QString:
+        if (!value.isString()) return fail(error, QStringLiteral("expected a string"));
+        *out = value.toString();
+        return true;
+    case QMetaType::QByteArray:
+        if (!value.isString()) return fail(error, QStringLiteral("expected a string"));
+        *out = value.toString().toUtf8();
+        return true;
+    case QMetaType::QChar:
+        if (!value.isString() || value.toString().size() != 1) return fail(error, QStringLiteral("expected a one-character string"));
+        *out = value.toString().at(0);
+        return true;
+    case QMetaType::QStringList: {
+        if (!value.isArray()) return fail(error, QStringLiteral("expected an array of strings"));
+        QStringList list;
+        for (const QJsonValue& e : value.toArray()) {
+            if (!e.isString()) return fail(error, QStringLiteral("expected an array of strings"));
+            list.push_back(e.toString());
+        }
+        *out = list;
+        return true;
+    }
+    case QMetaType::QUrl: {
+        if (!value.isString()) return fail(error, QStringLiteral("expected a URL string"));
+        const QUrl url(value.toString());
+        if (!url.isValid() && !value.toString().isEmpty()) return fail(error, url.errorString());
+        *out = url;
+        return true;
+    }
+    case QMetaType::QColor: {
+        // QtGui registers the QString -> QColor conversion (names and #rgb forms).
+        if (!value.isString()) return fail(error, QStringLiteral("expected a color string"));
+        QVariant v(value.toString());
+        if (!convertTo(v, type)) return fail(error, QStringLiteral("not a color: \"%1\"").arg(value.toString()));
+        *out = std::move(v);
+        return true;
+    }
+    case QMetaType::QDateTime:
+    case QMetaType::QDate:
+    case QMetaType::QTime: {
+        if (!value.isString()) return fail(error, QStringLiteral("expected an ISO 8601 string"));
+        const QString s = value.toString();
+        QVariant v;
+        if (id == QMetaType::QDateTime) v = QDateTime::fromString(s, Qt::ISODateWithMs);
+        else if (id == QMetaType::QDate) v = QDate::fromString(s, Qt::ISODate);
+        else v = QTime::fromString(s, Qt::ISODateWithMs);
+        bool valid = false;
+        if (id == QMetaType::QDateTime) valid = v.toDateTime().isValid();
+        else if (id == QMetaType::QDate) valid = v.toDate().isValid();
+        else valid = v.toTime().isValid();
+        if (!valid) return fail(error, QStringLiteral("not an ISO 8601 %1: \"%2\"").arg(QLatin1String(type.name()), s));
+        *out = std::move(v);
+        return true;
+    }
+    case QMetaType::QPoint:
+    case QMetaType::QPointF: {
+        double p[2];
+        if (!numbersFromJson(value, kPointNames, p)) return fail(error, QStringLiteral("expected { x, y } or [x, y]"));
+        if (id == QMetaType::QPoint) *out = QPoint(qRound(p[0]), qRound(p[1]));
+        else *out = QPointF(p[0], p[1]);
+        return true;
+    }
+    case QMetaType::QSize:
+    case QMetaType::QSizeF: {
+        double s[2];
+        if (!numbersFromJson(value, kSizeNames, s)) return fail(error, QStringLiteral("expected { width, height } or [width, height]"));
+        if (id == QMetaType::QSize) *out = QSize(qRound(s[0]), qRound(s[1]));
+        else *out = QSizeF(s[0], s[1]);
+        return true;
+    }
+    case QMetaType::QRect:
+    case QMetaType::QRectF: {
+        double r[4];
+        if (!numbersFromJson(value, kRectNames, r)) return fail(error, QStringLiteral("expected { x, y, width, height } or [x, y, width, height]"));
+        if (id == QMetaType::QRect) *out = QRect(qRound(r[0]), qRound(r[1]), qRound(r[2]), qRound(r[3]));
+        else *out = QRectF(r[0], r[1], r[2], r[3]);
+        return true;
+    }
+    case QMetaType::QVariantList:
+        if (!value.isArray()) return fail(error, QStringLiteral("expected an array"));
+        *out = value.toArray().toVariantList();
+        return true;
+    case QMetaType::QVariantMap:
+        if (!value.isObject()) return fail(error, QStringLiteral("expected an object"));
+        *out = value.toObject().toVariantMap();
+        return true;
+    case QMetaType::QVariantHash:
+        if (!value.isObject()) return fail(error, QStringLiteral("expected an object"));
+        *out = value.toObject().toVariantHash();
+        return true;
+    default:
+        break;
+    }
+
+    if (type.flags() & QMetaType::PointerToQObject) {
+        QObject* obj = nullptr;
+        if (value.isString()) {
+            obj = m_registry ? m_registry->resolve(value.toString()) : nullptr;
+            if (!obj) return fail(error, QStringLiteral("unknown object id \"%1\"").arg(value.toString()));
+            if (type.metaObject() && !obj->metaObject()->inherits(type.metaObject()))
+                return fail(error, QStringLiteral("object is not a %1").arg(QLatin1String(type.metaObject()->className())));
+        } else if (!value.isNull()) {
+            return fail(error, QStringLiteral("expected an object id or null"));
+        }
+        *out = makeVariant(type, &obj);
+        return true;
+    }
+    if ((type.flags() & QMetaType::IsGadget) && type.metaObject() && value.isObject())
+        return gadgetFromJson(value.toObject(), type, out, error);
+
+    QVariant v = value.toVariant();
+    if (!convertTo(v, type)) return fail(error, QStringLiteral("cannot convert to %1").arg(QLatin1String(type.name())));
+    *out = std::move(v);
+    return true;
+}
+
+bool VariantConverter::gadgetFromJson(const QJsonObject& value, QMetaType type, QVariant* out, QString* error) const
+{
+    const QMetaObject* mo = type.metaObject();
+    QVariant gadget = makeVariant(type, nullptr);
+    for (auto it = value.constBegin(); it != value.constEnd(); ++it) {
+        const int index = mo->indexOfProperty(it.key().toUtf8().constData());
+        if (index < 0) return fail(error, QStringLiteral("%1 has no property %2").arg(QLatin1String(mo->className()), it.key()));
+        const QMetaProperty p = mo->property(index);
+        QVariant field;
+        QString why;
+        if (!fromJson(it.value(), propertyType(p), &field, &why, p.isEnumType() ? p.enumerator() : QMetaEnum()))
+            return fail(error, it.key() + QLatin1String(": ") + why);
+        if (!p.writeOnGadget(gadget.data(), std::move(field))) return fail(error, it.key() + QLatin1String(": not writable"));
+    }
+    *out = std::move(gadget);
+    return true;
+}
+
+QJsonValue VariantConverter::objectId(QObject* obj) const
+{
+    if (!obj || !m_registry) return QJsonValue();
+    return m_registry->idFor(obj);
+}
+
+void VariantConverter::registerConverter(int typeId, Converter convert)
+{
+    m_custom.insert(typeId, std::move(convert));
+    if (typeId >= QMetaType::User && size_t(typeId - QMetaType::User) < m_userKinds.size())
+        m_userKinds[size_t(typeId - QMetaType::User)] = Kind::Custom;
+}
+
+void VariantConverter::registerGadget(int typeId, const QMetaObject* metaObject)
+{
+    registerConverter(typeId, [metaObject](const QVariant& v, const VariantConverter& converter) {
+        QJsonObject o;
+        for (int i = 0; i < metaObject->propertyCount(); ++i) {
+            const QMetaProperty p = metaObject->property(i);
+            if (p.isReadable()) o.insert(QString::fromLatin1(p.name()), converter.toJson(p.readOnGadget(v.constData())));
+        }
+        return QJsonValue(o);
+    });
+}
@@ -0,0 +1,150 @@
+#include "WireCodec.hpp"
+
+#include <QCborMap>
+#include <QCborValue>
+#include <QJsonArray>
+#include <QJsonDocument>
+
+namespace {
+
+class JsonCodec final : public WireCodec {
+public:
+    QString name() const override { return QStringLiteral("json"); }
+    bool isBinary() const override { return false; }
+
+    QJsonValue decode(const QByteArray& frame) const override
+    {
+        const auto doc = QJsonDocument::fromJson(frame);
+        if (doc.isObject()) return doc.object();
+        if (doc.isArray()) return doc.array();
+        return QJsonValue(QJsonValue::Undefined);
+    }
+
+    QByteArray encode(const QJsonValue& message) const override
+    {
+        const QJsonDocument doc = message.isArray() ? QJsonDocument(message.toArray())
+                                                    : QJsonDocument(message.toObject());
+        return doc.toJson(QJsonDocument::Compact);
+    }
+
+    QByteArray encodeEventBody(const QJsonObject& params) const override
+    {
+        return QJsonDocument(params).toJson(QJsonDocument::Compact);
+    }
+
+    QByteArray frameEvent(const QString& subscriptionId, const QByteArray& body) const override
+    {
+        // body is "{...}" with at least one member; drop its opening brace.
+        QByteArray out;
+        const QByteArray id = subscriptionId.toUtf8();
+        out.reserve(body.size() + id.size() + 48);
+        out += "{\"method\":\"event\",\"params\":{\"subscriptionId\":\"";
+        out += id;
+        out += "\",";
+        out.append(body.constData() + 1, body.size() - 1);
+        out += '}';
+        return out;
+    }
+};
+
+// Appends a CBOR head (major type + argument, RFC 8949 §3).
+void appendHead(QByteArray& out, quint8 major, quint64 value)
+{
+    const char m = char(major << 5);
+    if (value < 24) {
+        out += char(m | char(value));
+    } else if (value <= 0xff) {
+        out += char(m | 24);
+        out += char(value);
+    } else if (value <= 0xffff) {
+        out += char(m | 25);
+        for (int s = 8; s >= 0; s -= 8) out += char(value >> s);
+    } else if (value <= 0xffffffffull) {
+        out += char(m | 26);
+        for (int s = 24; s >= 0; s -= 8) out += char(value >> s);
+    } else {
+        out += char(m | 27);
+        for (int s = 56; s >= 0; s -= 8) out += char(value >> s);
+    }
+}
+
+void appendText(QByteArray& out, const QByteArray& utf8)
+{
+    appendHead(out, 3, quint64(utf8.size()));
+    out += utf8;
+}
+
+class CborCodec final : public WireCodec {
+public:
+    QString name() const override { return QStringLiteral("cbor"); }
+    bool isBinary() const override { return true; }
+
+    QJsonValue decode(const QByteArray& frame) const override
+    {
+        QCborParserError err;
+        const QCborValue v = QCborValue::fromCbor(frame, &err);
+        if (err.error != QCborError::NoError || !(v.isMap() || v.isArray()))
+            return QJsonValue(QJsonValue::Undefined);
+        return v.toJsonValue();
+    }
+
+    QByteArray encode(const QJsonValue& message) const override
+    {
+        // Integral doubles become CBOR integers, which is most of our numbers.
+        return QCborValue::fromJsonValue(message).toCbor();
+    }
+
+    QByteArray encodeEventBody(const QJsonObject& params) const override
+    {
+        return QCborMap::fromJsonObject(params).toCborValue().toCbor();
+    }
+
+    QByteArray frameEvent(const QString& subscriptionId, const QByteArray& body) const override
+    {
+        // body is a definite-length map; re-emit its head with one more pair and
+        // put subscriptionId first.
+        const auto* p = reinterpret_cast<const uchar*>(body.constData());
+        const uchar info = p[0] & 0x1f;
+        const int headLen = info < 24 ? 1 : 1 + (1 << (info - 24));
+        quint64 pairs = info < 24 ? info : 0;
+        for (int i = 1; i < headLen; ++i) pairs = (pairs << 8) | p[i];
+
+        QByteArray out;
+        out.reserve(body.size() + subscriptionId.size() + 40);
+        appendHead(out, 5, 2);
+        appendText(out, QByteArrayLiteral("method"));
+        appendText(out, QByteArrayLiteral("event"));
+        appendText(out, QByteArrayLiteral("params"));
+        appendHead(out, 5, pairs + 1);
+        appendText(out, QByteArrayLiteral("subscriptionId"));
+        appendText(out, subscriptionId.toUtf8());
+        out.append(body.constData() + headLen, body.size() - headLen);
+        return out;
+    }
+};
+
+} // namespace
+
+const WireCodec* WireCodec::json()
+{
+    static const JsonCodec codec;
+    return &codec;
+}
+
+const WireCodec* WireCodec::cbor()
+{
+    static const CborCodec codec;
+    return &codec;
+}
+
+const WireCodec* WireCodec::byName(const QString& name)
+{
+    if (name == QLatin1String("json")) return json();
+    if (name == QLatin1String("cbor")) return cbor();
+    return nullptr;
+}
+
+QStringList WireCodec::names()
+{
+    return {QStringLiteral("json"), QStringLiteral("cbor")};
+}
@@ -7,6 +7,9 @@ int main(int argc, char** argv){
     QQmlApplicationEngine engine;
     engine.load(QUrl(QStringLiteral("qrc:/main.qml")));
     InspectorServer server(&engine, QHostAddress::LocalHost, 7777);
+    server.setObjectIndexEnabled(true);
+    server.startMetricsEndpoint(7778);
+    server.listenLocal(QStringLiteral("qab-minimal")); // same-host clients: qab-cli --local qab-minimal
     if (engine.rootObjects().isEmpty()) return 1;
     return app.exec();
 }
@@ -1,40 +1,131 @@
 #include <QCoreApplication>
 #include <QCommandLineParser>
+#include <QLocalSocket>
 #include <QWebSocket>
 #include <QTimer>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QJsonArray>
+#include <QCborValue>
+#include <QtEndian>
+#include <functional>
 
 int main(int argc, char** argv){
     QCoreApplication app(argc, argv);
     QCommandLineParser p;
     p.addHelpOption();
     QCommandLineOption urlOpt({"u", "url"}, "ws url", "url", "ws://127.0.0.1:7777");
+    QCommandLineOption localOpt({"L", "local"}, "connect to the app's local socket (name or path) instead of --url", "name");
     QCommandLineOption methodOpt({"m", "method"}, "method", "method", "hello");
     QCommandLineOption paramsOpt({"p", "params"}, "json params", "json", "{}");
-    p.addOption(urlOpt); p.addOption(methodOpt); p.addOption(paramsOpt);
+    QCommandLineOption batchOpt({"b", "batch"}, "json array of {method,params} sent as one batch", "json");
+    QCommandLineOption encodingOpt({"e", "encoding"}, "wire encoding negotiated via hello (json|cbor)", "name", "json");
+    p.addOption(urlOpt); p.addOption(localOpt); p.addOption(methodOpt); p.addOption(paramsOpt); p.addOption(batchOpt); p.addOption(encodingOpt);
     p.process(app);
 
     const QUrl url(p.value(urlOpt));
     const QString method = p.value(methodOpt);
     const QJsonObject params = QJsonDocument::fromJson(p.value(paramsOpt).toUtf8()).object();
+    QJsonArray batch;
+    if (p.isSet(batchOpt)) {
+        const auto doc = QJsonDocument::fromJson(p.value(batchOpt).toUtf8());
+        if (!doc.isArray()) { fprintf(stderr, "error: --batch expects a JSON array\n"); return 2; }
+        int n = 1;
+        for (const auto& v : doc.array()) {
+            QJsonObject req = v.toObject();
+            if (!req.contains("id")) req.insert("id", QString::number(n));
+            ++n;
+            batch.push_back(req);
+        }
+    }
 
+    const bool binary = p.value(encodingOpt) == QLatin1String("cbor");
+    const bool local = p.isSet(localOpt);
+
+    // Frames are JSON text or CBOR binary on either transport; the local
+    // socket carries them as <u32 big-endian length><'J'|'C'><payload>.
     QWebSocket sock;
-    QObject::connect(&sock, &QWebSocket::connected, &app, [&](){
+    QLocalSocket localSock;
+    QByteArray localInput;
+    auto sendFrame = [&](const QByteArray& bytes, bool isBinary){
+        if (!local) {
+            if (isBinary) sock.sendBinaryMessage(bytes);
+            else sock.sendTextMessage(QString::fromUtf8(bytes));
+            return;
+        }
+        char header[5];
+        qToBigEndian<quint32>(quint32(bytes.size()), header);
+        header[4] = isBinary ? 'C' : 'J';
+        localSock.write(header, sizeof header);
+        localSock.write(bytes);
+    };
+
+    bool negotiating = binary;
+    auto sendRequest = [&](){
         static int id = 1;
-        QJsonObject req{{"id", QString::number(id++)}, {"method", method}, {"params", params}};
-        sock.sendTextMessage(QString::fromUtf8(QJsonDocument(req).toJson(QJsonDocument::Compact)));
-    });
-    QObject::connect(&sock, &QWebSocket::textMessageReceived, &app, [&](const QString& msg){
-        printf("%s\n", msg.toUtf8().constData());
+        QJsonValue msg = batch;
+        if (batch.isEmpty()) msg = QJsonObject{{"id", QString::number(id++)}, {"method", method}, {"params", params}};
+        if (binary) sendFrame(QCborValue::fromJsonValue(msg).toCbor(), true);
+        else if (msg.isArray()) sendFrame(QJsonDocument(msg.toArray()).toJson(QJsonDocument::Compact), false);
+        else sendFrame(QJsonDocument(msg.toObject()).toJson(QJsonDocument::Compact), false);
+    };
+    auto onConnected = [&](){
+        if (!negotiating) { sendRequest(); return; }
+        // The hello reply still arrives as JSON; everything after it is CBOR.
+        QJsonObject hello{{"id", "encoding"}, {"method", "hello"}, {"params", QJsonObject{{"encoding", "cbor"}}}};
+        sendFrame(QJsonDocument(hello).toJson(QJsonDocument::Compact), false);
+    };
+    auto onText = [&](const QByteArray& msg){
+        if (negotiating) {
+            negotiating = false;
+            if (QJsonDocument::fromJson(msg).object().contains("error")) {
+                fprintf(stderr, "error: %s\n", msg.constData());
+                app.exit(2);
+                return;
+            }
+            sendRequest();
+            return;
+        }
+        printf("%s\n", msg.constData());
+        app.quit();
+    };
+    auto onBinary = [&](const QByteArray& msg){
+        const QJsonValue v = QCborValue::fromCbor(msg).toJsonValue();
+        const QJsonDocument doc = v.isArray() ? QJsonDocument(v.toArray()) : QJsonDocument(v.toObject());
+        printf("%s\n", doc.toJson(QJsonDocument::Compact).constData());
         app.quit();
-    });
-    QObject::connect(&sock, &QWebSocket::errorOccurred, &app, [&](QAbstractSocket::SocketError){
-        fprintf(stderr, "error: %s\n", sock.errorString().toUtf8().constData());
-        app.exit(2);
-    });
+    };
 
-    sock.open(url);
-    QTimer::singleShot(5000, &app, [&](){ if(sock.state()!=QAbstractSocket::ConnectedState) app.exit(3); });
+    bool connected = false;
+    if (local) {
+        QObject::connect(&localSock, &QLocalSocket::connected, &app, [&](){ connected = true; onConnected(); });
+        QObject::connect(&localSock, &QLocalSocket::readyRead, &app, [&](){
+            localInput += localSock.readAll();
+            while (localInput.size() >= 5) {
+                const quint32 size = qFromBigEndian<quint32>(localInput.constData());
+                if (localInput.size() - 5 < qsizetype(size)) break;
+                const char kind = localInput.at(4);
+                const QByteArray payload = localInput.mid(5, size);
+                localInput.remove(0, 5 + qsizetype(size));
+                if (kind == 'C') onBinary(payload);
+                else onText(payload);
+            }
+        });
+        QObject::connect(&localSock, &QLocalSocket::errorOccurred, &app, [&](QLocalSocket::LocalSocketError){
+            fprintf(stderr, "error: %s\n", localSock.errorString().toUtf8().constData());
+            app.exit(2);
+        });
+        localSock.connectToServer(p.value(localOpt));
+    } else {
+        QObject::connect(&sock, &QWebSocket::connected, &app, [&](){ connected = true; onConnected(); });
+        QObject::connect(&sock, &QWebSocket::textMessageReceived, &app, [&](const QString& msg){ onText(msg.toUtf8()); });
+        QObject::connect(&sock, &QWebSocket::binaryMessageReceived, &app, onBinary);
+        QObject::connect(&sock, &QWebSocket::errorOccurred, &app, [&](QAbstractSocket::SocketError){
+            fprintf(stderr, "error: %s\n", sock.errorString().toUtf8().constData());
+            app.exit(2);
+        });
+        sock.open(url);
+    }
+    QTimer::singleShot(5000, &app, [&](){ if(!connected) app.exit(3); });
     return app.exec();
-}
\ No newline at end of file
+}
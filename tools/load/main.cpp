@@ -0,0 +1,531 @@
+#include <QCoreApplication>
+#include <QCborValue>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QTimer>
+#include <QUrl>
+#include <QVector>
+#include <QWebSocket>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+// qab-load: many concurrent clients replaying a workload file against a
+// running InspectorServer, reporting latency, lost events and server memory
+// as JSON lines. See tools/load/minimal.json for the workload format.
+
+namespace {
+
+struct RequestSpec {
+    QString method;
+    QJsonObject params;
+    double rate { 1 }; // per client, per second
+};
+
+struct Workload {
+    QUrl url { QStringLiteral("ws://127.0.0.1:7777") };
+    int clients { 4 };
+    int durationSec { 60 };
+    int reportIntervalSec { 10 };
+    int timeoutSec { 10 };
+    bool cbor { false };
+    QJsonArray setup;
+    QVector<RequestSpec> subscriptions;
+    QVector<RequestSpec> requests;
+};
+
+// Log-bucketed latency histogram (10% wide buckets from 10 µs), so hours of
+// samples take constant memory.
+class LatencyLog {
+public:
+    void add(double ms)
+    {
+        const int i = ms <= kMinMs ? 0 : std::min(kBuckets - 1, int(std::log(ms / kMinMs) / std::log(kGrowth)) + 1);
+        ++m_buckets[size_t(i)];
+        ++m_count;
+        m_max = std::max(m_max, ms);
+    }
+    void merge(const LatencyLog& other)
+    {
+        for (size_t i = 0; i < m_buckets.size(); ++i) m_buckets[i] += other.m_buckets[i];
+        m_count += other.m_count;
+        m_max = std::max(m_max, other.m_max);
+    }
+    quint64 count() const { return m_count; }
+    double quantile(double q) const
+    {
+        if (m_count == 0) return 0;
+        const quint64 rank = quint64(q * double(m_count - 1)) + 1;
+        quint64 seen = 0;
+        for (size_t i = 0; i < m_buckets.size(); ++i) {
+            seen += m_buckets[i];
+            if (seen >= rank) return std::min(m_max, kMinMs * std::pow(kGrowth, double(i)));
+        }
+        return m_max;
+    }
+    QJsonObject toJson() const
+    {
+        return {{"count", double(m_count)},
+                {"msP50", quantile(0.5)},
+                {"msP90", quantile(0.9)},
+                {"msP99", quantile(0.99)},
+                {"msMax", m_max}};
+    }
+
+private:
+    static constexpr double kMinMs = 0.01;
+    static constexpr double kGrowth = 1.1;
+    static constexpr int kBuckets = 200; // up to ~30 minutes
+    std::vector<quint64> m_buckets = std::vector<quint64>(kBuckets);
+    quint64 m_count { 0 };
+    double m_max { 0 };
+};
+
+struct Counters {
+    quint64 sent { 0 };
+    quint64 replies { 0 };
+    quint64 errors { 0 };
+    quint64 timeouts { 0 };
+    quint64 events { 0 };
+    quint64 eventsDropped { 0 }; // reported by the server: "dropped" fields and events_dropped notices
+    quint64 behind { 0 };        // schedule resets because the client fell more than a second behind
+    quint64 disconnects { 0 };
+};
+
+struct Totals {
+    Counters interval;
+    Counters total;
+    QHash<QString, LatencyLog> intervalLatency; // by method
+    QHash<QString, LatencyLog> totalLatency;
+
+    void count(quint64 Counters::*field, quint64 n = 1)
+    {
+        interval.*field += n;
+        total.*field += n;
+    }
+};
+
+QJsonObject countersJson(const Counters& c)
+{
+    return {{"sent", double(c.sent)},
+            {"replies", double(c.replies)},
+            {"errors", double(c.errors)},
+            {"timeouts", double(c.timeouts)},
+            {"events", double(c.events)},
+            {"eventsDropped", double(c.eventsDropped)},
+            {"behind", double(c.behind)},
+            {"disconnects", double(c.disconnects)}};
+}
+
+QJsonObject latencyJson(const QHash<QString, LatencyLog>& logs)
+{
+    QJsonObject out;
+    for (auto it = logs.cbegin(); it != logs.cend(); ++it) out.insert(it.key(), it.value().toJson());
+    return out;
+}
+
+qint64 nowNs(const QElapsedTimer& clock)
+{
+    return clock.nsecsElapsed();
+}
+
+// "$name" strings anywhere in a value are replaced by the setup results.
+QJsonValue substitute(const QJsonValue& v, const QHash<QString, QJsonValue>& vars)
+{
+    if (v.isString()) {
+        const QString s = v.toString();
+        if (s.startsWith(QLatin1Char('$')) && vars.contains(s.mid(1))) return vars.value(s.mid(1));
+        return v;
+    }
+    if (v.isArray()) {
+        QJsonArray out;
+        for (const QJsonValue& e : v.toArray()) out.push_back(substitute(e, vars));
+        return out;
+    }
+    if (v.isObject()) {
+        const QJsonObject o = v.toObject();
+        QJsonObject out;
+        for (auto it = o.begin(); it != o.end(); ++it) out.insert(it.key(), substitute(it.value(), vars));
+        return out;
+    }
+    return v;
+}
+
+// Dotted path into a result, e.g. "matches.0.objectId".
+QJsonValue pick(QJsonValue v, const QString& path)
+{
+    for (const QString& part : path.split(QLatin1Char('.'), Qt::SkipEmptyParts)) {
+        bool isIndex = false;
+        const int index = part.toInt(&isIndex);
+        v = isIndex && v.isArray() ? v.toArray().at(index) : v.toObject().value(part);
+    }
+    return v;
+}
+
+QByteArray encodeFrame(const QJsonObject& msg, bool cbor)
+{
+    return cbor ? QCborValue::fromJsonValue(msg).toCbor() : QJsonDocument(msg).toJson(QJsonDocument::Compact);
+}
+
+class LoadClient {
+public:
+    LoadClient(const Workload& workload, Totals& totals, const QElapsedTimer& clock)
+        : m_workload(workload), m_totals(totals), m_clock(clock)
+    {
+        QObject::connect(&m_sock, &QWebSocket::connected, [this] { onConnected(); });
+        QObject::connect(&m_sock, &QWebSocket::disconnected, [this] {
+            if (m_connected) m_totals.count(&Counters::disconnects);
+            m_connected = false;
+        });
+        QObject::connect(&m_sock, &QWebSocket::textMessageReceived, [this](const QString& msg) {
+            onMessage(QJsonDocument::fromJson(msg.toUtf8()).object());
+        });
+        QObject::connect(&m_sock, &QWebSocket::binaryMessageReceived, [this](const QByteArray& msg) {
+            onMessage(QCborValue::fromCbor(msg).toJsonValue().toObject());
+        });
+    }
+
+    void open() { m_sock.open(m_workload.url); }
+    void close() { m_sock.close(); }
+
+    // Sends every request that is due; the schedule is open-loop, so a slow
+    // server shows up as latency rather than as a lower request rate.
+    void tick()
+    {
+        if (!m_connected || m_negotiating) return;
+        const qint64 now = nowNs(m_clock);
+        for (int i = 0; i < m_workload.requests.size(); ++i) {
+            const RequestSpec& spec = m_workload.requests.at(i);
+            const double period = 1e9 / spec.rate;
+            if (now - m_nextDue[size_t(i)] > 1e9) {
+                m_totals.count(&Counters::behind);
+                m_nextDue[size_t(i)] = double(now);
+            }
+            while (m_nextDue[size_t(i)] <= now) {
+                send(spec.method, spec.params, i);
+                m_nextDue[size_t(i)] += period;
+            }
+        }
+    }
+
+    // Counts replies that did not arrive within the workload timeout.
+    void expire()
+    {
+        const qint64 limit = nowNs(m_clock) - qint64(m_workload.timeoutSec) * 1000000000LL;
+        for (auto it = m_pending.begin(); it != m_pending.end();) {
+            if (it->sentNs < limit) {
+                m_totals.count(&Counters::timeouts);
+                it = m_pending.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+private:
+    struct Pending {
+        int spec { -1 }; // -1 for subscribe calls
+        qint64 sentNs { 0 };
+    };
+
+    void onConnected()
+    {
+        m_connected = true;
+        const qint64 now = nowNs(m_clock);
+        m_nextDue.assign(size_t(m_workload.requests.size()), 0);
+        for (int i = 0; i < m_workload.requests.size(); ++i) {
+            // Stagger the first send so clients do not fire in lockstep.
+            const double period = 1e9 / m_workload.requests.at(i).rate;
+            m_nextDue[size_t(i)] = double(now) + QRandomGenerator::global()->bounded(period);
+        }
+        if (m_workload.cbor) {
+            // The hello reply is still JSON; frames after it use CBOR.
+            m_negotiating = true;
+            m_sock.sendTextMessage(QString::fromUtf8(encodeFrame(
+                {{"id", "hello"}, {"method", "hello"}, {"params", QJsonObject{{"encoding", "cbor"}}}}, false)));
+            return;
+        }
+        subscribe();
+    }
+
+    void subscribe()
+    {
+        for (const RequestSpec& sub : m_workload.subscriptions) send(sub.method, sub.params, -1);
+    }
+
+    void send(const QString& method, const QJsonObject& params, int spec)
+    {
+        const quint64 id = m_nextId++;
+        m_pending.insert(id, Pending{spec, nowNs(m_clock)});
+        const QByteArray frame = encodeFrame({{"id", QString::number(id)}, {"method", method}, {"params", params}}, m_cborActive);
+        if (m_cborActive) m_sock.sendBinaryMessage(frame);
+        else m_sock.sendTextMessage(QString::fromUtf8(frame));
+        m_totals.count(&Counters::sent);
+    }
+
+    void onMessage(const QJsonObject& msg)
+    {
+        const QString method = msg.value("method").toString();
+        if (method == QLatin1String("event")) {
+            m_totals.count(&Counters::events);
+            const auto dropped = quint64(msg.value("params").toObject().value("dropped").toDouble());
+            if (dropped > 0) m_totals.count(&Counters::eventsDropped, dropped);
+            return;
+        }
+        if (method == QLatin1String("events_dropped")) {
+            m_totals.count(&Counters::eventsDropped, quint64(msg.value("params").toObject().value("count").toDouble()));
+            return;
+        }
+        const QString id = msg.value("id").toString();
+        if (m_negotiating && id == QLatin1String("hello")) {
+            m_negotiating = false;
+            m_cborActive = !msg.contains("error");
+            subscribe();
+            return;
+        }
+        bool ok = false;
+        const auto it = m_pending.find(id.toULongLong(&ok));
+        if (!ok || it == m_pending.end()) return; // model chunks, late replies after a timeout
+        const Pending pending = *it;
+        m_pending.erase(it);
+        m_totals.count(&Counters::replies);
+        if (msg.contains("error")) m_totals.count(&Counters::errors);
+        if (pending.spec < 0) return;
+        const QString& name = m_workload.requests.at(pending.spec).method;
+        const double ms = (nowNs(m_clock) - pending.sentNs) / 1e6;
+        m_totals.intervalLatency[name].add(ms);
+        m_totals.totalLatency[name].add(ms);
+    }
+
+    const Workload& m_workload;
+    Totals& m_totals;
+    const QElapsedTimer& m_clock;
+    QWebSocket m_sock;
+    bool m_connected { false };
+    bool m_negotiating { false };
+    bool m_cborActive { false };
+    quint64 m_nextId { 1 };
+    QHash<quint64, Pending> m_pending;
+    std::vector<double> m_nextDue; // ns on m_clock, per request spec
+};
+
+// One blocking request on its own connection, for setup steps and stats polls.
+QJsonObject callOnce(QWebSocket& sock, const QString& method, const QJsonObject& params, int timeoutMs = 10000)
+{
+    static quint64 nextId = 1;
+    const QString id = QStringLiteral("m%1").arg(nextId++);
+    QJsonObject reply;
+    QEventLoop loop;
+    const auto conn = QObject::connect(&sock, &QWebSocket::textMessageReceived, [&](const QString& msg) {
+        const QJsonObject o = QJsonDocument::fromJson(msg.toUtf8()).object();
+        if (o.value("id").toString() != id) return;
+        reply = o;
+        loop.quit();
+    });
+    QTimer::singleShot(timeoutMs, &loop, &QEventLoop::quit);
+    sock.sendTextMessage(QString::fromUtf8(encodeFrame({{"id", id}, {"method", method}, {"params", params}}, false)));
+    loop.exec();
+    QObject::disconnect(conn);
+    return reply;
+}
+
+bool connectBlocking(QWebSocket& sock, const QUrl& url)
+{
+    QEventLoop loop;
+    QObject::connect(&sock, &QWebSocket::connected, &loop, &QEventLoop::quit);
+    QTimer::singleShot(5000, &loop, &QEventLoop::quit);
+    sock.open(url);
+    loop.exec();
+    return sock.state() == QAbstractSocket::ConnectedState;
+}
+
+bool loadWorkload(const QString& path, Workload* w, QString* error)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+        *error = QStringLiteral("cannot open %1").arg(path);
+        return false;
+    }
+    QJsonParseError parseError;
+    const QJsonObject o = QJsonDocument::fromJson(f.readAll(), &parseError).object();
+    if (parseError.error != QJsonParseError::NoError) {
+        *error = parseError.errorString();
+        return false;
+    }
+    if (o.contains("url")) w->url = QUrl(o.value("url").toString());
+    w->clients = o.value("clients").toInt(w->clients);
+    w->durationSec = o.value("durationSec").toInt(w->durationSec);
+    w->reportIntervalSec = std::max(1, o.value("reportIntervalSec").toInt(w->reportIntervalSec));
+    w->timeoutSec = std::max(1, o.value("timeoutSec").toInt(w->timeoutSec));
+    w->cbor = o.value("encoding").toString() == QLatin1String("cbor");
+    w->setup = o.value("setup").toArray();
+    auto specs = [](const QJsonArray& list) {
+        QVector<RequestSpec> out;
+        for (const QJsonValue& v : list) {
+            const QJsonObject s = v.toObject();
+            out.push_back({s.value("method").toString(), s.value("params").toObject(), s.value("rate").toDouble(1)});
+        }
+        return out;
+    };
+    w->subscriptions = specs(o.value("subscriptions").toArray());
+    w->requests = specs(o.value("requests").toArray());
+    for (const RequestSpec& r : w->requests) {
+        if (r.method.isEmpty() || r.rate <= 0) {
+            *error = QStringLiteral("every request needs a method and a positive rate");
+            return false;
+        }
+    }
+    return true;
+}
+
+// Resolves setup steps in order and substitutes their results into the
+// subscription and request params.
+bool runSetup(Workload* w, QString* error)
+{
+    QWebSocket sock;
+    if (!connectBlocking(sock, w->url)) {
+        *error = QStringLiteral("cannot connect to %1").arg(w->url.toString());
+        return false;
+    }
+    QHash<QString, QJsonValue> vars;
+    for (const QJsonValue& v : qAsConst(w->setup)) {
+        const QJsonObject step = v.toObject();
+        const QJsonObject params = substitute(step.value("params").toObject(), vars).toObject();
+        const QJsonObject reply = callOnce(sock, step.value("method").toString(), params);
+        if (!reply.contains("result")) {
+            *error = QStringLiteral("setup %1 failed: %2").arg(step.value("method").toString(),
+                QString::fromUtf8(QJsonDocument(reply).toJson(QJsonDocument::Compact)));
+            return false;
+        }
+        const QJsonValue value = pick(reply.value("result"), step.value("pick").toString());
+        if (step.contains("as")) vars.insert(step.value("as").toString(), value);
+    }
+    for (RequestSpec& s : w->subscriptions) s.params = substitute(s.params, vars).toObject();
+    for (RequestSpec& r : w->requests) r.params = substitute(r.params, vars).toObject();
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser p;
+    p.addHelpOption();
+    QCommandLineOption workloadOpt({"w", "workload"}, "workload JSON file", "path");
+    QCommandLineOption urlOpt({"u", "url"}, "override the workload's ws url", "url");
+    QCommandLineOption clientsOpt({"c", "clients"}, "override the number of concurrent clients", "count");
+    QCommandLineOption durationOpt({"d", "duration"}, "override the run time in seconds", "seconds");
+    QCommandLineOption outputOpt({"o", "output"}, "also append the JSON lines to this file", "path");
+    p.addOption(workloadOpt); p.addOption(urlOpt); p.addOption(clientsOpt); p.addOption(durationOpt); p.addOption(outputOpt);
+    p.process(app);
+
+    Workload workload;
+    QString error;
+    if (!p.isSet(workloadOpt) || !loadWorkload(p.value(workloadOpt), &workload, &error)) {
+        fprintf(stderr, "error: %s\n", error.isEmpty() ? "--workload is required" : qPrintable(error));
+        return 2;
+    }
+    if (p.isSet(urlOpt)) workload.url = QUrl(p.value(urlOpt));
+    if (p.isSet(clientsOpt)) workload.clients = std::max(1, p.value(clientsOpt).toInt());
+    if (p.isSet(durationOpt)) workload.durationSec = std::max(1, p.value(durationOpt).toInt());
+    if (!runSetup(&workload, &error)) {
+        fprintf(stderr, "error: %s\n", qPrintable(error));
+        return 2;
+    }
+
+    QFile output(p.value(outputOpt));
+    if (p.isSet(outputOpt) && !output.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        fprintf(stderr, "error: cannot open %s\n", qPrintable(output.fileName()));
+        return 2;
+    }
+    auto emitLine = [&](const QJsonObject& o) {
+        const QByteArray line = QJsonDocument(o).toJson(QJsonDocument::Compact);
+        printf("%s\n", line.constData());
+        fflush(stdout);
+        if (output.isOpen()) {
+            output.write(line + '\n');
+            output.flush();
+        }
+    };
+
+    // A separate connection polls stats once per interval for the server's
+    // memory, handle count and queue depths.
+    QWebSocket monitor;
+    if (!connectBlocking(monitor, workload.url)) {
+        fprintf(stderr, "error: cannot connect to %s\n", qPrintable(workload.url.toString()));
+        return 2;
+    }
+    auto serverSample = [&] {
+        const QJsonObject stats = callOnce(monitor, QStringLiteral("stats"), {}).value("result").toObject();
+        return QJsonObject{{"rssKb", stats.value("rssKb")},
+                           {"handles", stats.value("handles")},
+                           {"clients", stats.value("clients")},
+                           {"jobsQueued", stats.value("jobs").toObject().value("queued")},
+                           {"outboundDisconnects", stats.value("outbound").toObject().value("disconnects")}};
+    };
+    const QJsonObject startSample = serverSample();
+
+    QElapsedTimer clock;
+    clock.start();
+    Totals totals;
+    std::vector<std::unique_ptr<LoadClient>> clients;
+    for (int i = 0; i < workload.clients; ++i) {
+        clients.push_back(std::make_unique<LoadClient>(workload, totals, clock));
+        clients.back()->open();
+    }
+
+    QTimer tick;
+    tick.setTimerType(Qt::PreciseTimer);
+    tick.setInterval(1);
+    QObject::connect(&tick, &QTimer::timeout, [&] {
+        for (auto& c : clients) c->tick();
+    });
+    QTimer expiry;
+    expiry.setInterval(1000);
+    QObject::connect(&expiry, &QTimer::timeout, [&] {
+        for (auto& c : clients) c->expire();
+    });
+    QTimer report;
+    report.setInterval(workload.reportIntervalSec * 1000);
+    QObject::connect(&report, &QTimer::timeout, [&] {
+        emitLine({{"type", "interval"},
+                  {"elapsedSec", clock.elapsed() / 1000.0},
+                  {"counters", countersJson(totals.interval)},
+                  {"latency", latencyJson(totals.intervalLatency)},
+                  {"server", serverSample()}});
+        totals.interval = {};
+        totals.intervalLatency.clear();
+    });
+    QTimer::singleShot(workload.durationSec * 1000, &app, [&] {
+        tick.stop();
+        report.stop();
+        for (auto& c : clients) c->expire();
+        const QJsonObject endSample = serverSample();
+        const double hours = clock.elapsed() / 3.6e6;
+        const double rssDelta = endSample.value("rssKb").toDouble() - startSample.value("rssKb").toDouble();
+        emitLine({{"type", "summary"},
+                  {"clients", workload.clients},
+                  {"elapsedSec", clock.elapsed() / 1000.0},
+                  {"counters", countersJson(totals.total)},
+                  {"latency", latencyJson(totals.totalLatency)},
+                  {"serverStart", startSample},
+                  {"serverEnd", endSample},
+                  {"rssGrowthKb", rssDelta},
+                  {"rssGrowthKbPerHour", hours > 0 ? rssDelta / hours : 0.0}});
+        for (auto& c : clients) c->close();
+        app.quit();
+    });
+    tick.start();
+    expiry.start();
+    report.start();
+    return app.exec();
+}
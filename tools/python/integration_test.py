@@ -5,6 +5,7 @@ import signal
 import subprocess
 import sys
 import time
+import urllib.request
 from typing import Any
 
 from qab_sdk import QmlAgentBridgeClient
@@ -53,12 +54,167 @@ def main() -> int:
             # Inspect
             info = client.inspect(btn["objectId"])
             assert_true(info.get("objectName") == "helloButton", "inspect mismatch")
+            values = client.inspect_values(btn["objectId"])
+            assert_true(values.get("schemaId") == info.get("schemaId"), "inspect schemaId mismatch")
+            assert_true(set(values["properties"]) == set(info.get("properties", {})), "value-only inspect properties mismatch")
+            props = info.get("properties", {})
+            assert_true(str(props.get("parent", "")).startswith("qobj:"), f"parent not an object id: {props.get('parent')}")
+            rect = props.get("childrenRect", {})
+            assert_true(isinstance(rect, dict) and {"x", "y", "width", "height"} <= set(rect), f"childrenRect not converted: {rect}")
+
+            # Object index: find_by_type and index counters (example app enables the index)
+            buttons = client.find_by_type(btn["type"])
+            assert_true(any(m["objectId"] == btn["objectId"] for m in buttons), "find_by_type missed helloButton")
+            index_stats = client.stats().get("index", {})
+            assert_true(index_stats.get("enabled") is True and index_stats.get("lookups", 0) >= 1, "index stats missing")
+            # Roots are not matched, as with findChildren
+            win = roots[0]
+            client.set_property(win["objectId"], "objectName", "helloButton")
+            assert_true([m["objectId"] for m in client.find_by_name("helloButton")] == [btn["objectId"]],
+                        "find_by_name matched a root")
+            assert_true(all(m["objectId"] != win["objectId"] for m in client.find_by_type(win["type"])),
+                        "find_by_type matched a root")
+            client.set_property(win["objectId"], "objectName", "")
+            # A named object created late, reparented and destroyed is tracked without walks
+            emitter = client.first_by_name("customEmitter")
+            client.evaluate(emitter["objectId"], "Qt.createQmlObject('import QtQuick; Item { objectName: \"movedItem\" }', customEmitter)")
+            moved = client.find_by_name("movedItem")
+            assert_true(len(moved) == 1, f"created object not indexed: {moved}")
+            client.evaluate(emitter["objectId"], "customEmitter.children[0].parent = helloButton")
+            again = client.find_by_name("movedItem")
+            assert_true([m["objectId"] for m in again] == [moved[0]["objectId"]], f"reparented object lost or duplicated: {again}")
+            client.evaluate(emitter["objectId"], "helloButton.children[helloButton.children.length - 1].destroy()")
+            time.sleep(0.1)
+            assert_true(client.find_by_name("movedItem") == [], "destroyed object still indexed")
+            assert_true(client.stats()["index"].get("builds") == 1, "index was rebuilt")
+
+            # Selector query: one walk, projected fields, cursor paging
+            found = client.query("Column > Button#helloButton", fields=["objectName", "text"])
+            assert_true([m["objectId"] for m in found["matches"]] == [btn["objectId"]], "query did not find helloButton")
+            assert_true(found["matches"][0].get("text") == "Hello" and found["done"] is True, "query projection mismatch")
+            page = client.query("Column > *", limit=1)
+            assert_true(len(page["matches"]) == 1 and page.get("cursor"), "query limit did not return a cursor")
+            assert_true(len(client.query_all("Column > *", page_size=1)) >= 4, "query cursor paging lost matches")
+            bad = client.batch([("query", {"selector": "Button["})])
+            assert_true(bad[0].get("error", {}).get("code") == "bad_request", "bad selector not rejected")
+
+            # Handles: bulk resolve, unknown ids report alive=false
+            resolved = client.resolve([btn["objectId"], "qobj:999999999"])
+            assert_true(resolved[0].get("alive") is True and resolved[0].get("objectName") == "helloButton",
+                        "resolve of live handle failed")
+            assert_true(resolved[1].get("alive") is False, "resolve of unknown handle reported alive")
+
+            # Batch: several calls in one round trip, per-item errors
+            replies = client.batch([("list_roots", None),
+                                    ("inspect", {"objectId": "qobj:0"}),
+                                    ("find_by_name", {"name": "helloButton"})])
+            assert_true(len(replies) == 3, "batch reply count mismatch")
+            assert_true("result" in replies[0] and "error" in replies[1] and "result" in replies[2],
+                        "batch per-item results unexpected")
+            stopped = client.batch([("inspect", {"objectId": "qobj:0"}), ("list_roots", None)], stop_on_error=True)
+            assert_true(stopped[1].get("error", {}).get("code") == "skipped", "batch stopOnError did not skip")
 
             # Call method with args (TextField.select)
             tf = client.first_by_name("nameField")
             assert_true(tf is not None, "nameField not found")
+
+            # Coalesced property events: three writes in one turn, one event with the final value
+            csub = client.subscribe_property(tf["objectId"], "text", coalesce="turn")
+            client.evaluate(tf["objectId"], "nameField.text = 'a'; nameField.text = 'ab'; nameField.text = 'abc'")
+            cevt = client.wait_event(csub)
+            assert_true(cevt is not None and cevt.get("value") == "abc" and cevt.get("dropped") == 2,
+                        f"coalesced property event unexpected: {cevt}")
+            client.unsubscribe(csub)
+            client.set_property(tf["objectId"], "text", "")
+
+            # Grouped object property: the notify signal comes from the anchors group, not the item
+            asub = client.subscribe_property(tf["objectId"], "anchors.margins")
+            client.set_property(tf["objectId"], "anchors.margins", 3)
+            aevt = client.wait_event(asub)
+            assert_true(aevt is not None and aevt.get("name") == "anchors.margins" and aevt.get("value") == 3
+                        and aevt.get("objectId") == tf["objectId"], f"anchors.margins event unexpected: {aevt}")
+            client.unsubscribe(asub)
+            client.set_property(tf["objectId"], "anchors.margins", 0)
             result: Any = client.call_method(tf["objectId"], "select", 0, 0)
             # no strong assertion on result value; ensure call returned without exception
+            # select(int, int) is invoked directly; a repeated evaluate reuses its compiled expression
+            calls = client.stats().get("calls", {})
+            assert_true(calls.get("direct", 0) >= 1, f"call_method did not take the direct path: {calls}")
+            for _ in range(3):
+                assert_true(client.evaluate(tf["objectId"], "nameField.width * 2") == 400, "evaluate result unexpected")
+            after = client.stats().get("calls", {})
+            assert_true(after.get("expressionCompiles", 0) - calls.get("expressionCompiles", 0) == 1,
+                        f"evaluate was recompiled: {calls} -> {after}")
+
+            # wait_for: immediate, parked until a write, and timed out
+            assert_true(client.wait_for(tf["objectId"], "nameField.width > 0").get("satisfied") is True, "wait_for immediate failed")
+            wait_id = client.send_request("wait_for", {"objectId": tf["objectId"], "expression": "nameField.text === 'ready'"})
+            client.set_property(tf["objectId"], "text", "ready")
+            waited = client.wait_reply(wait_id, "wait_for")
+            assert_true(waited.get("satisfied") is True and waited.get("value") is True, f"wait_for unexpected: {waited}")
+            client.set_property(tf["objectId"], "text", "")
+            timed_out = client.wait_for(tf["objectId"], "nameField.text === 'never'", timeout_ms=100)
+            assert_true(timed_out.get("satisfied") is False and client.stats().get("waiters") == 0, f"wait_for timeout unexpected: {timed_out}")
+
+            # set_properties: typed, all-or-nothing writes across objects
+            tb = client.first_by_name("toggleBox")
+            written = client.set_properties(writes=[
+                {"objectId": tf["objectId"], "name": "text", "value": "multi"},
+                {"objectId": tf["objectId"], "name": "horizontalAlignment", "value": "AlignHCenter"},
+                {"objectId": tb["objectId"], "name": "checked", "value": False},
+            ])
+            assert_true(written == 3, f"set_properties wrote {written}")
+            assert_true(client.evaluate(tf["objectId"], "nameField.text + (nameField.horizontalAlignment === TextInput.AlignHCenter) + toggle.checked")
+                        == "multitruefalse", "set_properties values not applied")
+            try:
+                client.set_properties(tf["objectId"], {"text": "partial", "width": "wide"})
+                raise AssertionError("set_properties accepted a string for a number")
+            except RuntimeError as e:
+                assert_true("width" in str(e), f"set_properties error does not name the property: {e}")
+            assert_true(client.evaluate(tf["objectId"], "nameField.text") == "multi", "rejected set_properties wrote something")
+            client.set_properties(tf["objectId"], {"text": "", "horizontalAlignment": "AlignLeft"})
+            client.set_property(tb["objectId"], "checked", True)
+
+            # Tree snapshot and deltas: a dynamic item is added, renamed and destroyed
+            snap = client.snapshot_tree()
+            def tree_names(nodes):
+                for n in nodes:
+                    yield n.get("name")
+                    yield from tree_names(n.get("children", []))
+            assert_true("nameField" in set(tree_names(snap["roots"])), "snapshot_tree missing nameField")
+            tsub = client.subscribe_tree()
+            client.evaluate(tf["objectId"], "Qt.createQmlObject('import QtQuick; Item { objectName: \"dynItem\" }', nameField.parent)")
+            tevt = client.wait_event(tsub["subscriptionId"])
+            added = [c for c in (tevt or {}).get("changes", []) if c["op"] == "added" and c["node"].get("name") == "dynItem"]
+            assert_true(len(added) == 1 and added[0]["seq"] > snap["seq"], f"tree add delta missing: {tevt}")
+            client.evaluate(tf["objectId"], "nameField.parent.children[nameField.parent.children.length - 1].destroy()")
+            tevt = client.wait_event(tsub["subscriptionId"])
+            removed = [c for c in (tevt or {}).get("changes", []) if c["op"] == "removed"]
+            assert_true(removed and removed[0]["objectId"] == added[0]["node"]["id"], f"tree remove delta missing: {tevt}")
+            client.unsubscribe(tsub["subscriptionId"])
+            resync = client.subscribe_tree(since_seq=snap["seq"])
+            assert_true(resync.get("complete") is True and [c["op"] for c in resync["changes"]][-2:] == ["added", "removed"],
+                        f"tree resync unexpected: {resync}")
+            client.unsubscribe(resync["subscriptionId"])
+
+            # Frame capture: a PNG of the window, then a keyframe and a tile delta
+            if "capture" in hello.get("capabilities", []):
+                shot = client.capture()
+                assert_true(shot["data"].startswith(b"\x89PNG") and shot["width"] > 0, "capture is not a PNG")
+                part = client.capture(tf["objectId"])
+                assert_true(0 < part["width"] <= shot["width"], f"item capture not cropped: {part['width']}")
+                fsub = client.subscribe_frames(max_fps=30)
+                fevt = client.wait_event(fsub["subscriptionId"])
+                assert_true(fevt is not None and fevt.get("keyframe") is True and len(fevt["tiles"]) == 1
+                            and fevt["tiles"][0]["width"] == fsub["width"], f"frame keyframe missing: {fevt}")
+                client.set_property(tf["objectId"], "text", "frame")
+                fevt = client.wait_event(fsub["subscriptionId"])
+                assert_true(fevt is not None and not fevt.get("keyframe") and fevt["tiles"]
+                            and fevt["seq"] == 2, f"frame delta missing: {fevt}")
+                delta_px = sum(t["width"] * t["height"] for t in fevt["tiles"])
+                assert_true(delta_px < fsub["width"] * fsub["height"], "frame delta covers the whole window")
+                client.unsubscribe(fsub["subscriptionId"])
+                client.set_property(tf["objectId"], "text", "")
 
             # Property change + event value
             toggle = client.first_by_name("toggleBox")
@@ -133,11 +289,16 @@ def main() -> int:
                 # Subscribe to ping()
                 ws_send(ws, "s_custom", "subscribe_signal", {"objectId": emitter["objectId"], "signal": "ping()"})
                 _ = ws_recv_until_id(ws, "s_custom")
+                # message(string) carries its argument in the event
+                ws_send(ws, "s_message", "subscribe_signal", {"objectId": emitter["objectId"], "signal": "message"})
+                sm = ws_recv_until_id(ws, "s_message").get("result", {})
+                assert_true(sm.get("parameters") == ["text"], f"message() parameters not reported: {sm}")
                 # Trigger via button click: call onClicked handler via method name 'clicked' or expression fallback
                 ws_send(ws, "click1", "call_method", {"objectId": btn["objectId"], "name": "clicked", "args": []})
                 deadline3 = time.time() + 5.0
                 got_ping = False
-                while time.time() < deadline3:
+                message_args = None
+                while time.time() < deadline3 and not (got_ping and message_args is not None):
                     try:
                         ws.settimeout(0.5)
                         m3 = ws.recv()
@@ -147,9 +308,12 @@ def main() -> int:
                     if d3.get("method") == "event":
                         p3 = d3.get("params", {})
                         if p3.get("kind") == "signal" and p3.get("name").startswith("ping"):
+                            assert_true("args" not in p3, "ping() event should carry no args")
                             got_ping = True
-                            break
+                        elif p3.get("kind") == "signal" and p3.get("name").startswith("message"):
+                            message_args = p3.get("args")
                 assert_true(got_ping, "did not receive customEmitter ping event")
+                assert_true(message_args == ["from button"], f"message() args not captured: {message_args}")
 
                 # Model info and fetch snapshot
                 fm = client.first_by_name("fruitsModel")
@@ -162,6 +326,58 @@ def main() -> int:
                 mf = ws_recv_until_id(ws, "mf")
                 items = mf.get("result", {}).get("items", [])
                 assert_true(len(items) == 3 and items[0]["name"] == "Apple" and items[1]["color"] == "yellow", "model snapshot unexpected")
+                jobs = client.stats().get("jobs", {})
+                assert_true(jobs.get("completed", 0) >= 1 and jobs.get("queued") == 0, f"model_fetch did not run as a job: {jobs}")
+                # A batch runs as a job too; its deferred items finish before the one reply frame
+                mixed = client.batch([("model_fetch", {"objectId": fm["objectId"], "start": 0, "count": 2, "roles": ["name"]}),
+                                      ("list_roots", None)])
+                assert_true(len(mixed) == 2 and mixed[0].get("result", {}).get("items", [{}])[0].get("name") == "Apple"
+                            and "result" in mixed[1], f"batch with a deferred item unexpected: {mixed}")
+                assert_true(client.cancel("no-such-request") is False, "cancel of an unknown request succeeded")
+                stats = client.stats()
+                assert_true("rssKb" in stats and (stats["rssKb"] is None or stats["rssKb"] > 0), "stats rssKb missing")
+                outbound = stats.get("outbound", {})
+                me = [c for c in outbound.get("clients", []) if c.get("self")]
+                assert_true(outbound.get("policy") == "drop_oldest" and len(me) == 1 and me[0]["queuedBytes"] == 0,
+                            f"outbound stats unexpected: {outbound}")
+                metrics = client.stats().get("metrics", {})
+                if metrics.get("enabled"):
+                    fetch_metrics = metrics.get("methods", {}).get("model_fetch", {})
+                    assert_true(fetch_metrics.get("execute", {}).get("count", 0) >= 1 and metrics.get("bytesIn", 0) > 0,
+                                f"model_fetch not in metrics: {metrics}")
+                    with urllib.request.urlopen("http://127.0.0.1:7778/metrics", timeout=5) as resp:
+                        text = resp.read().decode()
+                    assert_true('qab_rpc_duration_seconds_count{method="model_fetch",phase="execute"}' in text,
+                                "prometheus endpoint missing model_fetch")
+
+                # Streaming export: columnar chunks, names once
+                chunks = list(client.model_export(fm["objectId"], roles=["name", "color"], chunk_size=2))
+                assert_true(len(chunks) == 2 and chunks[-1].get("done") is True, "model_export chunking unexpected")
+                names = chunks[0]["values"][0] + chunks[1]["values"][0]
+                assert_true(names == ["Apple", "Banana", "Grape"], "model_export values unexpected")
+                tail = list(client.model_export(fm["objectId"], start=2))
+                assert_true(tail[0]["start"] == 2 and tail[0]["count"] == 1, "model_export resume offset ignored")
+
+                # Model subscription: a burst in one turn arrives as one event with merged ranges
+                msub = client.subscribe_model(fm["objectId"], roles=["name"], values=True)["subscriptionId"]
+                client.evaluate(fm["objectId"], "fruitsModel.append({name: 'Kiwi', color: 'green'}); fruitsModel.append({name: 'Lime', color: 'green'})")
+                mevt = client.wait_event(msub)
+                assert_true(mevt is not None and mevt.get("kind") == "model", "no model event")
+                assert_true(mevt["changes"] == [{"op": "insert", "start": 3, "end": 4, "values": [["Kiwi", "Lime"]]}],
+                            f"model insert burst not coalesced: {mevt.get('changes')}")
+                client.evaluate(fm["objectId"], "fruitsModel.remove(3, 2)")
+                mevt = client.wait_event(msub)
+                assert_true(mevt is not None and mevt["changes"][0].get("op") == "remove" and mevt["rowCount"] == 3, "model remove event missing")
+                # A data change followed by an insert above it: the values are those of the changed row
+                client.evaluate(fm["objectId"], "fruitsModel.setProperty(1, 'name', 'Blueberry'); fruitsModel.insert(0, {name: 'Cherry', color: 'red'})")
+                mevt = client.wait_event(msub)
+                assert_true(mevt is not None and mevt["changes"] == [
+                    {"op": "data", "start": 1, "end": 1, "values": [["Blueberry"]]},
+                    {"op": "insert", "start": 0, "end": 0, "values": [["Cherry"]]}],
+                    f"model data before a shift read the wrong row: {mevt and mevt.get('changes')}")
+                client.evaluate(fm["objectId"], "fruitsModel.remove(0); fruitsModel.setProperty(1, 'name', 'Banana')")
+                client.wait_event(msub)
+                client.unsubscribe(msub)
 
                 # Test signal snapshot on CheckBox checkedChanged(bool)
                 cb = client.first_by_name("toggleBox")
@@ -197,6 +413,19 @@ def main() -> int:
                 except Exception:
                     pass
 
+        # Same dispatcher over the local socket, without WebSocket framing
+        if sys.platform != "win32":
+            with QmlAgentBridgeClient(local="qab-minimal") as local:
+                assert_true(local.hello().get("protocol") == "qml-agent-bridge", "local hello mismatch")
+                local_btn = local.first_by_name("helloButton")
+                assert_true(local_btn is not None and local_btn["objectId"] == btn["objectId"],
+                            "local socket sees different object ids")
+                local_stats = local.stats()
+                assert_true(local_stats.get("localServer", "").endswith("qab-minimal"), "stats localServer missing")
+                sub = local.subscribe_signal(local_btn["objectId"], "clicked")
+                local.call_method(local_btn["objectId"], "clicked")
+                assert_true(local.wait_event(sub) is not None, "no event over the local socket")
+
         print("integration_test: OK")
         return 0
     finally:
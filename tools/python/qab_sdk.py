@@ -1,22 +1,106 @@
+import base64
 import json
+import os
+import socket
+import struct
+import tempfile
 import time
-from typing import Any, Dict, List, Optional
+from collections import deque
+from typing import Any, Dict, Iterator, List, Optional, Sequence, Tuple
 
 try:
     import websocket  # type: ignore
 except ImportError as e:
     raise RuntimeError("Please install websocket-client (see tools/python/requirements.txt)") from e
 
+try:
+    import cbor2  # type: ignore
+except ImportError:  # only needed for encoding="cbor"
+    cbor2 = None
+
+
+class LocalSocket:
+    """The app's local socket (InspectorServer::listenLocal), with the subset of the
+    websocket-client API the client uses.
+
+    Frames are a 4-byte big-endian payload length, b"J" (JSON) or b"C" (CBOR), then the payload.
+    """
+
+    _HEADER = struct.Struct(">IB")
+
+    def __init__(self, name: str) -> None:
+        # Relative names live in the temp directory, as QLocalServer places them.
+        path = name if os.path.isabs(name) else os.path.join(tempfile.gettempdir(), name)
+        self._sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self._sock.connect(path)
+        self._input = bytearray()
+
+    def send(self, text: str) -> None:
+        self._send_frame(b"J", text.encode("utf-8"))
+
+    def send_binary(self, data: bytes) -> None:
+        self._send_frame(b"C", data)
+
+    def _send_frame(self, kind: bytes, payload: bytes) -> None:
+        self._sock.sendall(struct.pack(">I", len(payload)) + kind + payload)
+
+    def recv(self) -> Any:
+        """str for JSON frames, bytes for CBOR ones."""
+        while True:
+            if len(self._input) >= self._HEADER.size:
+                size, kind = self._HEADER.unpack_from(self._input)
+                end = self._HEADER.size + size
+                if len(self._input) >= end:
+                    payload = bytes(self._input[self._HEADER.size:end])
+                    del self._input[:end]
+                    return payload if kind == ord("C") else payload.decode("utf-8")
+            try:
+                chunk = self._sock.recv(1 << 16)
+            except socket.timeout as e:
+                raise websocket.WebSocketTimeoutException(str(e)) from e
+            if not chunk:
+                raise websocket.WebSocketConnectionClosedException("local socket closed")
+            self._input += chunk
+
+    def settimeout(self, timeout: Optional[float]) -> None:
+        self._sock.settimeout(timeout)
+
+    def gettimeout(self) -> Optional[float]:
+        return self._sock.gettimeout()
+
+    def close(self) -> None:
+        self._sock.close()
+
 
 class QmlAgentBridgeClient:
-    def __init__(self, url: str = "ws://127.0.0.1:7777") -> None:
+    def __init__(self, url: str = "ws://127.0.0.1:7777", encoding: str = "json",
+                 local: Optional[str] = None) -> None:
+        """encoding: "json" (text frames) or "cbor" (binary frames, needs the cbor2 package).
+
+        local: name or path of the app's local socket; used instead of url, skipping WebSocket framing.
+        """
         self._url = url
-        self._ws: Optional["websocket.WebSocket"] = None
+        self._local = local
+        self._encoding = encoding
+        self._binary = False
+        self._schemas: Dict[str, Dict[str, Any]] = {}
+        self._events: "deque[Dict[str, Any]]" = deque()  # events read while waiting for replies
+        self._replies: Dict[str, Dict[str, Any]] = {}  # replies to other requests read while waiting
+        # events_dropped notices: the server dropped or coalesced events while this client lagged
+        self.dropped: List[Dict[str, Any]] = []
+        self._next_id = 1
+        self._ws: Any = None  # websocket.WebSocket or LocalSocket
 
     def connect(self) -> None:
         if self._ws is not None:
             return
-        self._ws = websocket.create_connection(self._url)
+        self._ws = LocalSocket(self._local) if self._local else websocket.create_connection(self._url)
+        if self._encoding != "json":
+            if cbor2 is None:
+                raise RuntimeError("encoding=cbor needs the cbor2 package (see tools/python/requirements.txt)")
+            # The hello reply is still JSON; frames after it use the negotiated encoding.
+            self._request("hello", {"encoding": self._encoding})
+            self._binary = True
 
     def close(self) -> None:
         if self._ws is not None:
@@ -32,21 +116,74 @@ class QmlAgentBridgeClient:
     def __exit__(self, exc_type, exc, tb) -> None:
         self.close()
 
+    def _send(self, payload: Any) -> None:
+        assert self._ws is not None, "Client not connected"
+        if self._binary:
+            self._ws.send_binary(cbor2.dumps(payload))
+        else:
+            self._ws.send(json.dumps(payload))
+
+    def _recv(self) -> Any:
+        assert self._ws is not None, "Client not connected"
+        msg = self._ws.recv()
+        if isinstance(msg, bytes) and self._binary:
+            return cbor2.loads(msg)
+        return json.loads(msg)
+
     def _request(self, method: str, params: Optional[Dict[str, Any]] = None) -> Dict[str, Any]:
+        return self.wait_reply(self.send_request(method, params), method)
+
+    def send_request(self, method: str, params: Optional[Dict[str, Any]] = None) -> str:
+        """Send a request without waiting; returns its id for wait_reply() or cancel()."""
         assert self._ws is not None, "Client not connected"
-        req_id = str(int(time.time() * 1000))
+        req_id = str(self._next_id)
+        self._next_id += 1
         payload: Dict[str, Any] = {"id": req_id, "method": method}
         if params is not None:
             payload["params"] = params
-        self._ws.send(json.dumps(payload))
-        while True:
-            msg = self._ws.recv()
-            data = json.loads(msg)
-            if isinstance(data, dict) and data.get("id") == req_id:
-                if "error" in data:
-                    raise RuntimeError(f"{method} error: {data['error']}")
-                return data["result"] if "result" in data else data
-            # ignore events here
+        self._send(payload)
+        return req_id
+
+    def wait_reply(self, req_id: str, method: str = "request") -> Dict[str, Any]:
+        data = self._replies.pop(req_id, None)
+        while data is None:
+            msg = self._recv()
+            if not isinstance(msg, dict):
+                continue
+            if msg.get("method") == "event":
+                self._events.append(msg.get("params", {}))
+            elif msg.get("method") == "events_dropped":
+                self.dropped.append(msg.get("params", {}))
+            elif msg.get("id") == req_id:
+                data = msg
+            elif "id" in msg:
+                self._replies[msg["id"]] = msg
+        if "error" in data:
+            raise RuntimeError(f"{method} error: {data['error']}")
+        return data["result"] if "result" in data else data
+
+    def cancel(self, req_id: str) -> bool:
+        """Cancel a request still waiting on the server's job scheduler; it then fails with "cancelled"."""
+        try:
+            self._request("cancel", {"requestId": req_id})
+            return True
+        except RuntimeError:
+            return False
+
+    def batch(self, calls: Sequence[Tuple[str, Optional[Dict[str, Any]]]], stop_on_error: bool = False) -> List[Dict[str, Any]]:
+        """Run several calls in one round trip.
+
+        Returns one reply per call, in order; each has either "result" or "error".
+        With stop_on_error, calls after the first failure are answered with a "skipped" error.
+        """
+        requests: List[Dict[str, Any]] = []
+        for i, (method, params) in enumerate(calls):
+            req: Dict[str, Any] = {"id": str(i), "method": method}
+            if params is not None:
+                req["params"] = params
+            requests.append(req)
+        res = self._request("batch", {"requests": requests, "stopOnError": stop_on_error})
+        return res.get("replies", [])
 
     # Convenience API
     def hello(self) -> Dict[str, Any]:
@@ -60,17 +197,79 @@ class QmlAgentBridgeClient:
         res = self._request("find_by_name", {"name": name})
         return res.get("matches", [])
 
+    def find_by_type(self, type_name: str) -> List[Dict[str, Any]]:
+        res = self._request("find_by_type", {"type": type_name})
+        return res.get("matches", [])
+
+    def stats(self) -> Dict[str, Any]:
+        return self._request("stats")
+
+    def query(self, selector: str, fields: Optional[Sequence[str]] = None, root: Optional[str] = None,
+              limit: Optional[int] = None, cursor: Optional[str] = None) -> Dict[str, Any]:
+        """One page of selector matches: { matches, done, visited, cursor? }."""
+        params: Dict[str, Any] = {"cursor": cursor} if cursor else {"selector": selector}
+        if fields and not cursor:
+            params["fields"] = list(fields)
+        if root and not cursor:
+            params["root"] = root
+        if limit is not None:
+            params["limit"] = limit
+        return self._request("query", params)
+
+    def query_all(self, selector: str, fields: Optional[Sequence[str]] = None, root: Optional[str] = None,
+                  page_size: int = 500) -> List[Dict[str, Any]]:
+        """All matches of a selector, following cursors page by page."""
+        page = self.query(selector, fields, root, page_size)
+        matches = list(page.get("matches", []))
+        while not page.get("done", True):
+            page = self.query(selector, limit=page_size, cursor=page["cursor"])
+            matches.extend(page.get("matches", []))
+        return matches
+
     def inspect(self, object_id: str) -> Dict[str, Any]:
         return self._request("inspect", {"objectId": object_id})
 
+    def inspect_values(self, object_id: str) -> Dict[str, Any]:
+        """Value-only inspect; properties come back as a dict using the cached class schema."""
+        res = self._request("inspect", {"objectId": object_id, "mode": "values"})
+        schema = self.get_schema(res["schemaId"])
+        res["properties"] = {p["name"]: v for p, v in zip(schema.get("properties", []), res.get("values", []))}
+        return res
+
+    def get_schema(self, schema_id: str) -> Dict[str, Any]:
+        if schema_id not in self._schemas:
+            self._schemas[schema_id] = self._request("get_schema", {"schemaId": schema_id})
+        return self._schemas[schema_id]
+
     def list_children(self, object_id: str) -> List[Dict[str, Any]]:
         res = self._request("list_children", {"objectId": object_id})
         return res.get("children", [])
 
+    def resolve(self, object_ids: Sequence[str]) -> List[Dict[str, Any]]:
+        res = self._request("resolve", {"objectIds": list(object_ids)})
+        return res.get("objects", [])
+
     def set_property(self, object_id: str, name: str, value: Any) -> bool:
         res = self._request("set_property", {"objectId": object_id, "name": name, "value": value})
         return bool(res.get("ok", False))
 
+    def set_properties(self, object_id: Optional[str] = None, values: Optional[Dict[str, Any]] = None,
+                       writes: Optional[Sequence[Dict[str, Any]]] = None) -> int:
+        """Write many properties at once, all or nothing; returns how many were written.
+
+        values: { name: value } on object_id; writes: [{ objectId, name, value }] on any objects.
+        Values are converted to each property's type: {x, y} or [x, y] points, rects, "#rrggbb"
+        colors, enum keys by name, object ids for object properties.
+        """
+        params: Dict[str, Any] = {}
+        if values is not None:
+            params["objectId"] = object_id
+            params["values"] = values
+        if writes is not None:
+            params["writes"] = list(writes)
+        res = self._request("set_properties", params)
+        return int(res.get("written", 0))
+
     def call_method(self, object_id: str, name: str, *args: Any) -> Any:
         res = self._request("call_method", {"objectId": object_id, "name": name, "args": list(args)})
         return res.get("result")
@@ -79,19 +278,141 @@ class QmlAgentBridgeClient:
         res = self._request("evaluate", {"objectId": object_id, "expression": expression})
         return res.get("result")
 
-    def subscribe_signal(self, object_id: str, signal: str) -> str:
-        res = self._request("subscribe_signal", {"objectId": object_id, "signal": signal})
+    def wait_for(self, object_id: str, expression: str, timeout_ms: int = 10000) -> Dict[str, Any]:
+        """Blocks until expression is truthy on the server, or timeout_ms passes; see result["satisfied"]."""
+        return self._request("wait_for", {"objectId": object_id, "expression": expression, "timeoutMs": timeout_ms})
+
+    def subscribe_signal(self, object_id: str, signal: str, args: bool = True, **rate: Any) -> str:
+        """Events carry the signal's arguments as "args" unless args=False.
+
+        rate: coalesce="turn"|"frame", minIntervalMs=..., maxRate=... (events per second)."""
+        res = self._request("subscribe_signal", {"objectId": object_id, "signal": signal, "args": args, **rate})
         return res.get("subscriptionId")
 
-    def subscribe_property(self, object_id: str, name: str) -> str:
-        res = self._request("subscribe_property", {"objectId": object_id, "name": name})
+    def subscribe_property(self, object_id: str, name: str, **rate: Any) -> str:
+        """rate: coalesce="turn"|"frame", minIntervalMs=..., maxRate=... (events per second)."""
+        res = self._request("subscribe_property", {"objectId": object_id, "name": name, **rate})
         return res.get("subscriptionId")
 
+    def subscribe_model(self, object_id: str, roles: Optional[Sequence[str]] = None,
+                        values: bool = False) -> Dict[str, Any]:
+        """Subscribe to coalesced model changes; returns { subscriptionId, rowCount, columnCount, roles }."""
+        params: Dict[str, Any] = {"objectId": object_id, "values": values}
+        if roles is not None:
+            params["roles"] = list(roles)
+        return self._request("subscribe_model", params)
+
+    def wait_event(self, subscription_id: str, timeout_s: float = 5.0) -> Optional[Dict[str, Any]]:
+        """Next event params for a subscription, or None on timeout."""
+        assert self._ws is not None, "Client not connected"
+        for i, evt in enumerate(self._events):
+            if evt.get("subscriptionId") == subscription_id:
+                del self._events[i]
+                return evt
+        deadline = time.time() + timeout_s
+        old_timeout = self._ws.gettimeout()
+        try:
+            while time.time() < deadline:
+                self._ws.settimeout(max(0.01, deadline - time.time()))
+                try:
+                    data = self._recv()
+                except websocket.WebSocketTimeoutException:
+                    return None
+                if isinstance(data, dict) and data.get("method") == "event":
+                    evt = data.get("params", {})
+                    if evt.get("subscriptionId") == subscription_id:
+                        return evt
+                    self._events.append(evt)
+                elif isinstance(data, dict) and data.get("method") == "events_dropped":
+                    self.dropped.append(data.get("params", {}))
+        finally:
+            self._ws.settimeout(old_timeout)
+        return None
+
+    def snapshot_tree(self, root: Optional[str] = None, depth: Optional[int] = None,
+                      max_nodes: Optional[int] = None) -> Dict[str, Any]:
+        params: Dict[str, Any] = {}
+        if root is not None:
+            params["root"] = root
+        if depth is not None:
+            params["depth"] = depth
+        if max_nodes is not None:
+            params["maxNodes"] = max_nodes
+        return self._request("snapshot_tree", params)
+
+    def subscribe_tree(self, root: Optional[str] = None, since_seq: Optional[int] = None) -> Dict[str, Any]:
+        """Returns { subscriptionId, seq, complete?, changes? }; tree events arrive through wait_event."""
+        params: Dict[str, Any] = {}
+        if root is not None:
+            params["root"] = root
+        if since_seq is not None:
+            params["sinceSeq"] = since_seq
+        return self._request("subscribe_tree", params)
+
+    def capture(self, object_id: Optional[str] = None, scale: float = 1.0, encoding: str = "png",
+                quality: Optional[int] = None) -> Dict[str, Any]:
+        """Grab a window (or an item's part of it); returns { width, height, encoding, data: bytes }."""
+        params: Dict[str, Any] = {"scale": scale, "encoding": encoding}
+        if object_id is not None:
+            params["objectId"] = object_id
+        if quality is not None:
+            params["quality"] = quality
+        res = self._request("capture", params)
+        res["data"] = base64.b64decode(res.get("data", ""))
+        return res
+
+    def subscribe_frames(self, object_id: Optional[str] = None, max_fps: int = 10, scale: float = 1.0,
+                         encoding: str = "png", tile_size: int = 64) -> Dict[str, Any]:
+        """Returns { subscriptionId, objectId, width, height, maxFps }; frame events arrive through wait_event.
+
+        Each frame event carries changed tiles [{ x, y, width, height, data }] with base64 data;
+        the first one, and the first after a resize, is a keyframe covering the whole window.
+        """
+        params: Dict[str, Any] = {"maxFps": max_fps, "scale": scale, "encoding": encoding, "tileSize": tile_size}
+        if object_id is not None:
+            params["objectId"] = object_id
+        return self._request("subscribe_frames", params)
+
     def unsubscribe(self, subscription_id: str) -> bool:
         res = self._request("unsubscribe", {"subscriptionId": subscription_id})
         return bool(res.get("ok", False))
 
+    def model_export(self, object_id: str, roles: Optional[Sequence[str]] = None, start: int = 0,
+                     chunk_size: int = 1000) -> Iterator[Dict[str, Any]]:
+        """Stream a model as columnar chunks; yields each model_chunk's params.
+
+        The first chunk carries the export header under "export" (roles, rowCount, ...).
+        Consume the generator fully (or cancel) before issuing other calls on this client.
+        """
+        params: Dict[str, Any] = {"objectId": object_id, "start": start, "chunkSize": chunk_size}
+        if roles is not None:
+            params["roles"] = list(roles)
+        header = self._request("model_export", params)
+        first = True
+        while True:
+            data = self._recv()
+            if not isinstance(data, dict) or data.get("method") != "model_chunk":
+                continue
+            chunk = data.get("params", {})
+            if chunk.get("exportId") != header["exportId"]:
+                continue
+            if first:
+                chunk["export"] = header
+                first = False
+            yield chunk
+            if chunk.get("done"):
+                return
+
+    def model_export_cancel(self, export_id: str) -> int:
+        """Stop an export; returns the row to resume from."""
+        res = self._request("model_export_cancel", {"exportId": export_id})
+        return int(res.get("nextRow", 0))
+
     # Convenience
+    def inspect_many(self, object_ids: Sequence[str]) -> List[Optional[Dict[str, Any]]]:
+        replies = self.batch([("inspect", {"objectId": oid}) for oid in object_ids])
+        return [r.get("result") for r in replies]
+
     def first_by_name(self, name: str) -> Optional[Dict[str, Any]]:
         matches = self.find_by_name(name)
         return matches[0] if matches else None